@@ -28,8 +28,10 @@
 /* jshint expr: true, sub: true, maxparams: 4 */
 
 
-var http = require('http'),
+var fs = require('fs'),
+    http = require('http'),
     dgram = require('dgram'),
+    util = require('util'),
     url = require('url'),
     retry = require('retry'),
     domain = require('domain'),
@@ -127,6 +129,112 @@ function updateContextCallback(err, responseStatus, responseBody, responseConten
 }
 
 
+/**
+ * Parses a sequence of records, every one consisting of a header line `path?query corr length` followed by `length`
+ * bytes of probe data and an optional newline:
+ *
+ * - Record path will denote the name of the originating probe
+ * - Record query string MUST include arguments `id` and `type`
+ * - Record correlator may be `-` to have one generated
+ *
+ * Invalid records are skipped, up to the next line holding a valid header, so that the rest are still processed.
+ *
+ * @param {Buffer} buffer       The buffer holding the records.
+ * @param {Function} [onError]  Callback invoked with an error for every invalid record skipped.
+ * @returns {Array} The records (objects with `parserName`, `entityId`, `entityType`, `corr` and `body` attributes).
+ */
+function parseRecords(buffer, onError) {
+    var records = [],
+        offset = 0,
+        invalid = -1;
+    while (offset < buffer.length) {
+        var eol = buffer.indexOf('\n', offset),
+            header = (eol < 0) ? [] : buffer.toString('utf8', offset, eol).split(' '),
+            length = parseInt(header[2], 10),
+            start = eol + 1;
+        if ((header.length !== 3) || (header[0].charAt(0) !== '/') || isNaN(length) || (length < 0) ||
+            (start + length > buffer.length)) {
+            invalid = (invalid < 0) ? offset : invalid;
+            offset = (eol < 0) ? buffer.length : start;
+            continue;
+        }
+        if (invalid >= 0) {
+            onError && onError(new Error(util.format('Invalid record at offset %d', invalid)));
+            invalid = -1;
+        }
+        var target = url.parse(header[0], true);
+        records.push({
+            parserName: target.pathname.replace(/^\//, ''),
+            entityId: target.query.id,
+            entityType: target.query.type,
+            corr: (header[1] !== '-') ? header[1] : null,
+            body: buffer.toString('utf8', start, start + length)
+        });
+        offset = start + length;
+        offset += (buffer[offset] === 0x0a) ? 1 : 0;
+    }
+    if (invalid >= 0) {
+        onError && onError(new Error(util.format('Invalid record at offset %d', invalid)));
+    }
+    return records;
+}
+
+
+/**
+ * Asynchronously process a single record taken from a batch.
+ *
+ * @param {Object} record       The record (see {@link adapter#parseRecords}).
+ * @param {String} op           The operation to include in the context of the record.
+ */
+function recordRequestListener(record, op) {
+    var reqdomain = domain.create();
+    reqdomain.context = {
+        trans: txid(),
+        corr: record.corr || uuid(),
+        op: op
+    };
+    reqdomain.on('error', function (err) {
+        logger.error(err.message);
+    });
+    reqdomain.run(function () {
+        logger.info('Request to adapt data using parser %s', record.parserName);
+        try {
+            if (!record.entityId || !record.entityType) {
+                throw new Error('Missing entityId and/or entityType');
+            }
+            reqdomain.entityId = record.entityId;
+            reqdomain.entityType = record.entityType;
+            reqdomain.parser = parser.getParserByName(record.parserName);
+            reqdomain.timestamp = Date.now();
+            reqdomain.body = record.body;
+            process.nextTick(function () {
+                updateContext(reqdomain, exports.updateContextCallback);
+            });
+        } catch (err) {
+            logger.error(err.message);
+        }
+    });
+}
+
+
+/**
+ * Batch requests listener: fans out every record in the body of the request (or UDP message) to the corresponding
+ * parser.
+ *
+ * @param {Buffer} body         The body of the request.
+ * @param {String} op           The operation to include in the context of every record.
+ */
+function batchRequestListener(body, op) {
+    var records = parseRecords(body, function (err) {
+        logger.error(err.message);
+    });
+    logger.info('Batch of %d records', records.length);
+    records.forEach(function (record) {
+        recordRequestListener(record, op);
+    });
+}
+
+
 /**
  * HTTP requests listener.
  *
@@ -136,6 +244,10 @@ function updateContextCallback(err, responseStatus, responseBody, responseConten
  * - Request path will denote the name of the originating probe
  * - Request headers may include a correlation identifier ({@link common#correlatorHttpHeader})
  *
+ * As an exception, requests to resource {@link common#batchResource} include a batch of records in their body, every
+ * one corresponding to a single request (see {@link adapter#parseRecords}). Those larger than `config.maxBatchSize`
+ * are rejected (or discarded, if their length is not known in advance).
+ *
  * @param {http.IncomingMessage} request    The HTTP request to this server.
  * @param {http.ServerResponse}  response   The HTTP response from this server.
  */
@@ -158,7 +270,35 @@ function asyncRequestListener(request, response) {
     reqdomain.run(function () {
         logger.info('Request on resource %s', request.url.split('?').join(' with params '));
         var status = 405;  // not allowed
-        if (request.method === 'POST') {
+        var isBatch = (url.parse(request.url).pathname === '/' + common.batchResource),
+            maxBatchSize = parseInt(config.maxBatchSize, 10);
+        if ((request.method === 'POST') && isBatch &&
+            (parseInt(request.headers['content-length'], 10) > maxBatchSize)) {
+            status = 413;  // request entity too large
+            logger.error('Batch of %s bytes exceeds maximum size', request.headers['content-length']);
+        } else if ((request.method === 'POST') && isBatch) {
+            var chunks = [],
+                size = 0;
+            status = 200;  // ok
+            request.on('data', function (chunk) {
+                chunk = Buffer.isBuffer(chunk) ? chunk : new Buffer(chunk);
+                size += chunk.length;
+                if (size > maxBatchSize) {
+                    chunks = [];  // not to be processed: don't keep it
+                } else {
+                    chunks.push(chunk);
+                }
+            });
+            request.on('end', function () {
+                if (size > maxBatchSize) {
+                    logger.error('Batch of %d bytes exceeds maximum size', size);
+                    return;
+                }
+                process.nextTick(function () {
+                    batchRequestListener(Buffer.concat(chunks), 'POST');
+                });
+            });
+        } else if (request.method === 'POST') {
             var query = url.parse(request.url, true).query;
             reqdomain.entityId = query.id;
             reqdomain.entityType = query.type;
@@ -226,6 +366,29 @@ function udpRequestListener(socket, message, parserName) {
 }
 
 
+/**
+ * UDP batch requests listener (messages consisting of records holding the parser name and entity details).
+ *
+ * @param {dgram.Socket} socket             The UDP socket listening to requests.
+ * @param {Buffer}       message            The incoming message of the request.
+ */
+function udpBatchRequestListener(socket, message) {
+    var reqdomain = domain.create();
+    reqdomain.add(socket);
+    reqdomain.context = {
+        trans: txid(),
+        corr: 'n/a',
+        op: 'UDP'
+    };
+    reqdomain.on('error', function (err) {
+        logger.error(err.message);
+    });
+    reqdomain.run(function () {
+        batchRequestListener(Buffer.isBuffer(message) ? message : new Buffer(message), 'UDP');
+    });
+}
+
+
 /**
  * Server main.
  */
@@ -253,7 +416,20 @@ function main() {
         logger.info({op: 'Init'}, 'Server listening at http://%s:%d/', this.address().address, this.address().port);
     });
 
-    /* Optionally bind this Adapter to a list of UDP endpoints, forwarding requests to the corresponding parser */
+    /* Optionally listen also to a Unix domain socket (for co-located clients, avoiding the TCP loopback stack) */
+    if (config.listenSocket) {
+        try {
+            fs.unlinkSync(config.listenSocket);  // remove stale socket from previous runs
+        } catch (err) {
+            // socket did not exist
+        }
+        http.createServer(asyncRequestListener).listen(config.listenSocket, function () {
+            logger.info({op: 'Init'}, 'Server listening at unix:%s', config.listenSocket);
+        });
+    }
+
+    /* Optionally bind this Adapter to a list of UDP endpoints, forwarding requests to the corresponding parser (or to
+       the parsers given by records in messages, in case of endpoints for `batchResource`) */
     config.udpEndpoints && config.udpEndpoints.split(',').map(function (item) {
         var itemElements = item.split(':'),
             udpListenHost = itemElements[0] || config.listenHost,
@@ -267,7 +443,11 @@ function main() {
                 udpServer.close();
             });
             udpServer.on('message', function (msg) {
-                udpRequestListener(udpServer, msg, udpParserName);
+                if (udpParserName === common.batchResource) {
+                    udpBatchRequestListener(udpServer, msg);
+                } else {
+                    udpRequestListener(udpServer, msg, udpParserName);
+                }
             });
             udpServer.bind(udpListenPort, udpListenHost, function () {
                 logger.info({op: 'Init'}, 'Listening to UDP requests for parser "%s" at %s:%d',
@@ -286,6 +466,9 @@ exports.main = main;
 /** @export */
 exports.updateContextCallback = updateContextCallback;
 
+/** @export */
+exports.parseRecords = parseRecords;
+
 
 if (require.main === module) {
     main();
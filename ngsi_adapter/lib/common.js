@@ -38,6 +38,12 @@ exports.timestampAttrName = '_timestamp';
 exports.correlatorHttpHeader = 'Fiware-Correlator';
 
 
+/**
+ * Name of the resource accepting batches of requests (see {@link adapter#parseRecords} for the format of the body).
+ */
+exports.batchResource = '_batch';
+
+
 /**
  * Context Broker API 'v0' (i.e. NGSI10).
  */
@@ -66,9 +72,11 @@ exports.BROKER_API_V2 = 'v2';
  * @property {String} defaults.brokerApi    Default Context Broker API version.
  * @property {String} defaults.listenHost   Default adapter HTTP listen host.
  * @property {Number} defaults.listenPort   Default adapter HTTP listen port.
+ * @property {String} defaults.listenSocket Default adapter HTTP listen Unix domain socket path.
  * @property {String} defaults.udpEndpoints Default list of UDP endpoints (host:port:parser).
  * @property {String} defaults.parsersPath  Default path with directories to look for parsers.
  * @property {Number} defaults.maxRequests  Default maximum number of simultaneous outgoing requests.
+ * @property {Number} defaults.maxBatchSize Default maximum size (in bytes) of the body of batch requests.
  * @property {Number} defaults.retries      Default maximum number of Context Broker invocation retries.
  */
 exports.defaults = {
@@ -77,8 +85,10 @@ exports.defaults = {
     brokerApi: exports.BROKER_API_V0,
     listenHost: '0.0.0.0',
     listenPort: 1337,
+    listenSocket: null,
     udpEndpoints: null,
     parsersPath: 'lib/parsers:lib/parsers/nagios',
     maxRequests: 5,
+    maxBatchSize: 1048576,
     retries: 2
 };
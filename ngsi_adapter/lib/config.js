@@ -43,9 +43,11 @@ var fs = require('fs'),
  * @property {String} opts.brokerUrl        Context Broker URL.
  * @property {String} opts.listenHost       Adapter listen HTTP host.
  * @property {Number} opts.listenPort       Adapter listen HTTP port.
+ * @property {String} opts.listenSocket     Adapter listen HTTP Unix domain socket path.
  * @property {String} opts.udpEndpoints     Comma-separated list of UDP endpoints (host:port:parser).
  * @property {String} opts.parsersPath      Colon-separated path with directories to look for parsers.
  * @property {Number} opts.maxRequests      Maximum number of simultaneous outgoing requests.
+ * @property {Number} opts.maxBatchSize     Maximum size (in bytes) of the body of batch requests.
  * @property {Number} opts.retries          Maximum number of Context Broker invocation retries.
  */
 var opts = require('optimist')
@@ -61,6 +63,10 @@ var opts = require('optimist')
         alias: 'listenPort',
         'default': process.env['ADAPTER_LISTEN_PORT'] || defaults.listenPort,
         describe: 'Adapter listen port'
+    }).options('s', {
+        alias: 'listenSocket',
+        'default': process.env['ADAPTER_LISTEN_SOCKET'] || defaults.listenSocket,
+        describe: 'Adapter listen Unix domain socket path'
     }).options('u', {
         alias: 'udpEndpoints',
         'default': process.env['ADAPTER_UDP_ENDPOINTS'] || defaults.udpEndpoints,
@@ -77,6 +83,10 @@ var opts = require('optimist')
         alias: 'maxRequests',
         'default': process.env['ADAPTER_MAX_REQUESTS'] || defaults.maxRequests,
         describe: 'Maximum simultaneous requests'
+    }).options('B', {
+        alias: 'maxBatchSize',
+        'default': process.env['ADAPTER_MAX_BATCH_SIZE'] || defaults.maxBatchSize,
+        describe: 'Maximum size of batch requests'
     }).options('r', {
         alias: 'retries',
         'default': process.env['ADAPTER_RETRIES'] || defaults.retries,
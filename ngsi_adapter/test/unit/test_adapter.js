@@ -59,7 +59,10 @@ suite('adapter', function () {
         this.udpParser = 'udp_parser';
         this.udpHost = 'localhost';
         this.udpPort = 1234;
-        config.udpEndpoints = util.format('%s:%d:%s', this.udpHost, this.udpPort, this.udpParser);
+        this.udpBatchPort = 1235;
+        config.udpEndpoints = util.format('%s:%d:%s,%s:%d:%s',
+                                          this.udpHost, this.udpBatchPort, common.batchResource,
+                                          this.udpHost, this.udpPort, this.udpParser);
         config.parsersPath = path.normalize(__dirname);  // include current directory in search
         logger.stream = require('dev-null')();
         logger.setLevel('DEBUG');
@@ -83,16 +86,18 @@ suite('adapter', function () {
             var udpSocket = new Emitter();
             udpSocket.bind = function (port, host, callback) {
                 self.udpServer = this;
+                self.udpServers[port] = this;
                 this.address = sinon.stub().returns({ address: host, port: port });
                 callback.call(this);
             };
             udpSocket.send = function (buf, offset, length, port, address, callback) {
-                self.udpServer.emit('message', buf.toString('utf8', offset, length - offset));
+                self.udpServers[port].emit('message', buf.toString('utf8', offset, length - offset));
                 callback.call(this, null, length - offset);
             };
             udpSocket.close = sinon.stub();
             return udpSocket;
         });
+        self.udpServers = {};
         self.request = new Emitter();
         self.request.method = 'POST';
         self.request.headers = {};
@@ -102,10 +107,13 @@ suite('adapter', function () {
     teardown(function () {
         http.createServer.restore();
         dgram.createSocket.restore();
-        this.udpServer.removeAllListeners();
+        for (var port in this.udpServers) {
+            this.udpServers[port].removeAllListeners();
+        }
         this.processEvents.map(function (event) { process.removeListener(event, process.listeners(event).pop()); });
         delete this.request;
         delete this.udpServer;
+        delete this.udpServers;
         delete this.httpListener;
         delete config.brokerApi;
     });
@@ -507,6 +515,186 @@ suite('adapter', function () {
         });
     });
 
+    test('batch_request_fans_out_records_to_parsers', function (done) {
+        var self = this,
+            parserNames = [],
+            response = {
+                writeHead: sinon.stub(),
+                end: sinon.stub()
+            },
+            records = [
+                util.format('/%s?id=id1&type=type1 corr1 %d\n%s\n', self.resource, self.body.length, self.body),
+                util.format('/%s?id=id2&type=type2 corr2 %d\n%s\n', 'other', self.body.length, self.body)
+            ];
+        var factoryGetParserByName = sinon.stub(factory, 'getParserByName', function (name) {
+            var mockParser = Object.create(parser);
+            mockParser.getUpdateRequest = function (reqdomain) {
+                reqdomain.options = {headers: self.headers};
+                return '';
+            };
+            parserNames.push(name);
+            return mockParser;
+        });
+        var httpRequest = sinon.stub(http, 'request', function () {
+            var clientRequest = new Emitter();
+            clientRequest.end = sinon.stub();
+            if (httpRequest.callCount === records.length) {
+                httpRequest.restore();
+                factoryGetParserByName.restore();
+                assert.deepEqual(parserNames, [self.resource, 'other']);
+                done();
+            }
+            return clientRequest;
+        });
+        self.timeout(500);
+        self.request.url = self.baseurl + '/' + common.batchResource;
+        self.httpListener(self.request, response);
+        self.request.emit('data', records.join(''));
+        self.request.emit('end');
+        assert(response.writeHead.calledOnce);
+        assert.equal(response.writeHead.args[0][0], 200);  // ok
+    });
+
+    test('batch_request_with_invalid_record_fails_and_logs_error', function (done) {
+        var self = this,
+            response = {
+                writeHead: sinon.stub(),
+                end: sinon.stub()
+            };
+        var httpRequest = sinon.spy(http, 'request');
+        var logError = sinon.stub(logger, 'error', function (errmsg) {
+            var httpRequestCount = httpRequest.callCount;
+            logError.restore();
+            httpRequest.restore();
+            assert(/Invalid record/.test(errmsg));
+            assert.equal(httpRequestCount, 0);
+            done();
+        });
+        self.timeout(500);
+        self.request.url = self.baseurl + '/' + common.batchResource;
+        self.httpListener(self.request, response);
+        self.request.emit('data', util.format('/%s?id=id1&type=type1 corr1 %d\n', self.resource, 1000));
+        self.request.emit('end');
+    });
+
+    test('batch_request_skips_invalid_record_and_processes_the_rest', function (done) {
+        var self = this,
+            errors = [],
+            response = {
+                writeHead: sinon.stub(),
+                end: sinon.stub()
+            },
+            records = [
+                util.format('/%s?id=id1&type=type1 corr1 %d\n%s\n', self.resource, self.body.length, self.body),
+                'invalid record header\n',
+                util.format('/%s?id=id2&type=type2 corr2 %d\n%s\n', self.resource, self.body.length, self.body)
+            ];
+        var factoryGetParserByName = sinon.stub(factory, 'getParserByName', function () {
+            var mockParser = Object.create(parser);
+            mockParser.getUpdateRequest = function (reqdomain) {
+                reqdomain.options = {headers: self.headers};
+                return '';
+            };
+            return mockParser;
+        });
+        var logError = sinon.stub(logger, 'error', function (errmsg) {
+            errors.push(errmsg);
+        });
+        var httpRequest = sinon.stub(http, 'request', function () {
+            var clientRequest = new Emitter();
+            clientRequest.end = sinon.stub();
+            if (httpRequest.callCount === 2) {
+                httpRequest.restore();
+                factoryGetParserByName.restore();
+                logError.restore();
+                assert.equal(errors.length, 1);
+                assert(/Invalid record/.test(errors[0]));
+                done();
+            }
+            return clientRequest;
+        });
+        self.timeout(500);
+        self.request.url = self.baseurl + '/' + common.batchResource;
+        self.httpListener(self.request, response);
+        self.request.emit('data', records.join(''));
+        self.request.emit('end');
+    });
+
+    test('batch_request_fails_if_larger_than_max_size', function () {
+        var response = {
+            writeHead: sinon.stub(),
+            end: sinon.stub()
+        };
+        this.request.url = this.baseurl + '/' + common.batchResource;
+        this.request.headers['content-length'] = String(config.maxBatchSize + 1);
+        this.httpListener(this.request, response);
+        assert(response.writeHead.calledOnce);
+        assert.equal(response.writeHead.args[0][0], 413);  // request entity too large
+    });
+
+    test('parse_records_skips_invalid_records', function () {
+        var errors = [],
+            buffer = new Buffer('/check_a?id=id1&type=type1 corr1 5\nline1\n' +
+                                'not a header\nnor this one\n' +
+                                '/check_b?id=id2&type=type2 - 5\nline1\n' +
+                                '/check_c?id=id3&type=type3 - 1000\nline1');
+        var records = adapter.parseRecords(buffer, function (err) {
+            errors.push(err.message);
+        });
+        assert.equal(records.length, 2);
+        assert.equal(records[0].parserName, 'check_a');
+        assert.equal(records[1].parserName, 'check_b');
+        assert.deepEqual(errors, ['Invalid record at offset 41', 'Invalid record at offset 104']);
+    });
+
+    test('parse_records_gets_all_records_from_buffer', function () {
+        var buffer = new Buffer('/check_a?id=id1&type=type1 corr1 5\nline1\n' +
+                                '/check_b?id=id2&type=type2 - 11\nline1\nline2');
+        var records = adapter.parseRecords(buffer);
+        assert.equal(records.length, 2);
+        assert.equal(records[0].parserName, 'check_a');
+        assert.equal(records[0].entityId, 'id1');
+        assert.equal(records[0].entityType, 'type1');
+        assert.equal(records[0].corr, 'corr1');
+        assert.equal(records[0].body, 'line1');
+        assert.equal(records[1].parserName, 'check_b');
+        assert.equal(records[1].corr, null);
+        assert.equal(records[1].body, 'line1\nline2');
+    });
+
+    test('udp_batch_request_fans_out_records_to_parsers', function (done) {
+        var self = this,
+            message = new Buffer(util.format('/%s?id=id1&type=type1 corr1 %d\n%s\n',
+                                             self.resource, self.body.length, self.body)),
+            client = dgram.createSocket('udp4');
+        var factoryGetParserByName = sinon.stub(factory, 'getParserByName', function (name) {
+            var mockParser = Object.create(parser);
+            mockParser.getUpdateRequest = function (reqdomain) {
+                assert.equal(reqdomain.entityId, 'id1');
+                assert.equal(reqdomain.entityType, 'type1');
+                assert.equal(reqdomain.context.corr, 'corr1');
+                reqdomain.options = {headers: self.headers};
+                return '';
+            };
+            assert.equal(name, self.resource);
+            return mockParser;
+        });
+        var httpRequest = sinon.stub(http, 'request', function () {
+            var clientRequest = new Emitter();
+            clientRequest.end = sinon.stub();
+            httpRequest.restore();
+            factoryGetParserByName.restore();
+            done();
+            return clientRequest;
+        });
+        self.timeout(500);
+        client.send(message, 0, message.length, self.udpBatchPort, self.udpHost, function (err, bytes) {
+            client.close();
+            assert.equal(err, null);
+            assert.equal(bytes, message.length);
+        });
+    });
+
     test('response_includes_autogenerated_correlator', function () {
         var response = {
             writeHead: sinon.stub(),
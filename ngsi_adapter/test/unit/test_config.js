@@ -31,7 +31,9 @@ s * Copyright 2015-2016 Telefónica I+D
 process.argv = [ '--retries=9999', '--retries=1' ];
 
 
-var util = require('util'),
+var os = require('os'),
+    util = require('util'),
+    path = require('path'),
     http = require('http'),
     dgram = require('dgram'),
     sinon = require('sinon'),
@@ -65,6 +67,9 @@ suite('config', function () {
         sinon.stub(http, 'createServer', function () {
             self.httpListener = arguments[0];
             self.serverListen = sinon.spy(function (port, host, callback) {
+                if (typeof host === 'function') {
+                    callback = host;  // Unix domain socket: only path and callback
+                }
                 this.address = sinon.stub().returns({address: host, port: port});
                 callback.call(this);
             });
@@ -171,6 +176,17 @@ suite('config', function () {
         assert(this.serverListen.args[0][0], defaults.listenPort);
     });
 
+    test('adapter_starts_listening_to_both_http_port_and_unix_socket', function () {
+        var listenSocket = path.join(os.tmpdir(), util.format('ngsi_adapter_test_%d.sock', process.pid)),
+            configListenSocketSave = config.listenSocket;
+        config.listenSocket = listenSocket;
+        adapter.main();
+        config.listenSocket = configListenSocketSave;
+        assert(this.serverListen.calledTwice);
+        assert.equal(this.serverListen.args[0][0], defaults.listenPort);
+        assert.equal(this.serverListen.args[1][0], listenSocket);
+    });
+
     test('adapter_starts_but_logs_warning_message_when_invalid_udp_endpoints', function () {
         var self = this,
             udpEndpointNoParser = 'host:port:',
@@ -0,0 +1,1627 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   adapter_sender.c
+ * @brief  Delivery of requests to NGSI Adapter (implementation)
+ *
+ * This file consists of the implementation of the delivery of requests to NGSI
+ * Adapter. When a queue size is given as module argument, the Nagios callback
+ * only copies the request into a bounded lock-free queue, and a pool of sender
+ * threads started at module initialization will take care of the HTTP requests.
+ * Otherwise, requests are synchronously sent from the Nagios main thread. Either
+ * way, every sender keeps a persistent (keep-alive) HTTP session to the adapter
+ * for the whole module lifetime, which is only reopened after a failure. When
+ * the adapter URL has `udp://` scheme, every request is instead sent as a single
+ * fire-and-forget datagram holding a self-describing record. HTTP sessions may
+ * also connect through a Unix domain socket when adapter is co-located.
+ *
+ * Concurrent sender threads may also adjust their limit of requests in flight,
+ * following an AIMD scheme: the limit grows while the adapter keeps its latency
+ * and shrinks as soon as latency rises or requests fail.
+ *
+ * After a number of consecutive failures, a circuit breaker makes requests be
+ * skipped without any network attempt (spooling them, if possible) for a time
+ * that doubles every time a single probe request fails again.
+ *
+ * When a spool file is given, HTTP requests that fail or don't fit in the queue
+ * are saved there instead of being discarded, and a replay thread will resend
+ * them at a limited rate (retrying periodically while adapter is unavailable).
+ *
+ * All HTTP sessions share a single DNS cache and TLS session cache, seeded with
+ * the addresses of adapter hosts resolved at initialization, so that hostnames
+ * are only resolved again once their entries expire (see ::dns_ttl). Adapter hosts
+ * are then resolved again in background before that happens, and their entries
+ * loaded anew by the next request, so that sending never blocks on DNS queries.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "neberrors.h"
+#include "curl/curl.h"
+#include "request_queue.h"
+#include "request_spool.h"
+#include "hash_ring.h"
+#include "dns_cache.h"
+#include "adapter_sender.h"
+
+
+/* time (in seconds) a sender thread waits for new requests before polling queue again */
+#define SENDER_WAIT_TIMEOUT	1
+
+
+/* time (in milliseconds) a concurrent sender thread waits for activity on its transfers */
+#define TRANSFER_WAIT_TIMEOUT	20
+
+
+/* maximum size of a UDP datagram payload */
+#define UDP_MAX_DATAGRAM	65507
+
+
+/* factor of latency over baseline considered as a congestion signal */
+#define LATENCY_TOLERANCE	2.0
+
+
+/* weight of a new latency sample when baseline latency drifts upwards */
+#define BASELINE_DRIFT		0.05
+
+
+/* maximum time (in milliseconds) requests are skipped before retrying an unavailable adapter */
+#define BREAKER_MAX_WAIT	60000
+
+
+/* time (in milliseconds) the replay thread waits before retrying a failed spooled request */
+#define REPLAY_RETRY_DELAY	5000
+
+
+/* time (in seconds) entries of the shared DNS cache are kept when ::dns_ttl is zero (libcurl default) */
+#define SHARE_DNS_TIMEOUT	60
+
+
+/* maximum length of a `+host:port:address` entry loaded into the shared DNS cache */
+#define RESOLVE_ENTRY_MAXLEN	(NI_MAXHOST + INET6_ADDRSTRLEN + 32)
+
+
+/* headers of a request, built in place so that no allocations are needed (libcurl only reads them) */
+typedef struct {
+	struct curl_slist	list[2];
+	char			corr[CORRELATOR_HTTP_HEADER_LEN + CORRELATOR_LEN + 3];	/* "name: value" */
+} request_headers_t;
+
+
+/* transfer slot of a concurrent sender thread */
+typedef struct {
+	CURL*			session;	/* persistent session of this slot */
+	request_headers_t	headers;	/* headers of the request in progress */
+	struct curl_slist*	hosts;		/* adapter hosts loaded by the request in progress (if so) */
+	adapter_request_t	request;	/* request in progress */
+	int			busy;		/* whether a request is in progress */
+} transfer_t;
+
+
+/* states of a circuit breaker */
+typedef enum {
+	BREAKER_CLOSED,			/* requests are sent */
+	BREAKER_OPEN,			/* requests are skipped until retry time */
+	BREAKER_HALF_OPEN		/* a probe request is in progress, other requests are skipped */
+} breaker_state_t;
+
+
+/* circuit breaker of an adapter endpoint */
+typedef struct {
+	pthread_mutex_t		mutex;
+	breaker_state_t		state;
+	size_t			failures;	/* consecutive failures */
+	size_t			wait;		/* time (in milliseconds) of current open state */
+	struct timespec		retry_time;	/* time when a probe request is allowed */
+	unsigned long		skipped;	/* requests skipped since breaker opened */
+} breaker_t;
+
+
+/* adapter endpoint */
+typedef struct {
+	const char*		url;		/* adapter URL (see ::adapter_urls) */
+	char*			batch_url;	/* URL of the resource accepting batches of requests */
+	int			udp_socket;	/* socket to send requests as UDP datagrams (if so) */
+	breaker_t		breaker;	/* circuit breaker */
+	char*			host;		/* host of the URL, if watched in ::endpoint_dns */
+	long			port;		/* port of the URL */
+	char			resolve[RESOLVE_ENTRY_MAXLEN];	/* `+host:port:address` entry (empty if unresolved) */
+} endpoint_t;
+
+
+/* adaptive limit of requests in flight of a concurrent sender thread */
+typedef struct {
+	size_t			limit;		/* current limit */
+	size_t			samples;	/* requests completed in current window */
+	size_t			errors;		/* requests failed in current window */
+	double			latency;	/* total latency (seconds) of the requests of current window */
+	double			baseline;	/* estimated latency (seconds) of an unloaded adapter */
+	int			saturated;	/* whether limit was reached in current window */
+	int			slow_start;	/* whether limit grows exponentially (until congestion is detected) */
+} concurrency_t;
+
+
+/* position within the pieces of a request body being read */
+typedef struct {
+	const adapter_body_part_t*	parts;		/* pieces of the body */
+	size_t				count;		/* number of pieces */
+	size_t				index;		/* current piece */
+	const char*			next;		/* next char of current piece (null if not started) */
+	int				newline;	/* whether a newline is pending (only written if followed by text) */
+} body_reader_t;
+
+
+/* batch of requests being collected by a sender thread */
+typedef struct {
+	char*			buffer;		/* records collected so far (see ::ADAPTER_RECORD_FORMAT) */
+	size_t			length;		/* length of the records */
+	size_t			capacity;	/* allocated size of the buffer */
+	size_t			count;		/* number of records */
+	struct timespec		deadline;	/* time when the batch must be sent */
+	char			corr[CORRELATOR_LEN+1];	/* correlator of the first record */
+} batch_t;
+
+
+/* queue of pending requests (NULL if requests are sent synchronously) */
+static request_queue_t*		request_queue	= NULL;
+
+
+/* number of requests in the queue, used to awake sender threads */
+static sem_t			request_count;
+
+
+/* sender threads */
+static pthread_t*		sender_threads	= NULL;
+
+
+/* number of sender threads actually running */
+static size_t			sender_running	= 0;
+
+
+/* flag to stop sender threads */
+static volatile int		sender_stopped	= 0;
+
+
+/* number of requests discarded because of a full queue */
+static unsigned long		request_dropped	= 0;
+
+
+/* HTTP session used to send requests synchronously from Nagios main thread */
+static CURL*			sync_session	= NULL;
+
+
+/* endpoint used when a single adapter URL is given (or before initialization) */
+static endpoint_t		single_endpoint	= { .udp_socket = -1,
+						    .breaker = { .mutex = PTHREAD_MUTEX_INITIALIZER } };
+
+
+/* adapter endpoints (see ::adapter_urls) */
+static endpoint_t*		endpoints	= &single_endpoint;
+
+
+/* number of adapter endpoints */
+static size_t			endpoint_count	= 1;
+
+
+/* ring to distribute entities among adapter endpoints (NULL if there is only one) */
+static hash_ring_t*		endpoint_ring	= NULL;
+
+
+/* whether requests are sent as UDP datagrams (otherwise, via HTTP) */
+static int			udp_transport	= 0;
+
+
+/* spool of undelivered requests (NULL if such requests are discarded) */
+static request_spool_t*		request_spool	= NULL;
+
+
+/* DNS and TLS session caches shared by all HTTP sessions (NULL if not available) */
+static CURLSH*			adapter_share	= NULL;
+
+
+/* locks of the data shared by HTTP sessions */
+static pthread_mutex_t		share_locks[CURL_LOCK_DATA_LAST];
+
+
+/* cache resolving adapter hosts again before their entries in the shared DNS cache expire (NULL if not used) */
+static dns_cache_t*		endpoint_dns	= NULL;
+
+
+/* lock of the `+host:port:address` entries of endpoints, updated by the refresh thread of ::endpoint_dns */
+static pthread_mutex_t		endpoint_mutex	= PTHREAD_MUTEX_INITIALIZER;
+
+
+/* whether last resolved adapter hosts have already been loaded into the shared DNS cache */
+static int			endpoint_seeded	= 0;
+
+
+/* thread replaying spooled requests */
+static pthread_t		replay_thread;
+
+
+/* used to awake the replay thread when stopped */
+static sem_t			replay_wakeup;
+
+
+/* compares two points in time */
+static int timespec_cmp(const struct timespec* a, const struct timespec* b)
+{
+	return (a->tv_sec != b->tv_sec) ? ((a->tv_sec > b->tv_sec) ? 1 : -1)
+	     : (a->tv_nsec != b->tv_nsec) ? ((a->tv_nsec > b->tv_nsec) ? 1 : -1) : 0;
+}
+
+
+/* gets the point in time a number of milliseconds from now */
+static void timespec_from_now(struct timespec* ts, size_t millis)
+{
+	clock_gettime(CLOCK_REALTIME, ts);
+	ts->tv_sec  += millis / 1000;
+	ts->tv_nsec += (millis % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+
+/* waits for new requests to be queued (or timeout, or deadline of pending batches, one per endpoint) */
+static void wait_for_requests(const batch_t* batches)
+{
+	struct timespec timeout;
+	size_t		i;
+
+	timespec_from_now(&timeout, SENDER_WAIT_TIMEOUT * 1000);
+	for (i = 0; batches && (i < endpoint_count); i++) {
+		if (batches[i].count && (timespec_cmp(&batches[i].deadline, &timeout) < 0)) {
+			timeout = batches[i].deadline;
+		}
+	}
+	while ((sem_timedwait(&request_count, &timeout) == -1) && (errno == EINTR));
+}
+
+
+/* checks whether a request may be sent, or must be skipped because of an open breaker */
+static int breaker_allows(breaker_t* breaker, context_t* context)
+{
+	int		allowed = 1;
+	struct timespec	now;
+
+	if (breaker_threshold == 0) {
+		return allowed;
+	}
+
+	pthread_mutex_lock(&breaker->mutex);
+	if (breaker->state == BREAKER_OPEN) {
+		clock_gettime(CLOCK_REALTIME, &now);
+		if (timespec_cmp(&now, &breaker->retry_time) >= 0) {
+			logging(LOG_INFO, context, "Retrying NGSI Adapter after %lu ms (%lu requests skipped)",
+			        (unsigned long) breaker->wait, breaker->skipped);
+			breaker->state = BREAKER_HALF_OPEN;	/* this request is the probe */
+		} else {
+			allowed = 0;
+		}
+	} else if (breaker->state == BREAKER_HALF_OPEN) {
+		allowed = 0;
+	}
+	if (!allowed) {
+		breaker->skipped++;
+	}
+	pthread_mutex_unlock(&breaker->mutex);
+
+	return allowed;
+}
+
+
+/* updates a breaker with the result of a request, opening it after too many failures */
+static void breaker_update(breaker_t* breaker, int success, context_t* context)
+{
+	if (breaker_threshold == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&breaker->mutex);
+	if (success) {
+		if (breaker->state != BREAKER_CLOSED) {
+			logging(LOG_INFO, context, "NGSI Adapter available again (%lu requests skipped)", breaker->skipped);
+		}
+		breaker->state    = BREAKER_CLOSED;
+		breaker->failures = 0;
+	} else if ((breaker->state == BREAKER_HALF_OPEN)
+	           || ((breaker->state == BREAKER_CLOSED) && (++breaker->failures >= breaker_threshold))) {
+		if (breaker->state == BREAKER_CLOSED) {
+			breaker->wait    = breaker_wait;
+			breaker->skipped = 0;
+		} else {
+			breaker->wait = (breaker->wait * 2 < BREAKER_MAX_WAIT) ? breaker->wait * 2 : BREAKER_MAX_WAIT;
+		}
+		logging(LOG_WARN, context, "NGSI Adapter unavailable: skipping requests for %lu ms",
+		        (unsigned long) breaker->wait);
+		breaker->state = BREAKER_OPEN;
+		timespec_from_now(&breaker->retry_time, breaker->wait);
+	}
+	pthread_mutex_unlock(&breaker->mutex);
+}
+
+
+/* gets the endpoint whose URL is a prefix of a given one (or the first endpoint, if none) */
+static size_t find_endpoint(const char* url)
+{
+	size_t i, len;
+
+	for (i = 0; (i < endpoint_count) && (endpoints[i].url != NULL); i++) {
+		len = strlen(endpoints[i].url);
+		if (!strncmp(url, endpoints[i].url, len) && strchr("/?", url[len])) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+
+/* routes a request to an endpoint by the entity id in its query string, fixing its URL accordingly */
+static void route_adapter_request(adapter_request_t* request)
+{
+	const char*	key = request->url;
+	size_t		len = strlen(key);
+	const char*	ptr;
+	char*		url;
+
+	request->endpoint = 0;
+	if (endpoint_ring == NULL) {
+		return;
+	}
+
+	for (ptr = strchr(request->url, '?'); ptr != NULL; ptr = strchr(ptr + 1, '&')) {
+		if (!strncmp(ptr + 1, ADAPTER_QUERY_FIELD_ID "=", sizeof(ADAPTER_QUERY_FIELD_ID))) {
+			key = ptr + 1 + sizeof(ADAPTER_QUERY_FIELD_ID);
+			len = strcspn(key, "&");
+			break;
+		}
+	}
+
+	/* request URL was built from the first endpoint */
+	request->endpoint = hash_ring_lookup(endpoint_ring, key, len);
+	len = strlen(endpoints[0].url);
+	if ((request->endpoint != 0) && !strncmp(request->url, endpoints[0].url, len)
+	    && ((url = (char*) malloc(strlen(endpoints[request->endpoint].url) + strlen(request->url + len) + 1)) != NULL)) {
+		sprintf(url, "%s%s", endpoints[request->endpoint].url, request->url + len);
+		free(request->url);
+		request->url = url;
+	}
+}
+
+
+/* gets the path and query of a request relative to adapter URL */
+static const char* relative_request_path(const adapter_request_t* request)
+{
+	const char*	prefix = endpoints[request->endpoint].url;
+	size_t		len    = strlen(prefix);
+	return (strncmp(request->url, prefix, len)) ? request->url : request->url + len;
+}
+
+
+/* starts reading the pieces of the body of a request */
+static void init_body_reader(body_reader_t* reader, const adapter_request_t* request)
+{
+	reader->parts   = request->parts;
+	reader->count   = request->part_count;
+	reader->index   = 0;
+	reader->next    = NULL;
+	reader->newline = 0;
+}
+
+
+/* reads the next chars of the pieces of a body (just counting them if no buffer is given), unescaping those
+ * escaped and skipping empty and trailing lines (not accepted by NGSI Adapter), returning the number of chars */
+static size_t read_body(body_reader_t* reader, char* buffer, size_t size)
+{
+	size_t length = 0;
+
+	while ((reader->index < reader->count) && ((buffer == NULL) || (length < size))) {
+		const adapter_body_part_t*	part = &reader->parts[reader->index];
+		const char*			ptr  = (reader->next) ? reader->next : (part->data) ? part->data : "";
+		size_t				span;
+
+		if (*ptr == '\0') {
+			reader->index++;
+			reader->next = NULL;
+		} else if ((*ptr == '\n') || (part->escaped && (ptr[0] == '\\') && (ptr[1] == 'n'))) {
+			reader->newline = 1;
+			reader->next    = ptr + ((*ptr == '\n') ? 1 : 2);
+		} else if (reader->newline) {
+			if (buffer) buffer[length] = '\n';
+			length++;
+			reader->newline = 0;
+			reader->next    = ptr;
+		} else if (part->escaped && (ptr[0] == '\\') && (ptr[1] == '\\')) {
+			if (buffer) buffer[length] = '\\';
+			length++;
+			reader->next = ptr + 2;
+		} else {
+			span = 1 + strcspn(ptr + 1, (part->escaped) ? "\\\n" : "\n");
+			if (buffer) {
+				span = (span < size - length) ? span : size - length;
+				memcpy(buffer + length, ptr, span);
+			}
+			length += span;
+			reader->next = ptr + span;
+		}
+	}
+
+	return length;
+}
+
+
+/* libcurl read callback streaming the pieces of a body */
+static size_t read_body_callback(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+	return read_body((body_reader_t*) userdata, buffer, size * nitems);
+}
+
+
+/* libcurl seek callback rewinding the pieces of a body, so that the request can be sent again (i.e. when a
+ * reused connection was closed by the adapter); other positions are reached by libcurl reading the body */
+static int seek_body_callback(void* userdata, curl_off_t offset, int origin)
+{
+	body_reader_t* reader = (body_reader_t*) userdata;
+
+	if ((origin != SEEK_SET) || (offset != 0)) {
+		return CURL_SEEKFUNC_CANTSEEK;
+	}
+	reader->index   = 0;
+	reader->next    = NULL;
+	reader->newline = 0;
+	return CURL_SEEKFUNC_OK;
+}
+
+
+/* gets the length of the body of a request */
+static size_t body_length(const adapter_request_t* request)
+{
+	body_reader_t reader;
+
+	if (request->body != NULL) {
+		return strlen(request->body);
+	}
+	init_body_reader(&reader, request);
+	return read_body(&reader, NULL, 0);
+}
+
+
+/* copies the body of a request (of given length) to a buffer */
+static void copy_body(char* buffer, const adapter_request_t* request, size_t length)
+{
+	body_reader_t reader;
+
+	if (request->body != NULL) {
+		memcpy(buffer, request->body, length);
+	} else {
+		init_body_reader(&reader, request);
+		read_body(&reader, buffer, length);
+	}
+}
+
+
+/* joins the body of a request into a single string */
+static char* join_body(const adapter_request_t* request)
+{
+	size_t	length = body_length(request);
+	char*	result = NULL;
+
+	if ((result = (char*) malloc(length + 1)) != NULL) {
+		copy_body(result, request, length);
+		result[length] = '\0';
+	}
+
+	return result;
+}
+
+
+/* gets the maximum length of a request formatted as a record (see ::ADAPTER_RECORD_FORMAT) */
+static size_t record_length(const adapter_request_t* request)
+{
+	return strlen(relative_request_path(request)) + CORRELATOR_LEN + body_length(request) + 32;
+}
+
+
+/* formats a request as a record (see ::ADAPTER_RECORD_FORMAT), returning its actual length */
+static size_t format_record(char* buffer, const adapter_request_t* request)
+{
+	size_t bodylen = body_length(request);
+	size_t length  = sprintf(buffer, ADAPTER_RECORD_FORMAT,
+	                         relative_request_path(request), request->corr, (unsigned long) bodylen);
+
+	copy_body(buffer + length, request, bodylen);
+	length += bodylen;
+	buffer[length++] = '\n';
+	buffer[length] = '\0';
+	return length;
+}
+
+
+/* appends a request to a batch as a new record */
+static int append_to_batch(batch_t* batch, const adapter_request_t* request)
+{
+	size_t needed = batch->length + record_length(request);
+
+	if (needed > batch->capacity) {
+		size_t	capacity = (batch->capacity) ? batch->capacity : MAXBUFLEN;
+		char*	buffer;
+		while (capacity < needed) capacity <<= 1;
+		if ((buffer = (char*) realloc(batch->buffer, capacity)) == NULL) {
+			return NEB_ERROR;
+		}
+		batch->buffer   = buffer;
+		batch->capacity = capacity;
+	}
+
+	if (batch->count++ == 0) {
+		strcpy(batch->corr, request->corr);
+		timespec_from_now(&batch->deadline, batch_delay);
+	}
+	batch->length += format_record(batch->buffer + batch->length, request);
+	return NEB_OK;
+}
+
+
+/* opens a UDP socket connected to the host and port of an endpoint URL (`udp://host:port`) */
+static int open_udp_socket(endpoint_t* endpoint, context_t* context)
+{
+	int		result	= NEB_ERROR;
+	const char*	target	= endpoint->url + strlen(ADAPTER_UDP_SCHEME);
+	const char*	port	= strrchr(target, ':');
+	char		host[NI_MAXHOST];
+	struct addrinfo	hints, *list = NULL, *ptr;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	if ((port == NULL) || ((size_t) (port - target) >= sizeof(host))) {
+		logging(LOG_ERROR, context, "Invalid UDP endpoint %s", endpoint->url);
+	} else {
+		/* remove brackets from IPv6 literal addresses */
+		const char* start = (*target == '[') ? target + 1 : target;
+		size_t      len   = (port - start) - ((port > start && port[-1] == ']') ? 1 : 0);
+		strncpy(host, start, len);
+		host[len] = '\0';
+		if (getaddrinfo(host, port + 1, &hints, &list) != 0) {
+			logging(LOG_ERROR, context, "Cannot resolve UDP endpoint %s", endpoint->url);
+		} else {
+			for (ptr = list; ptr && (result != NEB_OK); ptr = ptr->ai_next) {
+				if ((endpoint->udp_socket = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol)) == -1) {
+					continue;
+				} else if (connect(endpoint->udp_socket, ptr->ai_addr, ptr->ai_addrlen) == -1) {
+					close(endpoint->udp_socket);
+					endpoint->udp_socket = -1;
+				} else {
+					result = NEB_OK;
+				}
+			}
+			freeaddrinfo(list);
+			if (result == NEB_OK) {
+				logging(LOG_INFO, context, "Requests will be sent as UDP datagrams to %s", endpoint->url);
+			} else {
+				logging(LOG_ERROR, context, "Cannot open UDP socket to %s", endpoint->url);
+			}
+		}
+	}
+
+	return result;
+}
+
+
+/* sends a request to NGSI Adapter as a single UDP datagram holding a record */
+static int send_adapter_datagram(const adapter_request_t* request, context_t* context)
+{
+	int	result = NEB_ERROR;
+	char*	buffer = NULL;
+	size_t	length;
+
+	if ((buffer = (char*) malloc(record_length(request))) == NULL) {
+		logging(LOG_WARN, context, "Cannot allocate datagram to %s", request->url);
+	} else if ((length = format_record(buffer, request)) > UDP_MAX_DATAGRAM) {
+		logging(LOG_WARN, context, "Request to %s failed: datagram too large (%lu bytes)",
+		        request->url, (unsigned long) length);
+	} else if (send(endpoints[request->endpoint].udp_socket, buffer, length, 0) == -1) {
+		logging(LOG_WARN, context, "Request to %s failed: %s",
+		        request->url, strerror(errno));
+	} else {
+		logging(LOG_INFO, context, "Request sent to %s",
+		        request->url);
+		result = NEB_OK;
+	}
+
+	free(buffer);
+	return result;
+}
+
+
+/* saves an undelivered request into the spool (as URL, correlator and body, separated by null characters) */
+static int spool_adapter_request(const adapter_request_t* request, context_t* context)
+{
+	int	result = NEB_ERROR;
+	size_t	urllen = strlen(request->url) + 1;
+	size_t	corrlen = strlen(request->corr) + 1;
+	size_t	length = urllen + corrlen + body_length(request);
+	size_t	dropped = 0;
+	char*	buffer;
+
+	if (request_spool == NULL) {
+		/* no spool: request is discarded */
+	} else if ((buffer = (char*) malloc(length)) == NULL) {
+		logging(LOG_WARN, context, "Cannot allocate spooled request to %s", request->url);
+	} else {
+		memcpy(buffer, request->url, urllen);
+		memcpy(buffer + urllen, request->corr, corrlen);
+		copy_body(buffer + urllen + corrlen, request, length - urllen - corrlen);
+		if (request_spool_append(request_spool, buffer, length, &dropped) != 0) {
+			logging(LOG_WARN, context, "Request to %s too large to be spooled", request->url);
+		} else {
+			if (dropped > 0) {
+				logging(LOG_WARN, context, "Spool full: discarding %lu oldest requests", (unsigned long) dropped);
+			}
+			logging(LOG_DEBUG, context, "Request to %s spooled", request->url);
+			result = NEB_OK;
+		}
+		free(buffer);
+	}
+
+	return result;
+}
+
+
+/* gets a request from its spooled contents (pointing to them, no copies are made) */
+static int unspool_adapter_request(char* data, size_t length, adapter_request_t* request)
+{
+	char*	corr = (char*) memchr(data, '\0', length);
+	char*	body = (corr) ? (char*) memchr(corr + 1, '\0', length - (corr + 1 - data)) : NULL;
+
+	if ((body == NULL) || (strlen(corr + 1) > CORRELATOR_LEN)) {
+		return NEB_ERROR;
+	}
+	request->url  = data;
+	request->body = body + 1;
+	request->endpoint = find_endpoint(data);
+	strcpy(request->corr, corr + 1);
+	return NEB_OK;
+}
+
+
+/* replay thread: resends spooled requests at ::replay_rate until stopped */
+static void* replay_thread_loop(void* arg)
+{
+	adapter_request_t	request;
+	CURL*			session = NULL;
+	context_t		context = { .corr = request.corr, .op = "NGSIAdapter" };
+	struct timespec		timeout;
+	uint64_t		seq;
+	size_t			length, delay;
+	char*			data;
+
+	while (!__atomic_load_n(&sender_stopped, __ATOMIC_ACQUIRE)) {
+		if ((data = (char*) request_spool_peek(request_spool, &seq, &length)) == NULL) {
+			delay = SENDER_WAIT_TIMEOUT * 1000;
+		} else if (unspool_adapter_request(data, length, &request) != NEB_OK) {
+			context_t discard = { .op = "NGSIAdapter" };
+			logging(LOG_WARN, &discard, "Discarding invalid spooled request");
+			request_spool_remove(request_spool, seq);
+			delay = 0;
+		} else if (send_adapter_request(&request, &session, &context) == NEB_OK) {
+			request_spool_remove(request_spool, seq);
+			delay = 1000 / replay_rate;
+		} else {
+			delay = REPLAY_RETRY_DELAY;
+		}
+		free(data);
+		if (delay > 0) {
+			timespec_from_now(&timeout, delay);
+			while ((sem_timedwait(&replay_wakeup, &timeout) == -1) && (errno == EINTR));
+		}
+	}
+
+	close_adapter_session(&session);
+	return NULL;
+}
+
+
+/* opens the spool of undelivered requests and starts the replay thread */
+static int init_request_spool(context_t* context)
+{
+	int result = NEB_ERROR;
+
+	if ((request_spool = request_spool_open(spool_path, spool_size)) == NULL) {
+		logging(LOG_ERROR, context, "Cannot open spool file %s", spool_path);
+	} else if (sem_init(&replay_wakeup, 0, 0) == -1) {
+		logging(LOG_ERROR, context, "Cannot create replay semaphore");
+	} else if (pthread_create(&replay_thread, NULL, replay_thread_loop, NULL) != 0) {
+		logging(LOG_ERROR, context, "Cannot start replay thread");
+		sem_destroy(&replay_wakeup);
+	} else {
+		logging(LOG_INFO, context, "Undelivered requests will be spooled to %s (%lu requests found, replay rate %lu/s)",
+		        spool_path, (unsigned long) request_spool_count(request_spool), (unsigned long) replay_rate);
+		result = NEB_OK;
+	}
+
+	if ((result != NEB_OK) && (request_spool != NULL)) {
+		request_spool_close(request_spool);
+		request_spool = NULL;
+	}
+
+	return result;
+}
+
+
+/* gets the first batch (if any) full or, unless only full ones are wanted, expired or not empty when stopping */
+static batch_t* ready_batch(batch_t* batches, int full)
+{
+	struct timespec	now;
+	size_t		i;
+	int		stopped = !full && __atomic_load_n(&sender_stopped, __ATOMIC_ACQUIRE);
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	for (i = 0; i < endpoint_count; i++) {
+		if ((batches[i].count >= batch_size) || (!full && (batches[i].count > 0)
+		    && (stopped || (timespec_cmp(&now, &batches[i].deadline) >= 0)))) {
+			return &batches[i];
+		}
+	}
+	return NULL;
+}
+
+
+/* gets next request to send: either a queued one, or a batch (one per endpoint) once full or expired */
+static int next_request(batch_t* batches, adapter_request_t* request)
+{
+	adapter_request_t item;
+	batch_t*	batch;
+
+	if (batches == NULL) {
+		return request_queue_pop(request_queue, request);
+	}
+
+	while (((batch = ready_batch(batches, 1)) == NULL) && (request_queue_pop(request_queue, &item) == 0)) {
+		if (append_to_batch(&batches[item.endpoint], &item) != NEB_OK) {
+			context_t context = { .corr = item.corr, .op = "NGSIAdapter" };
+			logging(LOG_WARN, &context, "Cannot add request to batch: discarding it");
+		}
+		free(item.url);
+		free(item.body);
+	}
+
+	if ((batch == NULL) && ((batch = ready_batch(batches, 0)) == NULL)) {
+		return -1;
+	} else {
+		context_t context = { .corr = batch->corr, .op = "NGSIAdapter" };
+		logging(LOG_DEBUG, &context, "Sending batch of %lu requests", (unsigned long) batch->count);
+		request->endpoint = (size_t) (batch - batches);
+		request->url  = STRDUP(endpoints[request->endpoint].batch_url);
+		request->body = batch->buffer;
+		strcpy(request->corr, batch->corr);
+		batch->buffer   = NULL;
+		batch->length   = 0;
+		batch->capacity = 0;
+		batch->count    = 0;
+		return 0;
+	}
+}
+
+
+/* gets a copy of the entries of adapter hosts, unless already loaded into the shared DNS cache since resolved
+ * (entries may be updated by the refresh thread of ::endpoint_dns while the request is in progress) */
+static struct curl_slist* get_endpoint_hosts(void)
+{
+	struct curl_slist*	hosts = NULL;
+	size_t			i;
+
+	if ((endpoint_dns == NULL) || __atomic_exchange_n(&endpoint_seeded, 1, __ATOMIC_ACQ_REL)) {
+		return NULL;
+	}
+	pthread_mutex_lock(&endpoint_mutex);
+	for (i = 0; i < endpoint_count; i++) {
+		if (*endpoints[i].resolve) {
+			hosts = curl_slist_append(hosts, endpoints[i].resolve);
+		}
+	}
+	pthread_mutex_unlock(&endpoint_mutex);
+	return hosts;
+}
+
+
+/* sets the options of a session for a request (streaming its body with given reader, if given as parts), whose
+ * headers are kept in given storage, returning the adapter hosts loaded into the shared DNS cache (if so) to be
+ * freed once completed */
+static void setup_adapter_request(CURL* session, const adapter_request_t* request, body_reader_t* reader,
+                                  request_headers_t* headers, struct curl_slist** hosts)
+{
+	snprintf(headers->corr, sizeof(headers->corr), "%s: %s", CORRELATOR_HTTP_HEADER, request->corr);
+	headers->list[0].data = (char*) "Content-Type: text/plain";
+	headers->list[0].next = &headers->list[1];
+	headers->list[1].data = headers->corr;
+	headers->list[1].next = NULL;
+
+	curl_easy_setopt(session, CURLOPT_URL, request->url);
+	*hosts = NULL;
+#if (LIBCURL_VERSION_NUM >= 0x074B00)
+	/* adapter hosts are loaded into the shared DNS cache by the first transfer after being resolved */
+	*hosts = get_endpoint_hosts();
+	curl_easy_setopt(session, CURLOPT_RESOLVE, *hosts);
+#endif
+	curl_easy_setopt(session, CURLOPT_POST, 1L);
+	curl_easy_setopt(session, CURLOPT_POSTFIELDS, request->body);
+	curl_easy_setopt(session, CURLOPT_POSTFIELDSIZE, (long) body_length(request));
+	if (request->body == NULL) {
+		init_body_reader(reader, request);
+		curl_easy_setopt(session, CURLOPT_READFUNCTION, read_body_callback);
+		curl_easy_setopt(session, CURLOPT_READDATA, reader);
+		curl_easy_setopt(session, CURLOPT_SEEKFUNCTION, seek_body_callback);
+		curl_easy_setopt(session, CURLOPT_SEEKDATA, reader);
+	}
+	curl_easy_setopt(session, CURLOPT_HTTPHEADER, headers->list);
+}
+
+
+/* logs the result of a request, discarding the session if failed */
+static int check_adapter_result(const adapter_request_t* request, CURL** session, CURLcode curl_result,
+                                context_t* context)
+{
+	int	result = NEB_OK;
+	long	status = 0;
+
+	if (curl_result == CURLE_OK) {
+		curl_easy_getinfo(*session, CURLINFO_RESPONSE_CODE, &status);
+	}
+	if ((curl_result == CURLE_OK) && (status < 500)) {
+		logging(LOG_INFO, context, "Request sent to %s",
+		        request->url);
+	} else if (curl_result == CURLE_OK) {
+		/* adapter failed to process the request: connection is kept, though */
+		logging(LOG_WARN, context, "Request to %s failed: HTTP status %ld",
+		        request->url, status);
+		result = NEB_ERROR;
+	} else {
+		/* discard session, so that a new connection is made next time */
+		logging(LOG_WARN, context, "Request to %s failed: %s",
+		        request->url, curl_easy_strerror(curl_result));
+		close_adapter_session(session);
+		result = NEB_ERROR;
+	}
+
+	return result;
+}
+
+
+/* updates the limit of requests in flight once a window of as many completed requests as the limit is over */
+static void update_concurrency(concurrency_t* control, double latency, int failed)
+{
+	size_t		limit   = control->limit;
+	context_t	context = { .op = "NGSIAdapter" };
+	double		average;
+
+	control->samples++;
+	control->errors  += (failed) ? 1 : 0;
+	control->latency += latency;
+	if ((inflight_min == 0) || (control->samples < control->limit)) {
+		return;
+	}
+
+	average = control->latency / control->samples;
+	if ((control->baseline == 0) || (average < control->baseline)) {
+		control->baseline = average;
+	} else {
+		control->baseline += (average - control->baseline) * BASELINE_DRIFT;
+	}
+
+	/* multiplicative decrease on errors or latency rise, additive increase if limit was reached */
+	if (control->errors > 0) {
+		limit /= 2;
+		control->slow_start = 0;
+	} else if (average > control->baseline * LATENCY_TOLERANCE) {
+		limit -= limit / 4;
+		control->slow_start = 0;
+	} else if (control->saturated) {
+		limit += (control->slow_start) ? limit : 1;
+	}
+	if (limit < inflight_min) limit = inflight_min;
+	if (limit > inflight_limit) limit = inflight_limit;
+
+	logging((limit != control->limit) ? LOG_INFO : LOG_DEBUG, &context,
+	        "Concurrency limit %lu -> %lu (latency %.1f ms, baseline %.1f ms, %lu/%lu requests failed)",
+	        (unsigned long) control->limit, (unsigned long) limit, average * 1000, control->baseline * 1000,
+	        (unsigned long) control->errors, (unsigned long) control->samples);
+	control->limit     = limit;
+	control->samples   = 0;
+	control->errors    = 0;
+	control->latency   = 0;
+	control->saturated = 0;
+}
+
+
+/* starts a transfer of a concurrent sender thread */
+static int start_transfer(CURLM* multi, transfer_t* transfer)
+{
+	int		result  = NEB_ERROR;
+	context_t	context = { .corr = transfer->request.corr, .op = "NGSIAdapter" };
+
+	if (transfer->request.body == NULL) {
+		/* bodies are joined when queued, as there is no reader to stream them from parts */
+		logging(LOG_WARN, &context, "Request to %s skipped: body not available", transfer->request.url);
+	} else if (!breaker_allows(&endpoints[transfer->request.endpoint].breaker, &context)) {
+		logging(LOG_DEBUG, &context, "Request to %s skipped: adapter unavailable", transfer->request.url);
+	} else if (open_adapter_session(&transfer->session, &context) != NEB_OK) {
+		breaker_update(&endpoints[transfer->request.endpoint].breaker, 0, &context);
+	} else {
+		setup_adapter_request(transfer->session, &transfer->request, NULL, &transfer->headers, &transfer->hosts);
+		curl_easy_setopt(transfer->session, CURLOPT_PRIVATE, transfer);
+		if (curl_multi_add_handle(multi, transfer->session) == CURLM_OK) {
+			transfer->busy = 1;
+			result = NEB_OK;
+		} else {
+			logging(LOG_WARN, &context, "Request to %s could not be started", transfer->request.url);
+			breaker_update(&endpoints[transfer->request.endpoint].breaker, 0, &context);
+		}
+	}
+
+	if (result != NEB_OK) {
+		spool_adapter_request(&transfer->request, &context);
+		curl_slist_free_all(transfer->hosts);
+		transfer->hosts = NULL;
+		free(transfer->request.url);
+		free(transfer->request.body);
+	}
+
+	return result;
+}
+
+
+/* completes a transfer of a concurrent sender thread */
+static void finish_transfer(CURLM* multi, transfer_t* transfer, CURLcode curl_result)
+{
+	context_t context = { .corr = transfer->request.corr, .op = "NGSIAdapter" };
+
+	curl_multi_remove_handle(multi, transfer->session);
+	if (check_adapter_result(&transfer->request, &transfer->session, curl_result, &context) != NEB_OK) {
+		breaker_update(&endpoints[transfer->request.endpoint].breaker, 0, &context);
+		spool_adapter_request(&transfer->request, &context);
+	} else {
+		breaker_update(&endpoints[transfer->request.endpoint].breaker, 1, &context);
+	}
+	curl_slist_free_all(transfer->hosts);
+	transfer->hosts = NULL;
+	free(transfer->request.url);
+	free(transfer->request.body);
+	transfer->busy = 0;
+}
+
+
+/* creates the batches of a sender thread, one per endpoint (NULL if requests are not batched) */
+static batch_t* create_batches(void)
+{
+	batch_t* batches = NULL;
+
+	if ((batch_size > 1) && !udp_transport
+	    && ((batches = (batch_t*) calloc(endpoint_count, sizeof(batch_t))) == NULL)) {
+		context_t context = { .op = "NGSIAdapter" };
+		logging(LOG_WARN, &context, "Cannot allocate batches: sending one request at a time");
+	}
+	return batches;
+}
+
+
+/* frees the batches of a sender thread */
+static void free_batches(batch_t* batches)
+{
+	size_t i;
+
+	for (i = 0; batches && (i < endpoint_count); i++) {
+		free(batches[i].buffer);
+	}
+	free(batches);
+}
+
+
+/* sender thread: sends queued requests until stopped and queue is empty */
+static void* sender_thread(void* arg)
+{
+	adapter_request_t	request;
+	batch_t*		pending	= create_batches();
+	CURL*			session = NULL;
+	context_t		context = { .corr = request.corr, .op = "NGSIAdapter" };
+
+	for (;;) {
+		if (next_request(pending, &request) == 0) {
+			if (send_adapter_request(&request, &session, &context) != NEB_OK) {
+				spool_adapter_request(&request, &context);
+			}
+			free(request.url);
+			free(request.body);
+		} else if (__atomic_load_n(&sender_stopped, __ATOMIC_ACQUIRE)) {
+			break;
+		} else {
+			wait_for_requests(pending);
+		}
+	}
+
+	close_adapter_session(&session);
+	free_batches(pending);
+	return NULL;
+}
+
+
+/* concurrent sender thread: keeps up to ::inflight_limit requests in progress */
+static void* multi_sender_thread(void* arg)
+{
+	CURLM*		multi     = NULL;
+	transfer_t*	transfers = NULL;
+	batch_t*	pending   = NULL;
+	concurrency_t	control   = { .limit = (inflight_min) ? inflight_min : inflight_limit, .slow_start = 1 };
+	size_t		active    = 0;
+	size_t		i;
+
+	if (((multi = curl_multi_init()) == NULL)
+	    || ((transfers = (transfer_t*) calloc(inflight_limit, sizeof(transfer_t))) == NULL)) {
+		context_t context = { .op = "NGSIAdapter" };
+		logging(LOG_WARN, &context, "Cannot start concurrent sender: sending one request at a time");
+		if (multi != NULL) curl_multi_cleanup(multi);
+		return sender_thread(arg);
+	}
+
+	pending = create_batches();
+	curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long) inflight_limit);
+	for (;;) {
+		CURLMsg*	msg;
+		int		msgs, running = 0;
+
+		/* fill in free slots with queued requests */
+		for (i = 0; (i < inflight_limit) && (active < control.limit); i++) {
+			if (transfers[i].busy) {
+				continue;
+			} else if (next_request(pending, &transfers[i].request) != 0) {
+				break;
+			} else if (start_transfer(multi, &transfers[i]) == NEB_OK) {
+				active++;
+			}
+		}
+		if (active >= control.limit) {
+			control.saturated = 1;
+		}
+
+		if (active == 0) {
+			if (__atomic_load_n(&sender_stopped, __ATOMIC_ACQUIRE)) break;
+			wait_for_requests(pending);
+			continue;
+		}
+
+		/* progress transfers and complete those already done */
+		curl_multi_perform(multi, &running);
+		while ((msg = curl_multi_info_read(multi, &msgs)) != NULL) {
+			if (msg->msg == CURLMSG_DONE) {
+				transfer_t*	transfer    = NULL;
+				CURLcode	curl_result = msg->data.result;
+				double		latency     = 0;
+				long		status      = 0;
+				curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**) &transfer);
+				curl_easy_getinfo(msg->easy_handle, CURLINFO_TOTAL_TIME, &latency);
+				curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &status);
+				update_concurrency(&control, latency, (curl_result != CURLE_OK) || (status >= 500));
+				finish_transfer(multi, transfer, curl_result);
+				active--;
+			}
+		}
+		if (running > 0) {
+			curl_multi_wait(multi, NULL, 0, TRANSFER_WAIT_TIMEOUT, NULL);
+		}
+	}
+
+	for (i = 0; i < inflight_limit; i++) {
+		close_adapter_session(&transfers[i].session);
+	}
+	free(transfers);
+	free_batches(pending);
+	curl_multi_cleanup(multi);
+	return NULL;
+}
+
+
+/* sets up adapter endpoints from ::adapter_urls, opening their UDP sockets if so */
+static int init_endpoints(context_t* context)
+{
+	size_t	count = (adapter_url_count > 1) ? adapter_url_count : 1;
+	size_t	i;
+
+	if ((count > 1) && ((endpoints = (endpoint_t*) calloc(count, sizeof(endpoint_t))) == NULL)) {
+		logging(LOG_ERROR, context, "Cannot allocate adapter endpoints");
+		endpoints = &single_endpoint;
+		return NEB_ERROR;
+	}
+
+	endpoint_count = count;
+	udp_transport  = !strncmp(adapter_url, ADAPTER_UDP_SCHEME, strlen(ADAPTER_UDP_SCHEME));
+	for (i = 0; i < count; i++) {
+		endpoint_t* endpoint = &endpoints[i];
+		if (endpoint != &single_endpoint) {
+			pthread_mutex_init(&endpoint->breaker.mutex, NULL);
+			endpoint->breaker.state = BREAKER_CLOSED;
+			endpoint->udp_socket    = -1;
+		}
+		endpoint->url = (count > 1) ? adapter_urls[i] : adapter_url;
+		if (udp_transport != !strncmp(endpoint->url, ADAPTER_UDP_SCHEME, strlen(ADAPTER_UDP_SCHEME))) {
+			logging(LOG_ERROR, context, "Cannot mix UDP and HTTP adapter endpoints (%s)", endpoint->url);
+			return NEB_ERROR;
+		} else if (udp_transport && (open_udp_socket(endpoint, context) != NEB_OK)) {
+			return NEB_ERROR;
+		} else if (!udp_transport && (batch_size > 1)) {
+			endpoint->batch_url = (char*) malloc(strlen(endpoint->url) + sizeof(ADAPTER_BATCH_RESOURCE) + 1);
+			sprintf(endpoint->batch_url, "%s/%s", endpoint->url, ADAPTER_BATCH_RESOURCE);
+		}
+	}
+
+	if ((count > 1) && ((endpoint_ring = hash_ring_create((const char* const*) adapter_urls, count, HASH_RING_REPLICAS)) == NULL)) {
+		logging(LOG_ERROR, context, "Cannot create hash ring of adapter endpoints");
+		return NEB_ERROR;
+	} else if (count > 1) {
+		logging(LOG_INFO, context, "Requests will be distributed among %lu adapter endpoints by entity",
+		        (unsigned long) count);
+	}
+
+	return NEB_OK;
+}
+
+
+/* closes adapter endpoints, returning to a single one */
+static void free_endpoints(void)
+{
+	size_t i;
+
+	for (i = 0; i < endpoint_count; i++) {
+		endpoint_t* endpoint = &endpoints[i];
+		free(endpoint->batch_url);
+		endpoint->batch_url = NULL;
+		if (endpoint->udp_socket >= 0) {
+			close(endpoint->udp_socket);
+			endpoint->udp_socket = -1;
+		}
+		if (endpoint != &single_endpoint) {
+			pthread_mutex_destroy(&endpoint->breaker.mutex);
+		}
+	}
+	if (endpoints != &single_endpoint) {
+		free(endpoints);
+	}
+
+	hash_ring_free(endpoint_ring);
+	endpoint_ring  = NULL;
+	endpoints      = &single_endpoint;
+	endpoint_count = 1;
+	udp_transport  = 0;
+	single_endpoint.url = NULL;
+	single_endpoint.breaker.state    = BREAKER_CLOSED;
+	single_endpoint.breaker.failures = 0;
+}
+
+
+/* locks data shared by HTTP sessions */
+static void lock_share(CURL* session, curl_lock_data data, curl_lock_access access, void* userptr)
+{
+	pthread_mutex_lock(&share_locks[data]);
+}
+
+
+/* unlocks data shared by HTTP sessions */
+static void unlock_share(CURL* session, curl_lock_data data, void* userptr)
+{
+	pthread_mutex_unlock(&share_locks[data]);
+}
+
+
+/* resolves the host of an adapter endpoint, either to an IPv4 or IPv6 address (resolver of ::endpoint_dns) */
+static int resolve_endpoint_host(const char* hostname, char* addr, size_t addrmaxlen)
+{
+	int		result = -1;
+	struct addrinfo	hints, *list = NULL;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if ((getaddrinfo(hostname, NULL, &hints, &list) == 0) && (list != NULL)
+	    && (inet_ntop(list->ai_family,
+	                  (list->ai_family == AF_INET6)
+	                  ? (const void*) &((const struct sockaddr_in6*) list->ai_addr)->sin6_addr
+	                  : (const void*) &((const struct sockaddr_in*) list->ai_addr)->sin_addr,
+	                  addr, addrmaxlen) != NULL)) {
+		result = 0;
+	}
+	if (list != NULL) {
+		freeaddrinfo(list);
+	}
+
+	return result;
+}
+
+
+/* updates the `+host:port:address` entries of the endpoints of a resolved adapter host (listener of ::endpoint_dns),
+ * to be loaded again into the shared DNS cache by next request */
+static void update_endpoint_host(const char* hostname, const char* addr, void* arg)
+{
+	size_t i;
+
+	pthread_mutex_lock(&endpoint_mutex);
+	for (i = 0; i < endpoint_count; i++) {
+		endpoint_t* endpoint = &endpoints[i];
+		if ((endpoint->host != NULL) && !strcmp(endpoint->host, hostname)) {
+			snprintf(endpoint->resolve, sizeof(endpoint->resolve), strchr(addr, ':') ? "+%s:%ld:[%s]" : "+%s:%ld:%s",
+			         hostname, endpoint->port, addr);
+		}
+	}
+	__atomic_store_n(&endpoint_seeded, 0, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&endpoint_mutex);
+}
+
+
+/* watches the host of an HTTP endpoint in ::endpoint_dns, so that its entry is kept up to date */
+static void watch_endpoint_host(endpoint_t* endpoint, context_t* context)
+{
+	const char*	target	= strstr(endpoint->url, "://");
+	const char*	end;
+	const char*	port;
+	size_t		len;
+
+	/* find host and port (if any) of the URL, removing brackets from IPv6 literal addresses */
+	target = (target) ? target + 3 : endpoint->url;
+	if (*target == '[') {
+		end  = strchr(++target, ']');
+		port = (end && (end[1] == ':')) ? end + 2 : NULL;
+	} else {
+		end  = target + strcspn(target, ":/?");
+		port = (*end == ':') ? end + 1 : NULL;
+	}
+	if ((end == NULL) || ((len = end - target) == 0) || (len >= NI_MAXHOST)
+	    || ((endpoint->host = (char*) malloc(len + 1)) == NULL)) {
+		return;
+	}
+	strncpy(endpoint->host, target, len);
+	endpoint->host[len] = '\0';
+	endpoint->port = (port) ? strtol(port, NULL, 10) : (strncmp(endpoint->url, "https:", 6) ? 80L : 443L);
+
+	if (dns_cache_watch(endpoint_dns, endpoint->host, update_endpoint_host, NULL) != 0) {
+		logging(LOG_WARN, context, "Cannot resolve adapter host %s (will retry in background)", endpoint->host);
+	} else {
+		logging(LOG_DEBUG, context, "Adapter host %s resolved (%s)", endpoint->host, endpoint->resolve);
+	}
+}
+
+
+/* creates the caches shared by HTTP sessions, resolving the hosts of adapter endpoints */
+static int init_adapter_share(context_t* context)
+{
+	size_t i;
+
+	if ((adapter_share = curl_share_init()) == NULL) {
+		logging(LOG_ERROR, context, "Cannot create DNS cache shared by HTTP sessions");
+		return NEB_ERROR;
+	}
+	for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+		pthread_mutex_init(&share_locks[i], NULL);
+	}
+	curl_share_setopt(adapter_share, CURLSHOPT_LOCKFUNC, lock_share);
+	curl_share_setopt(adapter_share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+	curl_share_setopt(adapter_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(adapter_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+#if (LIBCURL_VERSION_NUM >= 0x074B00)
+	/* resolve adapter hosts again halfway through the lifetime of their entries in the shared DNS cache */
+	endpoint_seeded = 0;
+	if ((adapter_socket == NULL)
+	    && ((endpoint_dns = dns_cache_create(((dns_ttl) ? dns_ttl : SHARE_DNS_TIMEOUT) * 500,
+	                                         ((dns_ttl) ? dns_ttl : SHARE_DNS_TIMEOUT) * 500,
+	                                         resolve_endpoint_host)) == NULL)) {
+		logging(LOG_WARN, context, "Cannot create DNS cache of adapter hosts");
+	}
+	for (i = 0; (i < endpoint_count) && (endpoint_dns != NULL); i++) {
+		watch_endpoint_host(&endpoints[i], context);
+	}
+#endif
+
+	return NEB_OK;
+}
+
+
+/* releases the caches shared by HTTP sessions (once all of them are closed) */
+static void free_adapter_share(void)
+{
+	size_t i;
+
+	if (adapter_share != NULL) {
+		curl_share_cleanup(adapter_share);
+		adapter_share = NULL;
+		for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+			pthread_mutex_destroy(&share_locks[i]);
+		}
+	}
+
+	/* stop refreshing adapter hosts before endpoints are closed */
+	dns_cache_free(endpoint_dns);
+	endpoint_dns = NULL;
+	for (i = 0; i < endpoint_count; i++) {
+		free(endpoints[i].host);
+		endpoints[i].host = NULL;
+		*endpoints[i].resolve = '\0';
+	}
+}
+
+
+/* starts sender threads */
+int init_adapter_senders(context_t* context)
+{
+	int	result = NEB_OK;
+	size_t	i;
+
+	sender_stopped = 0;
+	if (init_endpoints(context) != NEB_OK) {
+		result = NEB_ERROR;
+	} else if ((spool_path != NULL) && !udp_transport && (init_request_spool(context) != NEB_OK)) {
+		result = NEB_ERROR;
+	} else if (!udp_transport && (init_adapter_share(context) != NEB_OK)) {
+		result = NEB_ERROR;
+	} else if (queue_size == 0) {
+		logging(LOG_DEBUG, context, "Requests will be sent synchronously");
+		if (!udp_transport && (open_adapter_session(&sync_session, context) != NEB_OK)) {
+			logging(LOG_WARN, context, "HTTP session will be opened on first request");
+		}
+	} else if ((request_queue = request_queue_create(queue_size, sizeof(adapter_request_t))) == NULL) {
+		logging(LOG_ERROR, context, "Cannot create request queue");
+		result = NEB_ERROR;
+	} else if (sem_init(&request_count, 0, 0) == -1) {
+		logging(LOG_ERROR, context, "Cannot create request queue semaphore");
+		request_queue_free(request_queue);
+		request_queue = NULL;
+		result = NEB_ERROR;
+	} else if ((sender_threads = (pthread_t*) calloc(sender_count, sizeof(pthread_t))) == NULL) {
+		logging(LOG_ERROR, context, "Cannot allocate sender threads");
+		result = NEB_ERROR;
+	} else {
+		if (udp_transport && ((batch_size > 1) || (inflight_limit > 1))) {
+			logging(LOG_INFO, context, "Every request will be sent as a single datagram (options -b and -n ignored)");
+		} else if (batch_size > 1) {
+			logging(LOG_INFO, context, "Requests will be sent to %s in batches of %lu (max delay %lu ms)",
+			        endpoints[0].batch_url, (unsigned long) batch_size, (unsigned long) batch_delay);
+		}
+		request_dropped = 0;
+		for (i = 0; i < sender_count; i++) {
+			if (pthread_create(&sender_threads[i], NULL,
+			                   ((inflight_limit > 1) && !udp_transport) ? multi_sender_thread : sender_thread,
+			                   NULL) != 0) {
+				logging(LOG_ERROR, context, "Cannot start sender thread #%lu", (unsigned long) i);
+				result = NEB_ERROR;
+				break;
+			}
+			sender_running++;
+		}
+		if (result == NEB_OK) {
+			logging(LOG_INFO, context, "Started %lu sender threads (queue size %lu, %s, %lu%s requests in flight each)",
+			        (unsigned long) sender_running, (unsigned long) request_queue_capacity(request_queue),
+			        overflow_policy_names[overflow_policy],
+			        (unsigned long) (((inflight_limit > 1) && !udp_transport) ? inflight_limit : 1),
+			        ((inflight_limit > 1) && !udp_transport && inflight_min) ? " max adaptive" : "");
+		}
+	}
+
+	if ((result == NEB_OK) && (spool_path != NULL) && udp_transport) {
+		logging(LOG_INFO, context, "Requests sent as datagrams are never spooled (option -s ignored)");
+	}
+
+	return result;
+}
+
+
+/* stops sender threads */
+int free_adapter_senders(void)
+{
+	size_t	i;
+
+	if (request_queue != NULL) {
+		adapter_request_t request;
+
+		/* awake threads and wait for them to send pending requests */
+		__atomic_store_n(&sender_stopped, 1, __ATOMIC_RELEASE);
+		for (i = 0; i < sender_running; i++) {
+			sem_post(&request_count);
+		}
+		for (i = 0; i < sender_running; i++) {
+			pthread_join(sender_threads[i], NULL);
+		}
+
+		/* spool (or discard) requests not sent (only if no threads were started) */
+		while (request_queue_pop(request_queue, &request) == 0) {
+			context_t context = { .corr = request.corr, .op = "Exit" };
+			spool_adapter_request(&request, &context);
+			free(request.url);
+			free(request.body);
+		}
+
+		sem_destroy(&request_count);
+		request_queue_free(request_queue);
+		request_queue = NULL;
+	}
+
+	/* stop replaying spooled requests (those not yet replayed are kept for next run) */
+	if (request_spool != NULL) {
+		__atomic_store_n(&sender_stopped, 1, __ATOMIC_RELEASE);
+		sem_post(&replay_wakeup);
+		pthread_join(replay_thread, NULL);
+		sem_destroy(&replay_wakeup);
+		request_spool_close(request_spool);
+		request_spool = NULL;
+	}
+
+	free(sender_threads);
+	sender_threads = NULL;
+	sender_running = 0;
+	close_adapter_session(&sync_session);
+	free_adapter_share();
+	free_endpoints();
+	return NEB_OK;
+}
+
+
+/* dispatches a request, either sending it synchronously or queueing it */
+int dispatch_adapter_request(adapter_request_t* request, context_t* context)
+{
+	int result = NEB_OK;
+
+	route_adapter_request(request);
+	if (request_queue == NULL) {
+		if ((result = send_adapter_request(request, &sync_session, context)) != NEB_OK) {
+			spool_adapter_request(request, context);
+		}
+		free(request->url);
+		request->url = NULL;
+	} else {
+		adapter_request_t item = *request;
+
+		item.body  = (request->body) ? STRDUP(request->body) : join_body(request);
+		request->url = NULL;
+
+		/* sender threads cannot stream bodies from parts: if not joined, spool request or discard it */
+		if (item.body == NULL) {
+			item.body = request->body;	/* still owned by caller */
+			if (spool_adapter_request(&item, context) == NEB_OK) {
+				logging(LOG_WARN, context, "Cannot allocate body of request to %s: spooling request", item.url);
+			} else {
+				logging(LOG_WARN, context, "Cannot allocate body of request to %s: discarding request (%lu discarded so far)",
+				        item.url, ++request_dropped);
+				result = NEB_ERROR;
+			}
+			free(item.url);
+			return result;
+		}
+		item.parts = NULL;
+		item.part_count = 0;
+
+		/* make room for the new request if older ones are to be discarded */
+		if (overflow_policy == OVERFLOW_DROP_OLD) {
+			adapter_request_t oldest;
+			while (request_queue_push(request_queue, &item) == -1) {
+				if (request_queue_pop(request_queue, &oldest) == 0) {
+					sem_trywait(&request_count);
+					if (spool_adapter_request(&oldest, context) == NEB_OK) {
+						logging(LOG_WARN, context, "Request queue full: spooling oldest request %s",
+						        oldest.corr);
+					} else {
+						logging(LOG_WARN, context, "Request queue full: discarding oldest request %s (%lu discarded so far)",
+						        oldest.corr, ++request_dropped);
+					}
+					free(oldest.url);
+					free(oldest.body);
+				}
+			}
+			sem_post(&request_count);
+		} else if (request_queue_push(request_queue, &item) == 0) {
+			sem_post(&request_count);
+		} else if (spool_adapter_request(&item, context) == NEB_OK) {
+			logging(LOG_WARN, context, "Request queue full: spooling request");
+			free(item.url);
+			free(item.body);
+		} else {
+			logging(LOG_WARN, context, "Request queue full: discarding request (%lu discarded so far)",
+			        ++request_dropped);
+			free(item.url);
+			free(item.body);
+			result = NEB_ERROR;
+		}
+	}
+
+	return result;
+}
+
+
+/* opens a persistent HTTP session to NGSI Adapter, unless already open */
+int open_adapter_session(CURL** session, context_t* context)
+{
+	int result = NEB_OK;
+
+	if (*session != NULL) {
+		/* nothing to do: reuse session */
+	} else if ((*session = curl_easy_init()) == NULL) {
+		logging(LOG_ERROR, context, "Cannot open HTTP session");
+		result = NEB_ERROR;
+	} else {
+		curl_easy_setopt(*session, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(*session, CURLOPT_TCP_KEEPALIVE, 1L);
+		curl_easy_setopt(*session, CURLOPT_POST, 1L);
+		curl_easy_setopt(*session, CURLOPT_DNS_CACHE_TIMEOUT, (long) ((dns_ttl) ? dns_ttl : SHARE_DNS_TIMEOUT));
+		if (adapter_share != NULL) {
+			curl_easy_setopt(*session, CURLOPT_SHARE, adapter_share);
+		}
+#if (LIBCURL_VERSION_NUM >= 0x072800)
+		if (adapter_socket != NULL) {
+			curl_easy_setopt(*session, CURLOPT_UNIX_SOCKET_PATH, adapter_socket);
+		}
+#endif
+	}
+
+	return result;
+}
+
+
+/* closes a persistent HTTP session to NGSI Adapter */
+void close_adapter_session(CURL** session)
+{
+	if (*session != NULL) {
+		curl_easy_cleanup(*session);
+		*session = NULL;
+	}
+}
+
+
+/* sends a request to NGSI Adapter, either as a UDP datagram or reusing (or opening) a persistent HTTP session */
+int send_adapter_request(const adapter_request_t* request, CURL** session, context_t* context)
+{
+	int			result		= NEB_ERROR;
+	request_headers_t	curl_headers;
+	struct curl_slist*	curl_hosts	= NULL;
+	body_reader_t		reader;
+
+	breaker_t*		breaker		= &endpoints[request->endpoint].breaker;
+
+	if (udp_transport) {
+		result = send_adapter_datagram(request, context);
+	} else if (!breaker_allows(breaker, context)) {
+		logging(LOG_DEBUG, context, "Request to %s skipped: adapter unavailable", request->url);
+	} else {
+		if (open_adapter_session(session, context) == NEB_OK) {
+			setup_adapter_request(*session, request, &reader, &curl_headers, &curl_hosts);
+			result = check_adapter_result(request, session, curl_easy_perform(*session), context);
+			curl_slist_free_all(curl_hosts);
+		}
+		breaker_update(breaker, result == NEB_OK, context);
+	}
+
+	return result;
+}
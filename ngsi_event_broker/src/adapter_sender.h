@@ -0,0 +1,136 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   adapter_sender.h
+ * @brief  Delivery of requests to NGSI Adapter (macros and declarations)
+ *
+ * This file declares the functions used by the [Event Broker](@NagiosModule_ref)
+ * to deliver requests to NGSI Adapter, either synchronously from the Nagios
+ * main thread or asynchronously through a queue drained by sender threads.
+ */
+
+
+#ifndef ADAPTER_SENDER_H
+#define ADAPTER_SENDER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "curl/curl.h"
+#include "ngsi_event_broker_common.h"
+
+
+/** Piece of a request body */
+typedef struct adapter_body_part {
+	const char*	data;			/**< The contents (null taken as empty) */
+	int		escaped;		/**< Whether newlines and backslashes are escaped (as in Nagios long output) */
+} adapter_body_part_t;
+
+
+/** Request to NGSI Adapter */
+typedef struct adapter_request {
+	char*				url;			/**< The request URL (including query string) */
+	char*				body;			/**< The request body (plugin output and perfdata), or null if given as parts */
+	const adapter_body_part_t*	parts;			/**< The pieces of the body, when not given as a single string */
+	size_t				part_count;		/**< The number of pieces of the body */
+	char				corr[CORRELATOR_LEN+1];	/**< The correlator of the request */
+	size_t				endpoint;		/**< The index of the adapter endpoint (see ::adapter_urls) */
+} adapter_request_t;
+
+
+/**
+ * Starts sender threads (only if requests are to be queued, see ::queue_size)
+ *
+ * @param[in] context			The operations context (may be null).
+ *
+ * @retval NEB_OK			Successfully started.
+ * @retval NEB_ERROR			Not successfully started.
+ */
+int init_adapter_senders(context_t* context);
+
+
+/**
+ * Stops sender threads, once all queued requests are sent
+ *
+ * @retval NEB_OK			Success.
+ */
+int free_adapter_senders(void);
+
+
+/**
+ * Dispatches a request to NGSI Adapter, either sending it immediately or queueing it
+ *
+ * When several adapter endpoints are given, the request is first routed to one
+ * of them according to the entity id in its query string (consistent hashing).
+ *
+ * A body given as parts is streamed from them when sent immediately (unescaping
+ * them as needed, and skipping empty lines), and only joined into a single copy
+ * when the request is queued or spooled.
+ *
+ * @param[in] request			The request (ownership of the URL is taken, body is copied if needed).
+ * @param[in] context			The operations context (may be null).
+ *
+ * @retval NEB_OK			Successfully sent or queued.
+ * @retval NEB_ERROR			Request failed or was discarded.
+ */
+int dispatch_adapter_request(adapter_request_t* request, context_t* context);
+
+
+/**
+ * Opens a persistent HTTP session to NGSI Adapter, unless already open
+ *
+ * @param[in,out] session		The session handle (opened if null).
+ * @param[in] context			The operations context (may be null).
+ *
+ * @retval NEB_OK			Session is open.
+ * @retval NEB_ERROR			Session could not be opened.
+ */
+int open_adapter_session(CURL** session, context_t* context);
+
+
+/**
+ * Closes a persistent HTTP session to NGSI Adapter
+ *
+ * @param[in,out] session		The session handle (set to null).
+ */
+void close_adapter_session(CURL** session);
+
+
+/**
+ * Sends a request to NGSI Adapter (HTTP POST) using a persistent session
+ *
+ * @param[in] request			The request.
+ * @param[in,out] session		The session handle (opened if null, closed on failure).
+ * @param[in] context			The operations context (may be null).
+ *
+ * @retval NEB_OK			Successfully sent.
+ * @retval NEB_ERROR			Request failed.
+ */
+int send_adapter_request(const adapter_request_t* request, CURL** session, context_t* context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*ADAPTER_SENDER_H*/
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   arena.c
+ * @brief  Arena allocator implementation
+ *
+ * This file consists of the implementation of the arena allocator: memory is
+ * taken by just moving forward a pointer within the current buffer, and only
+ * when it is exhausted a new chunk (as large as needed) is taken from heap.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+
+/* alignment of allocated memory */
+#define ALIGNMENT		(sizeof(long double) > sizeof(void*) ? sizeof(long double) : sizeof(void*))
+
+
+/* heap chunk, followed by its buffer */
+struct arena_chunk {
+	struct arena_chunk*	next;
+	long double		align[];
+};
+
+
+/* initializes an empty arena */
+arena_t* arena_init(arena_t* arena, void* buffer, size_t size)
+{
+	arena->buffer       = arena->initial      = (char*) buffer;
+	arena->size         = arena->initial_size = (buffer) ? size : 0;
+	arena->used         = 0;
+	arena->chunks       = NULL;
+	return arena;
+}
+
+
+/* releases all the memory allocated from an arena */
+void arena_reset(arena_t* arena)
+{
+	while (arena->chunks != NULL) {
+		arena_chunk_t* chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	arena->buffer = arena->initial;
+	arena->size   = arena->initial_size;
+	arena->used   = 0;
+}
+
+
+/* allocates memory from an arena */
+void* arena_alloc(arena_t* arena, size_t size)
+{
+	size_t	offset = (((size_t) arena->buffer + arena->used + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+	               - (size_t) arena->buffer;
+	void*	result = NULL;
+
+	if ((arena->buffer != NULL) && (offset <= arena->size) && (size <= arena->size - offset)) {
+		result = arena->buffer + offset;
+		arena->used = offset + size;
+	} else {
+		size_t		chunk_size = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+		arena_chunk_t*	chunk;
+		if ((chunk = (arena_chunk_t*) malloc(sizeof(arena_chunk_t) + chunk_size)) != NULL) {
+			chunk->next   = arena->chunks;
+			arena->chunks = chunk;
+			arena->buffer = (char*) chunk->align;
+			arena->size   = chunk_size;
+			arena->used   = size;
+			result        = arena->buffer;
+		}
+	}
+
+	return result;
+}
+
+
+/* copies a string into an arena */
+char* arena_strdup(arena_t* arena, const char* str)
+{
+	char*	result = NULL;
+	size_t	len;
+
+	if ((str != NULL) && ((result = (char*) arena_alloc(arena, (len = strlen(str)) + 1)) != NULL)) {
+		memcpy(result, str, len + 1);
+	}
+
+	return result;
+}
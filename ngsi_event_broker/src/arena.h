@@ -0,0 +1,113 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   arena.h
+ * @brief  Arena allocator macros and declarations
+ *
+ * This file declares a bump-pointer allocator for the transient strings used
+ * by the [Event Broker](@NagiosModule_ref) to process a single check result.
+ * Memory is taken from a caller-provided buffer (usually on the stack) and, if
+ * exhausted, from heap chunks; it is never released but all at once, when the
+ * arena is reset.
+ */
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Suggested size in bytes of the buffer of an arena (enough for a check result) */
+#define ARENA_BUFFER_SIZE		4096
+
+
+/** Minimum size in bytes of the heap chunks taken once the buffer is exhausted */
+#define ARENA_CHUNK_SIZE		4096
+
+
+/** Heap chunk of an arena */
+typedef struct arena_chunk arena_chunk_t;
+
+
+/** Arena allocator */
+typedef struct {
+	char*		buffer;		/**< Current buffer (caller-provided or last chunk) */
+	size_t		size;		/**< Size of current buffer */
+	size_t		used;		/**< Bytes used in current buffer */
+	char*		initial;	/**< Caller-provided buffer */
+	size_t		initial_size;	/**< Size of caller-provided buffer */
+	arena_chunk_t*	chunks;		/**< Heap chunks taken (the last one first) */
+} arena_t;
+
+
+/**
+ * Initializes an empty arena
+ *
+ * @param[out] arena		The arena.
+ * @param[in]  buffer		The buffer to allocate from before taking heap chunks (may be null).
+ * @param[in]  size		The size of the buffer.
+ *
+ * @return			The arena.
+ */
+arena_t* arena_init(arena_t* arena, void* buffer, size_t size);
+
+
+/**
+ * Releases all the memory allocated from an arena (heap chunks included)
+ *
+ * @param[in] arena		The arena.
+ */
+void arena_reset(arena_t* arena);
+
+
+/**
+ * Allocates memory from an arena (suitably aligned for any type)
+ *
+ * @param[in] arena		The arena.
+ * @param[in] size		The size in bytes.
+ *
+ * @return			The memory (valid until the arena is reset), or NULL on errors.
+ */
+void* arena_alloc(arena_t* arena, size_t size);
+
+
+/**
+ * Copies a string into an arena
+ *
+ * @param[in] arena		The arena.
+ * @param[in] str		The string (may be null).
+ *
+ * @return			The copy (valid until the arena is reset), or NULL on errors or null string.
+ */
+char* arena_strdup(arena_t* arena, const char* str);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*ARENA_H*/
@@ -26,62 +26,188 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include "arena.h"
 #include "argument_parser.h"
 
 
-/* maximum number of args */
-#define MAX_ARGS	255
+/* checks whether a char separates arguments */
+#define IS_SEPARATOR(c)		(((c) == ' ') || ((c) == '\t'))
 
 
-/* parses an argument string using getopt() */
-option_list_t parse_args(const char* args, const char* optstr)
+/* checks whether a char ends an argument */
+#define IS_END(c)		(((c) == '\0') || IS_SEPARATOR(c))
+
+
+/* checks whether a char quotes an argument */
+#define IS_QUOTE(c)		(((c) == '"') || ((c) == '\''))
+
+
+/* skips separators */
+static const char* skip_separators(const char* ptr)
 {
-	extern int	optind;
-	extern int	optopt;
-	extern char*	optarg;
-	option_list_t	optlist	= NULL;
-	size_t		optsize	= 0;
-	int		opt;
+	while (IS_SEPARATOR(*ptr)) ptr++;
+	return ptr;
+}
+
+
+/* scans an argument (only the contents of the quotes, if quoted), returning its end */
+static const char* scan_argument(const char* ptr, const char** start, size_t* len)
+{
+	const char* end;
+
+	if (IS_QUOTE(*ptr)) {
+		const char quote = *ptr++;
+		for (end = ptr; *end && (*end != quote); end++);
+		*start = ptr;
+		*len   = end - ptr;
+		for (ptr = (*end) ? end + 1 : end; !IS_END(*ptr); ptr++);	/* ignore anything after quotes */
+		end    = ptr;
+	} else {
+		for (end = ptr; !IS_END(*end); end++);
+		*start = ptr;
+		*len   = end - ptr;
+	}
+
+	return end;
+}
 
-	int		argc = 0;
-	char*		argv[MAX_ARGS] = { "" };
 
-	/* possible opt values if parsing fails */
-	char		optfail[] = { UNKNOWN_OPTION, MISSING_VALUE, '\0' };
+/* compiles an option string */
+void compile_option_spec(option_spec_t* spec, const char* optstr)
+{
+	const unsigned char* ptr = (const unsigned char*) optstr;
 
-	/* split a non-null copy of args string into char* array */
-	char* last;
-	char* copy = strdup((args) ? args : "");
-	for (args = copy; (argv[argc] != NULL) && (argc < MAX_ARGS-1);) {
-		argv[++argc] = strtok_r((char*) args, " \t", &last);
-		args = NULL;
+	memset(spec, 0, sizeof(option_spec_t));
+	if (*ptr == MISSING_VALUE) {
+		spec->silent = 1;
+		ptr++;
 	}
+	for (; *ptr; ptr++) {
+		if ((*ptr != MISSING_VALUE) && (*ptr != UNKNOWN_OPTION)) {
+			spec->kind[*ptr] = (ptr[1] == MISSING_VALUE) ? OPTION_SPEC_VALUE : OPTION_SPEC_FLAG;
+		}
+	}
+}
 
-	/* fill option_value structs */
-	optind  = 0;
-	optlist = (option_list_t) malloc(argc * sizeof(struct option_value));
-	while ((opt = getopt(argc, argv, optstr)) != -1) {
-		const int dash = (optarg != NULL && optarg[0] == '-');
-		const int fail = (strchr(optfail, opt) != NULL) || dash;
-		const struct option_value optval = {
-			.opt = (dash) ? MISSING_VALUE : opt,
-			.err = (fail) ? ((dash) ? opt : optopt) : NO_CHAR,
-			.val = (fail) ? NULL : strdup(optarg)
-		};
-		optlist[optsize++] = optval;
-		if (fail) break;
+
+/* scans an argument string, storing views of option values */
+size_t scan_args(const char* args, const option_spec_t* spec, struct option_value* optlist, size_t size)
+{
+	const char*	ptr   = (args) ? args : "";
+	size_t		count = 0;
+	int		fail  = 0;
+
+	while (!fail && *(ptr = skip_separators(ptr))) {
+		const char*	start;
+		size_t		len;
+
+		if ((ptr[0] != '-') || IS_END(ptr[1])) {
+			/* not an option (but a positional argument): skip it */
+			ptr = scan_argument(ptr, &start, &len);
+			continue;
+		} else if ((ptr[1] == '-') && IS_END(ptr[2])) {
+			/* end of options */
+			break;
+		}
+
+		/* one or more options grouped in the same argument */
+		for (ptr++; !fail && !IS_END(*ptr);) {
+			struct option_value optval = { .opt = (unsigned char) *ptr++, .err = NO_CHAR, .val = NULL };
+			switch (spec->kind[optval.opt]) {
+				case OPTION_SPEC_FLAG: {
+					break;
+				}
+				case OPTION_SPEC_VALUE: {
+					/* value either follows the option or is the next argument */
+					if (IS_END(*ptr)) {
+						ptr = skip_separators(ptr);
+					}
+					if (*ptr == '\0') {
+						optval.err = optval.opt;
+						optval.opt = (spec->silent) ? MISSING_VALUE : UNKNOWN_OPTION;
+						fail = 1;
+					} else if ((ptr = scan_argument(ptr, &start, &len)) && (*start == '-')) {
+						optval.err = optval.opt;
+						optval.opt = MISSING_VALUE;
+						fail = 1;
+					} else {
+						optval.val = (char*) start;
+						optval.off = start - args;
+						optval.len = len;
+					}
+					break;
+				}
+				default: {
+					optval.err = optval.opt;
+					optval.opt = UNKNOWN_OPTION;
+					fail = 1;
+				}
+			}
+			if ((optlist != NULL) && (count + 1 < size)) {
+				optlist[count] = optval;
+			}
+			count++;
+		}
 	}
 
 	/* end of list */
-	optlist[optsize].opt = NO_CHAR;
+	if ((optlist != NULL) && (size > 0)) {
+		optlist[(count < size) ? count : size - 1].opt = NO_CHAR;
+	}
+
+	return count;
+}
+
+
+/* parses an argument string, copying values to an arena (or to heap if null) */
+static option_list_t parse_args_with(const char* args, const option_spec_t* spec, arena_t* arena)
+{
+	option_list_t	optlist	= NULL;
+	size_t		optsize	= scan_args(args, spec, NULL, 0) + 1;
+	char*		copy	= NULL;
+	size_t		i;
+
+	optlist = (option_list_t) ((arena) ? arena_alloc(arena, optsize * sizeof(struct option_value))
+	                                   : malloc(optsize * sizeof(struct option_value)));
+	if ((optlist == NULL) || (arena && ((copy = arena_strdup(arena, (args) ? args : "")) == NULL))) {
+		if (!arena) free(optlist);
+		return NULL;
+	}
+
+	/* values are terminated within a single copy of args (arena) or copied one by one (heap) */
+	scan_args(args, spec, optlist, optsize);
+	for (i = 0; optlist[i].opt != NO_CHAR; i++) {
+		if (optlist[i].val == NULL) {
+			/* nothing to do: option without value */
+		} else if (copy != NULL) {
+			optlist[i].val = copy + optlist[i].off;
+			optlist[i].val[optlist[i].len] = '\0';
+		} else {
+			optlist[i].val = strndup(optlist[i].val, optlist[i].len);
+		}
+	}
 
-	free(copy);
-	copy = NULL;
 	return optlist;
 }
 
 
+/* parses an argument string */
+option_list_t parse_args(const char* args, const char* optstr)
+{
+	option_spec_t spec;
+
+	compile_option_spec(&spec, optstr);
+	return parse_args_with(args, &spec, NULL);
+}
+
+
+/* parses an argument string, allocating from an arena */
+option_list_t parse_args_into(const char* args, const option_spec_t* spec, arena_t* arena)
+{
+	return parse_args_with(args, spec, arena);
+}
+
+
 /* releases resources for given options list */
 void free_option_list(option_list_t optlist)
 {
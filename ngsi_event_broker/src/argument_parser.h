@@ -35,6 +35,10 @@ extern "C" {
 #endif
 
 
+#include <stddef.h>
+#include "arena.h"
+
+
 /** Macro meaning no option char (therefore, the end of options list) */
 #ifndef NO_CHAR
 #define NO_CHAR -1
@@ -53,16 +57,68 @@ extern "C" {
 #endif /*MISSING_VALUE*/
 
 
+/** Kind of option char in an option spec: not an option */
+#define OPTION_SPEC_NONE	0
+
+
+/** Kind of option char in an option spec: option without value */
+#define OPTION_SPEC_FLAG	1
+
+
+/** Kind of option char in an option spec: option requiring a value */
+#define OPTION_SPEC_VALUE	2
+
+
+/** Option spec, as compiled from an option string (or statically initialized) */
+typedef struct {
+	unsigned char	kind[256];	/**< kind of every option char (OPTION_SPEC_*)  */
+	int		silent;		/**< whether missing values are ':' (not '?')   */
+} option_spec_t;
+
+
 /** Option-value pair */
 typedef struct option_value {
 	int	opt;		/**< option ('?' unknown, ':' missing value)    */
 	int	err;		/**< option that caused error (unknown/missing) */
-	char*	val;		/**< option value, or NULL if an error is found */
+	char*	val;		/**< option value, or NULL if none or error     */
+	size_t	off;		/**< offset of the value within arguments       */
+	size_t	len;		/**< length of the value                        */
 } *option_list_t;		/**< Options list as result of argument parsing */
 
 
 /**
- * Parses module arguments given in configuration file
+ * Compiles an option string into an option spec
+ *
+ * @param[out] spec		The option spec.
+ * @param[in]  optstr		The option string as defined for ::getopt.
+ */
+void compile_option_spec(option_spec_t* spec, const char* optstr);
+
+
+/**
+ * Scans arguments without any allocation nor copy (reentrant)
+ *
+ * Arguments are separated by spaces or tabs, unless single or double quoted.
+ * As ::getopt does, options may be grouped, values may follow their options
+ * in the same argument, positional arguments are skipped and `--` ends the
+ * options. Scanning stops at the first unknown option or missing value (also
+ * when the value starts with a dash).
+ *
+ * Values are given as views: the `val` field points into the arguments string
+ * (not terminated, thus `len` must be taken into account).
+ *
+ * @param[in]  args		The arguments as a space-separated string (may be null).
+ * @param[in]  spec		The option spec.
+ * @param[out] optlist		The options list (may be null, just to count options).
+ * @param[in]  size		The maximum number of entries of the list (including the end of list).
+ *
+ * @return			The number of options found (even if not fitting in the list).
+ */
+size_t scan_args(const char* args, const option_spec_t* spec, struct option_value* optlist, size_t size);
+
+
+/**
+ * Parses module arguments given in configuration file (may be called from several threads)
  *
  * @param[in] args		The module arguments as a space-separated string (may be null).
  * @param[in] optstr		The option string as defined for ::getopt.
@@ -72,6 +128,23 @@ typedef struct option_value {
 option_list_t parse_args(const char* args, const char* optstr);
 
 
+/**
+ * Parses arguments allocating the options list from an arena (may be called from several threads)
+ *
+ * Option values point into a copy of the arguments also allocated from the
+ * arena, so that there is no heap allocation per option. The options list
+ * remains valid until the arena is reset, and must not be released with
+ * ::free_option_list.
+ *
+ * @param[in] args		The arguments as a space-separated string (may be null).
+ * @param[in] spec		The option spec.
+ * @param[in] arena		The arena.
+ *
+ * @return			The arguments as options list, or NULL on allocation errors.
+ */
+option_list_t parse_args_into(const char* args, const option_spec_t* spec, arena_t* arena);
+
+
 /**
  * Releases resources for given options list
  *
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   dns_cache.c
+ * @brief  Cache of hostname resolutions implementation
+ *
+ * This file consists of the implementation of a hash table of resolutions with
+ * separate chaining, protected by a mutex. Entries are never removed until the
+ * cache is released: once expired, they are queued to a background thread that
+ * resolves them again, so that lookups never block but for new hostnames. Watched
+ * entries are queued by that thread itself as soon as they expire, waking up at
+ * the earliest expiry time among them.
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "dns_cache.h"
+
+
+/* entry of the cache, followed by its hostname */
+typedef struct dns_entry {
+	struct dns_entry*	next;		/* next entry in the same bucket */
+	struct dns_entry*	next_pending;	/* next entry to be refreshed */
+	struct dns_entry*	next_watched;	/* next entry refreshed without lookups */
+	uint32_t		hash;
+	int			resolved;	/* whether last resolution succeeded */
+	int			pending;	/* whether queued to be refreshed */
+	struct timespec		expiry;
+	dns_listener_t		listener;	/* listener of resolutions (if watched) */
+	void*			listener_arg;
+	char			addr[INET6_ADDRSTRLEN];
+	char			name[];
+} dns_entry_t;
+
+
+/* cache definition */
+struct dns_cache {
+	pthread_mutex_t		mutex;
+	pthread_cond_t		wakeup;
+	pthread_t		thread;
+	int			stopped;
+	dns_entry_t**		buckets;
+	size_t			size;
+	dns_entry_t*		pending;	/* entries to be refreshed (LIFO) */
+	dns_entry_t*		watched;	/* entries refreshed as soon as expired */
+	dns_resolver_t		resolver;
+	size_t			ttl;
+	size_t			negative_ttl;
+	dns_cache_stats_t	stats;
+};
+
+
+/* hashes a hostname (FNV-1a) */
+static uint32_t hash_name(const char* name)
+{
+	uint32_t		hash = 2166136261U;
+	const unsigned char*	ptr;
+
+	for (ptr = (const unsigned char*) name; *ptr; ptr++) {
+		hash = (hash ^ *ptr) * 16777619U;
+	}
+	return hash;
+}
+
+
+/* gets the current monotonic time */
+static void monotonic_now(struct timespec* now)
+{
+	clock_gettime(CLOCK_MONOTONIC, now);
+}
+
+
+/* sets the expiry time of an entry according to the result of its resolution */
+static void set_expiry(const dns_cache_t* cache, dns_entry_t* entry)
+{
+	size_t millis = (entry->resolved) ? cache->ttl : cache->negative_ttl;
+
+	monotonic_now(&entry->expiry);
+	entry->expiry.tv_sec  += millis / 1000;
+	entry->expiry.tv_nsec += (millis % 1000) * 1000000L;
+	if (entry->expiry.tv_nsec >= 1000000000L) {
+		entry->expiry.tv_sec++;
+		entry->expiry.tv_nsec -= 1000000000L;
+	}
+}
+
+
+/* checks whether an entry has expired */
+static int expired(const dns_entry_t* entry)
+{
+	struct timespec now;
+
+	monotonic_now(&now);
+	return (now.tv_sec > entry->expiry.tv_sec)
+	    || ((now.tv_sec == entry->expiry.tv_sec) && (now.tv_nsec >= entry->expiry.tv_nsec));
+}
+
+
+/* finds the entry of a hostname (NULL if not found) */
+static dns_entry_t* find_entry(const dns_cache_t* cache, const char* name, uint32_t hash)
+{
+	dns_entry_t* entry = cache->buckets[hash % cache->size];
+
+	while ((entry != NULL) && ((entry->hash != hash) || strcmp(entry->name, name))) {
+		entry = entry->next;
+	}
+	return entry;
+}
+
+
+/* queues an entry to be refreshed, waking up the refresh thread */
+static void queue_pending(dns_cache_t* cache, dns_entry_t* entry)
+{
+	entry->pending      = 1;
+	entry->next_pending = cache->pending;
+	cache->pending      = entry;
+	pthread_cond_signal(&cache->wakeup);
+}
+
+
+/* queues expired watched entries, getting the earliest expiry of the rest (returns 0 if there are none) */
+static int queue_watched(dns_cache_t* cache, struct timespec* deadline)
+{
+	dns_entry_t*	entry;
+	int		found = 0;
+
+	for (entry = cache->watched; entry != NULL; entry = entry->next_watched) {
+		if (entry->pending) {
+			continue;
+		} else if (expired(entry)) {
+			queue_pending(cache, entry);
+		} else if (!found++ || (entry->expiry.tv_sec < deadline->tv_sec)
+		           || ((entry->expiry.tv_sec == deadline->tv_sec) && (entry->expiry.tv_nsec < deadline->tv_nsec))) {
+			*deadline = entry->expiry;
+		}
+	}
+	return found;
+}
+
+
+/* refresh thread: resolves again expired entries until stopped */
+static void* refresh_thread(void* arg)
+{
+	dns_cache_t*	cache = (dns_cache_t*) arg;
+	dns_entry_t*	entry;
+	char		addr[INET6_ADDRSTRLEN];
+	struct timespec	deadline;
+	int		resolved;
+
+	pthread_mutex_lock(&cache->mutex);
+	while (!cache->stopped) {
+		int watching = queue_watched(cache, &deadline);
+		if ((entry = cache->pending) == NULL) {
+			if (watching) {
+				pthread_cond_timedwait(&cache->wakeup, &cache->mutex, &deadline);
+			} else {
+				pthread_cond_wait(&cache->wakeup, &cache->mutex);
+			}
+			continue;
+		}
+		cache->pending = entry->next_pending;
+
+		/* entries are never released while this thread runs */
+		pthread_mutex_unlock(&cache->mutex);
+		resolved = (cache->resolver(entry->name, addr, sizeof(addr)) == 0);
+		pthread_mutex_lock(&cache->mutex);
+
+		if (resolved) {
+			strcpy(entry->addr, addr);
+		}
+		entry->resolved = resolved;
+		entry->pending  = 0;
+		set_expiry(cache, entry);
+		cache->stats.refreshes++;
+		if (resolved && (entry->listener != NULL)) {
+			entry->listener(entry->name, entry->addr, entry->listener_arg);
+		}
+	}
+	pthread_mutex_unlock(&cache->mutex);
+
+	return NULL;
+}
+
+
+/* resolves a hostname using getaddrinfo() */
+int dns_resolve(const char* hostname, char* addr, size_t addrmaxlen)
+{
+	int		result = -1;
+	struct addrinfo	hints, *list = NULL;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if ((getaddrinfo(hostname, NULL, &hints, &list) == 0) && (list != NULL)) {
+		const struct sockaddr_in* sin = (const struct sockaddr_in*) list->ai_addr;
+		if (inet_ntop(AF_INET, &sin->sin_addr, addr, addrmaxlen) != NULL) {
+			result = 0;
+		}
+	}
+	if (list != NULL) {
+		freeaddrinfo(list);
+	}
+
+	return result;
+}
+
+
+/* creates a new cache */
+dns_cache_t* dns_cache_create(size_t ttl, size_t negative_ttl, dns_resolver_t resolver)
+{
+	dns_cache_t*		cache = NULL;
+	pthread_condattr_t	attr;
+
+	if ((cache = (dns_cache_t*) calloc(1, sizeof(dns_cache_t))) == NULL) {
+		return NULL;
+	} else if ((cache->buckets = (dns_entry_t**) calloc(DNS_CACHE_BUCKETS, sizeof(dns_entry_t*))) == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->size         = DNS_CACHE_BUCKETS;
+	cache->ttl          = ttl;
+	cache->negative_ttl = negative_ttl;
+	cache->resolver     = (resolver) ? resolver : dns_resolve;
+	pthread_mutex_init(&cache->mutex, NULL);
+	/* timed waits for watched entries use the same clock as expiry times */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&cache->wakeup, &attr);
+	pthread_condattr_destroy(&attr);
+	if (pthread_create(&cache->thread, NULL, refresh_thread, cache) != 0) {
+		pthread_cond_destroy(&cache->wakeup);
+		pthread_mutex_destroy(&cache->mutex);
+		free(cache->buckets);
+		free(cache);
+		cache = NULL;
+	}
+
+	return cache;
+}
+
+
+/* stops the refresh thread and releases resources */
+void dns_cache_free(dns_cache_t* cache)
+{
+	size_t i;
+
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->mutex);
+	cache->stopped = 1;
+	pthread_cond_signal(&cache->wakeup);
+	pthread_mutex_unlock(&cache->mutex);
+	pthread_join(cache->thread, NULL);
+
+	for (i = 0; i < cache->size; i++) {
+		while (cache->buckets[i] != NULL) {
+			dns_entry_t* entry = cache->buckets[i];
+			cache->buckets[i] = entry->next;
+			free(entry);
+		}
+	}
+	pthread_cond_destroy(&cache->wakeup);
+	pthread_mutex_destroy(&cache->mutex);
+	free(cache->buckets);
+	free(cache);
+}
+
+
+/* gets the IP address of a hostname */
+int dns_cache_resolve(dns_cache_t* cache, const char* hostname, char* addr, size_t addrmaxlen)
+{
+	uint32_t	hash = hash_name(hostname);
+	dns_entry_t*	entry;
+	int		result;
+
+	pthread_mutex_lock(&cache->mutex);
+	if ((entry = find_entry(cache, hostname, hash)) != NULL) {
+		/* serve last result, refreshing it in background if expired */
+		if (!entry->pending && expired(entry)) {
+			queue_pending(cache, entry);
+		}
+		result = (entry->resolved && (strlen(entry->addr) < addrmaxlen)) ? 0 : -1;
+		if (result == 0) {
+			strcpy(addr, entry->addr);
+		}
+		cache->stats.hits++;
+		pthread_mutex_unlock(&cache->mutex);
+		return result;
+	}
+	cache->stats.misses++;
+	pthread_mutex_unlock(&cache->mutex);
+
+	/* resolve a new hostname without holding the lock */
+	if ((entry = (dns_entry_t*) calloc(1, sizeof(dns_entry_t) + strlen(hostname) + 1)) == NULL) {
+		return cache->resolver(hostname, addr, addrmaxlen);
+	}
+	strcpy(entry->name, hostname);
+	entry->hash     = hash;
+	entry->resolved = (cache->resolver(hostname, entry->addr, sizeof(entry->addr)) == 0);
+	set_expiry(cache, entry);
+	result = (entry->resolved && (strlen(entry->addr) < addrmaxlen)) ? 0 : -1;
+	if (result == 0) {
+		strcpy(addr, entry->addr);
+	}
+
+	pthread_mutex_lock(&cache->mutex);
+	if (find_entry(cache, hostname, hash) != NULL) {
+		free(entry);	/* already added by a concurrent lookup */
+	} else {
+		entry->next = cache->buckets[hash % cache->size];
+		cache->buckets[hash % cache->size] = entry;
+	}
+	pthread_mutex_unlock(&cache->mutex);
+
+	return result;
+}
+
+
+/* keeps a hostname resolved ahead of time, notifying its resolutions */
+int dns_cache_watch(dns_cache_t* cache, const char* hostname, dns_listener_t listener, void* arg)
+{
+	dns_entry_t*	entry;
+	char		addr[INET6_ADDRSTRLEN];
+	int		result;
+
+	/* make sure hostname has an entry, resolving it now if new */
+	dns_cache_resolve(cache, hostname, addr, sizeof(addr));
+
+	pthread_mutex_lock(&cache->mutex);
+	if ((entry = find_entry(cache, hostname, hash_name(hostname))) == NULL) {
+		result = -1;
+	} else {
+		if (entry->listener == NULL) {
+			entry->next_watched = cache->watched;
+			cache->watched      = entry;
+			pthread_cond_signal(&cache->wakeup);
+		}
+		entry->listener     = listener;
+		entry->listener_arg = arg;
+		if ((result = (entry->resolved) ? 0 : -1) == 0) {
+			listener(entry->name, entry->addr, arg);
+		}
+	}
+	pthread_mutex_unlock(&cache->mutex);
+
+	return result;
+}
+
+
+/* gets the usage counters */
+void dns_cache_get_stats(dns_cache_t* cache, dns_cache_stats_t* stats)
+{
+	pthread_mutex_lock(&cache->mutex);
+	*stats = cache->stats;
+	pthread_mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   dns_cache.h
+ * @brief  Cache of hostname resolutions macros and declarations
+ *
+ * This file declares a thread-safe cache of IP addresses of hostnames, used
+ * by the [Event Broker](@NagiosModule_ref) to identify remote hosts checked via
+ * NRPE without a blocking DNS query for every check. Both resolutions and
+ * failures are kept for a given time (TTL); once expired, the last address is
+ * still returned while a background thread resolves the hostname again. Some
+ * hostnames may also be watched, so that they are resolved again as soon as they
+ * expire (regardless of lookups) and their new addresses are notified.
+ */
+
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Default number of buckets of a cache */
+#define DNS_CACHE_BUCKETS		1024
+
+
+/** Opaque cache type */
+typedef struct dns_cache dns_cache_t;
+
+
+/**
+ * Function to resolve a hostname
+ *
+ * @param[in]  hostname		The hostname.
+ * @param[out] addr		The buffer where IP address will be written to.
+ * @param[in]  addrmaxlen	The length of the buffer.
+ *
+ * @retval 0			Successfully resolved.
+ * @retval -1			Not successfully resolved.
+ */
+typedef int (*dns_resolver_t)(const char* hostname, char* addr, size_t addrmaxlen);
+
+
+/**
+ * Function to be notified of the resolutions of a watched hostname
+ *
+ * It is called with the cache locked (thus it must not use the cache) from the
+ * refresh thread, but for the first time (see dns_cache_watch()).
+ *
+ * @param[in] hostname		The hostname.
+ * @param[in] addr		The IP address resolved.
+ * @param[in] arg		The argument given when the hostname was watched.
+ */
+typedef void (*dns_listener_t)(const char* hostname, const char* addr, void* arg);
+
+
+/** Cache usage counters */
+typedef struct {
+	unsigned long		hits;		/**< Lookups answered from the cache */
+	unsigned long		misses;		/**< Lookups that required a blocking resolution */
+	unsigned long		refreshes;	/**< Background resolutions of expired entries */
+} dns_cache_stats_t;
+
+
+/**
+ * Creates a new empty cache, starting its background refresh thread
+ *
+ * @param[in] ttl		The time (in milliseconds) resolved addresses are valid.
+ * @param[in] negative_ttl	The time (in milliseconds) resolution failures are kept.
+ * @param[in] resolver		The function to resolve hostnames (if null, getaddrinfo() is used).
+ *
+ * @return			The new cache, or NULL if it could not be created.
+ */
+dns_cache_t* dns_cache_create(size_t ttl, size_t negative_ttl, dns_resolver_t resolver);
+
+
+/**
+ * Stops the refresh thread and releases resources for given cache
+ *
+ * @param[in] cache		The cache.
+ */
+void dns_cache_free(dns_cache_t* cache);
+
+
+/**
+ * Gets the IP address of a hostname
+ *
+ * Only the first lookup of a hostname blocks until resolved: expired entries are
+ * refreshed asynchronously, returning the last result meanwhile.
+ *
+ * @param[in]  cache		The cache.
+ * @param[in]  hostname		The hostname.
+ * @param[out] addr		The buffer where IP address will be written to.
+ * @param[in]  addrmaxlen	The length of the buffer.
+ *
+ * @retval 0			Successfully resolved.
+ * @retval -1			Not successfully resolved (or failure still cached).
+ */
+int dns_cache_resolve(dns_cache_t* cache, const char* hostname, char* addr, size_t addrmaxlen);
+
+
+/**
+ * Watches a hostname, so that it is resolved again as soon as its entry expires
+ *
+ * The hostname is resolved now if not found in the cache, and its listener is
+ * called with the current address (if any) and after every later successful
+ * resolution. Watching a hostname again replaces its listener.
+ *
+ * @param[in] cache		The cache.
+ * @param[in] hostname		The hostname.
+ * @param[in] listener		The function to be notified of resolutions.
+ * @param[in] arg		The argument to be passed to the listener.
+ *
+ * @retval 0			Successfully resolved.
+ * @retval -1			Not successfully resolved yet (will be retried in background).
+ */
+int dns_cache_watch(dns_cache_t* cache, const char* hostname, dns_listener_t listener, void* arg);
+
+
+/**
+ * Gets the usage counters of the cache
+ *
+ * @param[in]  cache		The cache.
+ * @param[out] stats		The counters.
+ */
+void dns_cache_get_stats(dns_cache_t* cache, dns_cache_stats_t* stats);
+
+
+/**
+ * Resolves a hostname to get its IPv4 address using getaddrinfo() (default resolver)
+ *
+ * @param[in]  hostname		The hostname.
+ * @param[out] addr		The buffer where IP address will be written to.
+ * @param[in]  addrmaxlen	The length of the buffer.
+ *
+ * @retval 0			Successfully resolved.
+ * @retval -1			Not successfully resolved.
+ */
+int dns_resolve(const char* hostname, char* addr, size_t addrmaxlen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*DNS_CACHE_H*/
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   hash_ring.c
+ * @brief  Consistent hashing ring implementation
+ *
+ * This file consists of the implementation of a consistent hashing ring: every
+ * node is given a number of points (replicas) on a 64-bit circle, hashing its
+ * name along with the replica number, and a key is assigned to the node owning
+ * the first point found clockwise from the hash of the key. Points are kept in
+ * a sorted array, so that lookups are binary searches.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "hash_ring.h"
+
+
+/* point of a node in the ring */
+typedef struct {
+	uint64_t	hash;
+	size_t		node;
+} ring_point_t;
+
+
+/* ring definition */
+struct hash_ring {
+	ring_point_t*	points;
+	size_t		count;
+};
+
+
+/* hashes a string (FNV-1a, followed by a final mix to spread similar strings) */
+static uint64_t hash_string(const char* str, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	size_t   i;
+
+	for (i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char) str[i]) * 1099511628211ULL;
+	}
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+	return hash ^ (hash >> 31);
+}
+
+
+/* compares two points of the ring */
+static int compare_points(const void* a, const void* b)
+{
+	const ring_point_t* pa = (const ring_point_t*) a;
+	const ring_point_t* pb = (const ring_point_t*) b;
+
+	return (pa->hash != pb->hash) ? ((pa->hash > pb->hash) ? 1 : -1)
+	     : (pa->node != pb->node) ? ((pa->node > pb->node) ? 1 : -1) : 0;
+}
+
+
+/* creates a new ring */
+hash_ring_t* hash_ring_create(const char* const* nodes, size_t count, size_t replicas)
+{
+	hash_ring_t*	ring = NULL;
+	char		name[1024];
+	size_t		i, j, len;
+
+	if ((count > 0) && (replicas > 0)
+	    && ((ring = (hash_ring_t*) calloc(1, sizeof(hash_ring_t))) != NULL)) {
+		if ((ring->points = (ring_point_t*) malloc(count * replicas * sizeof(ring_point_t))) == NULL) {
+			free(ring);
+			ring = NULL;
+		} else {
+			for (i = 0; i < count; i++) {
+				for (j = 0; j < replicas; j++) {
+					len = snprintf(name, sizeof(name), "%s#%lu", nodes[i], (unsigned long) j);
+					len = (len < sizeof(name)) ? len : sizeof(name) - 1;
+					ring->points[ring->count].hash = hash_string(name, len);
+					ring->points[ring->count].node = i;
+					ring->count++;
+				}
+			}
+			qsort(ring->points, ring->count, sizeof(ring_point_t), compare_points);
+		}
+	}
+
+	return ring;
+}
+
+
+/* releases resources for given ring */
+void hash_ring_free(hash_ring_t* ring)
+{
+	if (ring != NULL) {
+		free(ring->points);
+		free(ring);
+	}
+}
+
+
+/* gets the node a key is assigned to */
+size_t hash_ring_lookup(const hash_ring_t* ring, const char* key, size_t length)
+{
+	uint64_t hash = hash_string(key, length);
+	size_t   low  = 0, high = ring->count;
+
+	/* first point not lower than hash (wrapping around to the first one) */
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (ring->points[mid].hash < hash) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return ring->points[(low < ring->count) ? low : 0].node;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   hash_ring.h
+ * @brief  Consistent hashing ring macros and declarations
+ *
+ * This file declares a consistent hashing ring used by the [Event Broker](@NagiosModule_ref)
+ * to distribute entities among several NGSI Adapter endpoints, so that all the
+ * requests about an entity go to the same endpoint, and adding or removing an
+ * endpoint only remaps a small share of entities.
+ */
+
+
+#ifndef HASH_RING_H
+#define HASH_RING_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Default number of points of every node in the ring */
+#define HASH_RING_REPLICAS		160
+
+
+/** Opaque ring type */
+typedef struct hash_ring hash_ring_t;
+
+
+/**
+ * Creates a new ring
+ *
+ * @param[in] nodes		The names of the nodes (their order gives the index returned by lookups).
+ * @param[in] count		The number of nodes.
+ * @param[in] replicas		The number of points of every node in the ring.
+ *
+ * @return			The new ring, or NULL if it could not be created.
+ */
+hash_ring_t* hash_ring_create(const char* const* nodes, size_t count, size_t replicas);
+
+
+/**
+ * Releases resources for given ring
+ *
+ * @param[in] ring		The ring.
+ */
+void hash_ring_free(hash_ring_t* ring);
+
+
+/**
+ * Gets the node a key is assigned to
+ *
+ * @param[in] ring		The ring.
+ * @param[in] key		The key.
+ * @param[in] length		The length of the key.
+ *
+ * @return			The index of the node.
+ */
+size_t hash_ring_lookup(const hash_ring_t* ring, const char* key, size_t length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*HASH_RING_H*/
@@ -28,11 +28,14 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
 #include <limits.h>
 #include <time.h>
+#include <pthread.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -45,6 +48,11 @@
 #include "broker.h"
 #include "curl/curl.h"
 #include "argument_parser.h"
+#include "request_spool.h"
+#include "route_cache.h"
+#include "string_pool.h"
+#include "dns_cache.h"
+#include "adapter_sender.h"
 #include "ngsi_event_broker_common.h"
 
 
@@ -54,25 +62,207 @@
  */
 
 char*			adapter_url = NULL;
+char**			adapter_urls = NULL;
+size_t			adapter_url_count = 0;
+char*			adapter_socket = NULL;
 char*			region_id   = NULL;
 char*			host_addr   = NULL;
 loglevel_t		log_level   = LOG_INFO;
+size_t			queue_size  = 0;
+size_t			sender_count = DEFAULT_SENDER_COUNT;
+overflow_policy_t	overflow_policy = OVERFLOW_DROP_NEW;
+size_t			inflight_limit = 0;
+size_t			inflight_min = 0;
+size_t			batch_size = 0;
+size_t			batch_delay = DEFAULT_BATCH_DELAY;
+char*			spool_path  = NULL;
+size_t			spool_size  = DEFAULT_SPOOL_SIZE;
+size_t			replay_rate = DEFAULT_REPLAY_RATE;
+size_t			breaker_threshold = DEFAULT_BREAKER_THRESHOLD;
+size_t			breaker_wait = DEFAULT_BREAKER_WAIT;
+regex_t*		include_pattern = NULL;
+regex_t*		exclude_pattern = NULL;
+size_t			dns_ttl = DEFAULT_DNS_TTL;
+size_t			dns_negative_ttl = DEFAULT_DNS_NEGATIVE_TTL;
+char*			entity_id_template = NULL;
+url_template_t**	request_templates = NULL;
 
 /**@}*/
 
 
+/* Nagios log is not thread-safe: only the thread that initialized the module (i.e. Nagios main thread)
+ * writes to it, whereas messages from other threads (senders, replay) are queued until the former
+ * flushes them, dropping those exceeding the queue limit */
+#define LOGGING_QUEUE_MAXLEN	1024
+
+typedef struct logging_entry {
+	struct logging_entry*	next;
+	char			text[];
+} logging_entry_t;
+
+static pthread_t		logging_thread;
+static int			logging_thread_set = 0;
+static pthread_mutex_t		logging_mutex	= PTHREAD_MUTEX_INITIALIZER;
+static logging_entry_t*		logging_head	= NULL;
+static logging_entry_t**	logging_tail	= &logging_head;
+static size_t			logging_queued	= 0;
+static size_t			logging_dropped	= 0;
+
+
+/* queues a message logged from a thread other than the main one */
+static void defer_logging(const char* text, size_t len)
+{
+	logging_entry_t* entry = NULL;
+
+	pthread_mutex_lock(&logging_mutex);
+	if ((logging_queued >= LOGGING_QUEUE_MAXLEN)
+	    || ((entry = (logging_entry_t*) malloc(sizeof(logging_entry_t) + len + 1)) == NULL)) {
+		__atomic_add_fetch(&logging_dropped, 1, __ATOMIC_RELAXED);
+	} else {
+		memcpy(entry->text, text, len + 1);
+		entry->next = NULL;
+		*logging_tail = entry;
+		logging_tail = &entry->next;
+		__atomic_store_n(&logging_queued, logging_queued + 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&logging_mutex);
+}
+
+
+/* writes to Nagios log the messages queued by other threads (to be called from the main thread) */
+static void flush_logging(void)
+{
+	logging_entry_t*	entry;
+	size_t			dropped;
+
+	if ((__atomic_load_n(&logging_queued, __ATOMIC_ACQUIRE) == 0)
+	    && (__atomic_load_n(&logging_dropped, __ATOMIC_RELAXED) == 0)) {
+		return;
+	}
+
+	pthread_mutex_lock(&logging_mutex);
+	entry = logging_head;
+	dropped = logging_dropped;
+	logging_head = NULL;
+	logging_tail = &logging_head;
+	logging_dropped = 0;
+	__atomic_store_n(&logging_queued, 0, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&logging_mutex);
+
+	while (entry != NULL) {
+		logging_entry_t* next = entry->next;
+		write_to_log(entry->text, NSLOG_INFO_MESSAGE, NULL);
+		free(entry);
+		entry = next;
+	}
+	if (dropped) {
+		context_t context = { .op = "Logging" };
+		logging(LOG_WARN, &context, "Messages from sender threads dropped: %lu", (unsigned long) dropped);
+	}
+}
+
+
+/* list of services defined (see Nagios objects.h) */
+extern service*		service_list;
+
+
+/* routes of adapter requests by service (NULL while object definitions may change) */
+static route_cache_t*	route_cache = NULL;
+
+
+/* flags of the state of a service */
+#define SERVICE_ROUTE_CACHED	0x01	/* route is cached */
+#define SERVICE_ROUTE_IGNORED	0x02	/* results are ignored (no route) */
+
+
+/* state of Nagios 4.x services, indexed by service id: flags are checked for every result (hot),
+ * whereas routes are only read for services not ignored (cold), and both are valid along with
+ * the route cache (the latter keeping the routes of services without id, i.e. Nagios 3.x) */
+static uint8_t*		service_flags	= NULL;
+static const char**	service_routes	= NULL;
+static size_t		service_slots	= 0;
+static size_t		service_cached	= 0;
+
+
+/* resolutions of remote hosts checked via NRPE (NULL if disabled) */
+static dns_cache_t*	dns_cache = NULL;
+
+
+/* interned routes of services, released as soon as cached routes are forgotten (i.e. on every reload),
+ * so that routes of services no longer defined take no memory (NULL until the first one) */
+static string_pool_t*	route_pool = NULL;
+
+
+/* forgets the cached routes of all services, releasing their interned strings */
+static void clear_service_states(void)
+{
+	size_t i;
+
+	for (i = 0; (i < service_slots) && service_cached; i++) {
+		if (service_flags[i] & SERVICE_ROUTE_CACHED) {
+			service_routes[i] = NULL;
+			service_flags[i]  = 0;
+			service_cached--;
+		}
+	}
+	if (route_cache != NULL) {
+		route_cache_clear(route_cache);
+	}
+	string_pool_free(route_pool);
+	route_pool = NULL;
+}
+
+
+/* sets the number of services whose state is indexed by id, forgetting cached routes (zero releases all) */
+static int resize_service_states(size_t count)
+{
+	int		result = NEB_OK;
+	uint8_t*	flags  = NULL;
+	const char**	routes = NULL;
+
+	clear_service_states();
+	if (count == service_slots) {
+		/* nothing to do: already sized */
+	} else if ((count > 0)
+	           && (((flags = (uint8_t*) calloc(count, sizeof(uint8_t))) == NULL)
+	               || ((routes = (const char**) calloc(count, sizeof(const char*))) == NULL))) {
+		free(flags);
+		result = NEB_ERROR;
+	} else {
+		free(service_flags);
+		free(service_routes);
+		service_flags  = flags;
+		service_routes = routes;
+		service_slots  = count;
+	}
+
+	return result;
+}
+
+
 /* deinitializes the module */
 int nebmodule_deinit(int flags, int reason)
 {
 	int		result = NEB_OK;
 	context_t	context = { .op = "Exit" };
 
+	free_adapter_senders();
+	flush_logging();
 	curl_global_cleanup();
 	free_module_variables();
+	if (route_pool != NULL) {
+		logging(LOG_INFO, &context, "Interned routes: %lu (%lu bytes)",
+		        string_pool_count(route_pool), string_pool_size(route_pool));
+	}
+	route_cache_free(route_cache);
+	route_cache = NULL;
+	resize_service_states(0);
+	free_remote_address_cache(&context);
 
 	if (reason != NEBMODULE_ERROR_BAD_INIT) {
 		logging(LOG_INFO, &context, "Finishing...");
 	}
+	logging_thread_set = 0;
 
 	return result;
 }
@@ -84,6 +274,8 @@ int nebmodule_init(int flags, char* args, void* handle)
 	int		result  = NEB_OK;
 	context_t	context = { .op = "Init" };
 
+	logging_thread = pthread_self();
+	logging_thread_set = 1;
 	init_module_handle_info(handle, &context);
 	if (check_nagios_object_version(&context) != NEB_OK) {
 		result = NEB_ERROR;
@@ -92,9 +284,14 @@ int nebmodule_init(int flags, char* args, void* handle)
 	} else if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
 		logging(LOG_ERROR, &context, "Could not initialize libcurl");
 		result = NEB_ERROR;
-	} else {
-		result = neb_register_callback(NEBCALLBACK_SERVICE_CHECK_DATA,
-		                               module_handle, 0, callback_service_check);
+	} else if (init_adapter_senders(&context) != NEB_OK) {
+		result = NEB_ERROR;
+	} else if (init_remote_address_cache(&context) != NEB_OK) {
+		result = NEB_ERROR;
+	} else if ((result = neb_register_callback(NEBCALLBACK_SERVICE_CHECK_DATA,
+	                                           module_handle, 0, callback_service_check)) == NEB_OK) {
+		neb_register_callback(NEBCALLBACK_PROCESS_DATA, module_handle, 0, callback_process);
+		neb_register_callback(NEBCALLBACK_EXTERNAL_COMMAND_DATA, module_handle, 0, callback_external_command);
 	}
 
 	/* check for errors in initialization */
@@ -121,6 +318,136 @@ int check_nagios_object_version(context_t* context)
 }
 
 
+/* parses a non-negative number not lower than a given minimum */
+static int parse_size(const char* str, size_t min, size_t* value)
+{
+	int	result = NEB_ERROR;
+	char*	end;
+	long	val = strtol(str, &end, 10);
+
+	if ((end != str) && !*end && (val >= 0) && ((size_t) val >= min)) {
+		*value = (size_t) val;
+		result = NEB_OK;
+	}
+
+	return result;
+}
+
+
+/* parses a range of numbers `low:high` not lower than a given minimum */
+static int parse_range(const char* str, size_t min, size_t* low, size_t* high)
+{
+	int	result = NEB_ERROR;
+	char*	end;
+	long	val = strtol(str, &end, 10);
+
+	if ((end != str) && (*end == ':') && (val >= 0) && ((size_t) val >= min)
+	    && (parse_size(end + 1, (size_t) val, high) == NEB_OK)) {
+		*low = (size_t) val;
+		result = NEB_OK;
+	}
+
+	return result;
+}
+
+
+/* parses the time to live of resolved addresses `ttl[:negative_ttl]` */
+static int parse_ttl(const char* str, size_t* ttl, size_t* negative_ttl)
+{
+	int	result = NEB_ERROR;
+	char*	end;
+	long	val = strtol(str, &end, 10);
+
+	if ((end == str) || (val < 0)) {
+		/* invalid value */
+	} else if (!*end) {
+		*ttl = (size_t) val;
+		result = NEB_OK;
+	} else if ((*end == ':') && (parse_size(end + 1, 0, negative_ttl) == NEB_OK)) {
+		*ttl = (size_t) val;
+		result = NEB_OK;
+	}
+
+	return result;
+}
+
+
+/* compiles a pattern of host names or service descriptions (POSIX extended regular expression) */
+static int compile_pattern(const char* str, regex_t** pattern)
+{
+	int result = NEB_ERROR;
+
+	if (*pattern != NULL) {
+		regfree(*pattern);
+	} else if ((*pattern = (regex_t*) malloc(sizeof(regex_t))) == NULL) {
+		return result;
+	}
+
+	if (regcomp(*pattern, str, REG_EXTENDED | REG_NOSUB) == 0) {
+		result = NEB_OK;
+	} else {
+		free(*pattern);
+		*pattern = NULL;
+	}
+
+	return result;
+}
+
+
+/* releases a compiled pattern */
+static void free_pattern(regex_t** pattern)
+{
+	if (*pattern != NULL) {
+		regfree(*pattern);
+		free(*pattern);
+		*pattern = NULL;
+	}
+}
+
+
+/* compiles the templates of adapter request URLs of the specific module, given that of entity identifiers */
+static int compile_request_templates(const char* id_template, context_t* context)
+{
+	url_template_t*	tmpl  = NULL;
+	size_t		count = 0;
+	size_t		i;
+
+	/* check the template of entity identifiers on its own, even if not referenced by any request template */
+	if ((tmpl = url_template_compile(id_template, NULL)) == NULL) {
+		logging(LOG_ERROR, context, "Invalid entity id template %s", id_template);
+		return NEB_ERROR;
+	}
+	url_template_free(tmpl);
+
+	while (request_template_texts[count] != NULL) count++;
+	if ((request_templates = (url_template_t**) calloc(count + 1, sizeof(url_template_t*))) == NULL) {
+		logging(LOG_ERROR, context, "Cannot allocate request templates");
+		return NEB_ERROR;
+	}
+	for (i = 0; i < count; i++) {
+		if ((request_templates[i] = url_template_compile(request_template_texts[i], id_template)) == NULL) {
+			logging(LOG_ERROR, context, "Cannot compile request template %s", request_template_texts[i]);
+			return NEB_ERROR;
+		}
+	}
+	return NEB_OK;
+}
+
+
+/* releases the compiled templates of adapter request URLs */
+static void free_request_templates(void)
+{
+	if (request_templates != NULL) {
+		url_template_t** ptr;
+		for (ptr = request_templates; *ptr; ptr++) {
+			url_template_free(*ptr);
+		}
+		free(request_templates);
+		request_templates = NULL;
+	}
+}
+
+
 /* initializes module variables */
 int init_module_variables(char* args, context_t* context)
 {
@@ -130,13 +457,33 @@ int init_module_variables(char* args, context_t* context)
 	int		result	= NEB_OK;
 
 	/* process arguments passed to module in Nagios configuration file */
-	if ((opts = parse_args(args, ":u:r:l:")) != NULL) {
+	if ((opts = parse_args(args, ":u:U:r:l:q:t:o:n:b:d:s:S:R:f:w:i:e:D:T:")) != NULL) {
 		size_t	i;
 		for (i = 0; opts[i].opt != NO_CHAR; i++) {
 			switch(opts[i].opt) {
-				case 'u': { /* adapter URL without trailing slash */
-					size_t len = strlen(adapter_url = STRDUP(opts[i].val));
-					if ((len > 0) && (adapter_url[len-1] == '/')) adapter_url[len-1] = '\0';
+				case 'u': { /* adapter URL without trailing slash (may be repeated) */
+					char*	url  = STRDUP(opts[i].val);
+					size_t	len  = strlen(url);
+					char**	urls = (char**) realloc(adapter_urls, (adapter_url_count + 1) * sizeof(char*));
+					if ((len > 0) && (url[len-1] == '/')) url[len-1] = '\0';
+					if (urls == NULL) {
+						logging(LOG_ERROR, context, "Cannot allocate adapter URL %s", url);
+						free(url);
+						result = NEB_ERROR;
+					} else {
+						adapter_urls = urls;
+						adapter_urls[adapter_url_count++] = url;
+						adapter_url = adapter_urls[0];
+					}
+					break;
+				}
+				case 'U': { /* path of Unix domain socket to connect to adapter */
+#if (LIBCURL_VERSION_NUM >= 0x072800)
+					adapter_socket = STRDUP(opts[i].val);
+#else
+					logging(LOG_ERROR, context, "Unix domain sockets not supported by libcurl %s", LIBCURL_VERSION);
+					result = NEB_ERROR;
+#endif
 					break;
 				}
 				case 'r': { /* region id */
@@ -150,6 +497,112 @@ int init_module_variables(char* args, context_t* context)
 					if (*ptr) log_level = lvl;
 					break;
 				}
+				case 'q': { /* queue size (zero means no queue) */
+					if (parse_size(opts[i].val, 0, &queue_size) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid queue size %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 't': { /* number of sender threads */
+					if (parse_size(opts[i].val, 1, &sender_count) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid number of sender threads %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'n': { /* max concurrent requests per sender thread, either fixed or adaptive (min:max) */
+					if ((parse_size(opts[i].val, 1, &inflight_limit) != NEB_OK)
+					    && (parse_range(opts[i].val, 1, &inflight_min, &inflight_limit) != NEB_OK)) {
+						logging(LOG_ERROR, context, "Invalid in-flight requests limit %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'b': { /* max requests per batch */
+					if (parse_size(opts[i].val, 1, &batch_size) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid batch size %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'd': { /* max delay of batched requests (milliseconds) */
+					if (parse_size(opts[i].val, 1, &batch_delay) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid batch delay %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 's': { /* spool file of undelivered requests */
+					spool_path = STRDUP(opts[i].val);
+					break;
+				}
+				case 'S': { /* max size of spool file (bytes) */
+					if (parse_size(opts[i].val, REQUEST_SPOOL_MIN_SIZE, &spool_size) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid spool size %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'R': { /* replay rate of spooled requests (per second) */
+					if (parse_size(opts[i].val, 1, &replay_rate) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid replay rate %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'f': { /* consecutive failures to skip requests (zero means never) */
+					if (parse_size(opts[i].val, 0, &breaker_threshold) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid failure threshold %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'w': { /* initial time to skip requests after failures (milliseconds) */
+					if (parse_size(opts[i].val, 1, &breaker_wait) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid failure wait time %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'i': { /* pattern of services to process */
+					if (compile_pattern(opts[i].val, &include_pattern) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid include pattern %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'e': { /* pattern of services to ignore */
+					if (compile_pattern(opts[i].val, &exclude_pattern) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid exclude pattern %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'D': { /* time to live of resolved remote host addresses (seconds, zero means no cache) */
+					if (parse_ttl(opts[i].val, &dns_ttl, &dns_negative_ttl) != NEB_OK) {
+						logging(LOG_ERROR, context, "Invalid DNS cache TTL %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
+				case 'T': { /* template of entity identifiers named after host and service */
+					free(entity_id_template);
+					entity_id_template = STRDUP(opts[i].val);
+					break;
+				}
+				case 'o': { /* overflow policy */
+					size_t pol;
+					char** ptr = (char**) overflow_policy_names;
+					for (pol = 0; *ptr && strcmp(*ptr, opts[i].val); ptr++, pol++);
+					if (*ptr) {
+						overflow_policy = pol;
+					} else {
+						logging(LOG_ERROR, context, "Invalid overflow policy %s", opts[i].val);
+						result = NEB_ERROR;
+					}
+					break;
+				}
 				case MISSING_VALUE: {
 					logging(LOG_ERROR, context, "Missing value for option -%c", (char) opts[i].err);
 					break;
@@ -165,9 +618,14 @@ int init_module_variables(char* args, context_t* context)
 		}
 	}
 
-	if (!adapter_url || !region_id) {
+	if (result == NEB_ERROR) {
+		/* invalid value of some option already logged */
+	} else if (!adapter_url || !region_id) {
 		logging(LOG_ERROR, context, "Missing required broker module options");
 		result = NEB_ERROR;
+	} else if (compile_request_templates((entity_id_template) ? entity_id_template : DEFAULT_ENTITY_ID_TEMPLATE,
+	                                     context) != NEB_OK) {
+		result = NEB_ERROR;
 	} else if (gethostname(name, HOST_NAME_MAX)) {
 		logging(LOG_ERROR, context, "Cannot get localhost name");
 		result = NEB_ERROR;
@@ -176,6 +634,10 @@ int init_module_variables(char* args, context_t* context)
 		result = NEB_ERROR;
 	} else {
 		host_addr = STRDUP(addr); /* keep a global copy of addr string */
+		if ((inflight_limit || batch_size) && !queue_size) {
+			/* concurrent or batched requests are only sent from sender threads */
+			queue_size = DEFAULT_QUEUE_SIZE;
+		}
 	}
 
 	free_option_list(opts);
@@ -186,10 +648,35 @@ int init_module_variables(char* args, context_t* context)
 	} else {
 		logging(LOG_INFO, context, "{"
 			" \"adapter_url\": \"%s\","
+			" \"adapter_url_count\": %lu,"
+			" \"adapter_socket\": \"%s\","
 			" \"region_id\": \"%s\","
-			" \"host_addr\": \"%s\""
+			" \"host_addr\": \"%s\","
+			" \"queue_size\": %lu,"
+			" \"sender_count\": %lu,"
+			" \"overflow_policy\": \"%s\","
+			" \"inflight_limit\": %lu,"
+			" \"inflight_min\": %lu,"
+			" \"batch_size\": %lu,"
+			" \"batch_delay\": %lu,"
+			" \"spool_path\": \"%s\","
+			" \"spool_size\": %lu,"
+			" \"replay_rate\": %lu,"
+			" \"breaker_threshold\": %lu,"
+			" \"breaker_wait\": %lu,"
+			" \"dns_ttl\": %lu,"
+			" \"dns_negative_ttl\": %lu,"
+			" \"entity_id_template\": \"%s\""
 			" }",
-			adapter_url, region_id, host_addr);
+			adapter_url, (unsigned long) adapter_url_count,
+			(adapter_socket) ? adapter_socket : "", region_id, host_addr,
+			(unsigned long) queue_size, (unsigned long) sender_count,
+			overflow_policy_names[overflow_policy], (unsigned long) inflight_limit, (unsigned long) inflight_min,
+			(unsigned long) batch_size, (unsigned long) batch_delay,
+			(spool_path) ? spool_path : "", (unsigned long) spool_size, (unsigned long) replay_rate,
+			(unsigned long) breaker_threshold, (unsigned long) breaker_wait,
+			(unsigned long) dns_ttl, (unsigned long) dns_negative_ttl,
+			(entity_id_template) ? entity_id_template : DEFAULT_ENTITY_ID_TEMPLATE);
 	}
 
 	return result;
@@ -199,21 +686,47 @@ int init_module_variables(char* args, context_t* context)
 /* deinitializes module variables */
 int free_module_variables(void)
 {
-	free(adapter_url);
+	while (adapter_url_count > 0) {
+		free(adapter_urls[--adapter_url_count]);
+	}
+	free(adapter_urls);
+	adapter_urls = NULL;
 	adapter_url = NULL;
+	free(adapter_socket);
+	adapter_socket = NULL;
 	free(region_id);
 	region_id = NULL;
 	free(host_addr);
 	host_addr = NULL;
+	queue_size = 0;
+	sender_count = DEFAULT_SENDER_COUNT;
+	overflow_policy = OVERFLOW_DROP_NEW;
+	inflight_limit = 0;
+	inflight_min = 0;
+	batch_size = 0;
+	batch_delay = DEFAULT_BATCH_DELAY;
+	free(spool_path);
+	spool_path = NULL;
+	spool_size = DEFAULT_SPOOL_SIZE;
+	replay_rate = DEFAULT_REPLAY_RATE;
+	breaker_threshold = DEFAULT_BREAKER_THRESHOLD;
+	breaker_wait = DEFAULT_BREAKER_WAIT;
+	free_pattern(&include_pattern);
+	free_pattern(&exclude_pattern);
+	dns_ttl = DEFAULT_DNS_TTL;
+	dns_negative_ttl = DEFAULT_DNS_NEGATIVE_TTL;
+	free(entity_id_template);
+	entity_id_template = NULL;
+	free_request_templates();
 	return NEB_OK;
 }
 
 
-/* writes a formatted string to Nagios log */
+/* writes a formatted string to Nagios log (or queues it, if not called from the main thread) */
 void logging(loglevel_t level, context_t* context, const char* format, ...)
 {
-	if (level <= log_level) {
-		char	buffer[MAXBUFLEN];
+	if ((level <= log_level) && !((level == LOG_WARN) && context && context->quiet)) {
+		char	buffer[2*MAXBUFLEN];
 		size_t	len;
 		va_list	ap;
 
@@ -224,10 +737,16 @@ void logging(loglevel_t level, context_t* context, const char* format, ...)
 			(context && context->op) ? context->op : "n/a");
 		va_start(ap, format);
 		len += vsnprintf(buffer+len, sizeof(buffer)-len-1, format, ap);
+		if (len > sizeof(buffer)-1) len = sizeof(buffer)-1;	/* message truncated */
 		buffer[len] = '\0';
 		va_end(ap);
 
-		write_to_log(buffer, NSLOG_INFO_MESSAGE, NULL);
+		if (logging_thread_set && !pthread_equal(pthread_self(), logging_thread)) {
+			defer_logging(buffer, len);
+		} else {
+			flush_logging();
+			write_to_log(buffer, NSLOG_INFO_MESSAGE, NULL);
+		}
 	}
 }
 
@@ -246,55 +765,110 @@ int resolve_address(const char* hostname, char* addr, size_t addrmaxlen)
 }
 
 
+/* creates the cache of addresses of remote hosts (unless disabled) */
+int init_remote_address_cache(context_t* context)
+{
+	int result = NEB_OK;
+
+	if (dns_ttl && ((dns_cache = dns_cache_create(dns_ttl * 1000, dns_negative_ttl * 1000, NULL)) == NULL)) {
+		logging(LOG_ERROR, context, "Could not create cache of remote host addresses");
+		result = NEB_ERROR;
+	}
+
+	return result;
+}
+
+
+/* releases the cache of addresses of remote hosts, logging its usage */
+void free_remote_address_cache(context_t* context)
+{
+	if (dns_cache != NULL) {
+		dns_cache_stats_t stats;
+		dns_cache_get_stats(dns_cache, &stats);
+		logging(LOG_INFO, context, "Resolutions of remote hosts: %lu hits, %lu misses, %lu refreshes",
+		        stats.hits, stats.misses, stats.refreshes);
+		dns_cache_free(dns_cache);
+		dns_cache = NULL;
+	}
+}
+
+
+/* resolves the IP address of a remote host, using the cache if enabled (may run in several warm-up threads
+ * at once: without cache, uses reentrant getaddrinfo() rather than gethostbyname() and its static result) */
+int resolve_remote_address(const char* hostname, char* addr, size_t addrmaxlen)
+{
+	int result = NEB_OK;
+
+	if (dns_cache == NULL) {
+		result = (dns_resolve(hostname, addr, addrmaxlen) == 0) ? NEB_OK : NEB_ERROR;
+	} else if (dns_cache_resolve(dns_cache, hostname, addr, addrmaxlen) != 0) {
+		result = NEB_ERROR;
+	}
+
+	return result;
+}
+
+
 /* gets the command name, arguments and other details of the executed plugin */
-char* find_plugin_command_name(nebstruct_service_check_data* data, char** args, int* nrpe, const service** serv)
+char* find_plugin_command_name(nebstruct_service_check_data* data, char** args, int* nrpe, const service** serv,
+                               arena_t* arena)
 {
 	host*    check_host	= NULL;
 	service* check_service	= NULL;
 	command* check_command	= NULL;
 	char*    result		= NULL;
 	int      is_nrpe	= 0;
+	char*    command_name	= NULL;
+	char*    command_args	= NULL;
+	char*    service_check_command = NULL;
 
-	if (((check_host = find_host(data->host_name)) != NULL)
-	    && ((check_service = find_service(data->host_name, data->service_description)) != NULL)) {
+	/* use objects resolved by Nagios, if available (fallback to lookup by name) */
+	if (((check_service = SERVICE_CHECK_OBJECT(data)) != NULL)
+	    && ((check_host = SERVICE_HOST_OBJECT(check_service)) != NULL)
+	    && ((check_command = SERVICE_COMMAND_OBJECT(check_service)) != NULL)) {
+		command_name = check_command->name;
+		command_args = strchr(SERVICE_CHECK_COMMAND(check_service), '!');
+		command_args = (command_args) ? command_args + 1 : "";
+	} else if (((check_host = find_host(data->host_name)) != NULL)
+	           && ((check_service = find_service(data->host_name, data->service_description)) != NULL)) {
+		service_check_command = arena_strdup(arena, SERVICE_CHECK_COMMAND(check_service));
+		command_name = strtok_r(service_check_command, "!", &command_args);
+		check_command = find_command(command_name);
+	} else {
+		check_service = NULL;
+	}
+
+	/* plugin command found */
+	if (check_command != NULL) {
 		char* ptr;
 		char* last;
-		char* command_name;
-		char* command_args;
-		char* service_check_command = STRDUP(SERVICE_CHECK_COMMAND(check_service));
-		command_name = strtok_r(service_check_command, "!", &command_args);
-		/* finds plugin command */
-		if ((check_command = find_command(command_name)) != NULL) {
-			/* fill in plugin arguments */
-			if (args != NULL) {
-				nagios_macros	mac;
-				char*		raw = NULL;
-				char*		cmd = NULL;
-				memset(&mac, 0, sizeof(mac));
-				grab_host_macros_r(&mac, check_host);
-				grab_service_macros_r(&mac, check_service);
-				get_raw_command_line_r(&mac, check_command,
-				                       check_service->service_check_command,
-				                       &raw, 0);
-				if (raw == NULL) {
-					*args = NULL;
-				} else {
-					char* exec;
-					process_macros_r(&mac, raw, &cmd, 0);
-					strtok_r(cmd, " \t", &last);
-					ptr = strrchr(cmd, '/');
-					exec = (ptr) ? ++ptr : cmd;
-					*args = STRDUP(last);
-					is_nrpe = !strcmp(exec, NRPE_PLUGIN);
-				}
-				my_free(raw);
-				my_free(cmd);
+		/* fill in plugin arguments */
+		if (args != NULL) {
+			nagios_macros	mac;
+			char*		raw = NULL;
+			char*		cmd = NULL;
+			memset(&mac, 0, sizeof(mac));
+			grab_host_macros_r(&mac, check_host);
+			grab_service_macros_r(&mac, check_service);
+			get_raw_command_line_r(&mac, check_command,
+			                       SERVICE_CHECK_COMMAND(check_service),
+			                       &raw, 0);
+			if (raw == NULL) {
+				*args = NULL;
+			} else {
+				char* exec;
+				process_macros_r(&mac, raw, &cmd, 0);
+				strtok_r(cmd, " \t", &last);
+				ptr = strrchr(cmd, '/');
+				exec = (ptr) ? ++ptr : cmd;
+				*args = arena_strdup(arena, last);
+				is_nrpe = !strcmp(exec, NRPE_PLUGIN);
 			}
-			/* command name (after resolving NRPE remote command) */
-			result = STRDUP((is_nrpe) ? command_args : command_name);
+			my_free(raw);
+			my_free(cmd);
 		}
-		free(service_check_command);
-		service_check_command = NULL;
+		/* command name (after resolving NRPE remote command) */
+		result = arena_strdup(arena, (is_nrpe) ? command_args : command_name);
 	}
 	/* output arguments */
 	if (nrpe != NULL) *nrpe = is_nrpe;
@@ -303,77 +877,447 @@ char* find_plugin_command_name(nebstruct_service_check_data* data, char** args,
 }
 
 
+/* checks whether a service is excluded by include and exclude patterns */
+int is_service_excluded(const char* host_name, const char* description)
+{
+	return ((include_pattern != NULL)
+	        && regexec(include_pattern, host_name, 0, NULL, 0)
+	        && regexec(include_pattern, description, 0, NULL, 0))
+	    || ((exclude_pattern != NULL)
+	        && (!regexec(exclude_pattern, host_name, 0, NULL, 0)
+	            || !regexec(exclude_pattern, description, 0, NULL, 0)));
+}
+
+
+/* names of macros whose values only depend on object definitions (and prefixes of such names) */
+static const char* static_macro_names[]    = { "HOSTNAME", "HOSTALIAS", "HOSTADDRESS", "HOSTDISPLAYNAME",
+                                               "SERVICEDESC", "SERVICEDISPLAYNAME", NULL };
+static const char* static_macro_prefixes[] = { "USER", "ARG", "_HOST", "_SERVICE", NULL };
+
+
+/* checks whether all the macros referenced in a string are static */
+static int has_static_macros(const char* str)
+{
+	const char*	start;
+	const char*	end;
+	const char**	ptr;
+	size_t		len;
+
+	for (start = strchr(str, '$'); start && (end = strchr(start + 1, '$')); start = strchr(end + 1, '$')) {
+		int found = 0;
+		if ((len = end - start - 1) == 0) {
+			continue;	/* escaped `$$` */
+		}
+		for (ptr = static_macro_names; *ptr && !found; ptr++) {
+			found = (strlen(*ptr) == len) && !strncmp(start + 1, *ptr, len);
+		}
+		for (ptr = static_macro_prefixes; *ptr && !found; ptr++) {
+			found = (strlen(*ptr) < len) && !strncmp(start + 1, *ptr, strlen(*ptr))
+			     && !memchr(start + 1, ':', len);	/* on-demand macros refer to other objects */
+		}
+		if (!found) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+/* checks whether the command line of a service check only references static macros */
+int is_check_command_static(const service* serv)
+{
+	command*	check_command = NULL;
+	char*		name = NULL;
+	char*		last = NULL;
+
+	if (serv == NULL) {
+		return 0;
+	} else if ((check_command = SERVICE_COMMAND_OBJECT(serv)) == NULL) {
+		/* may run in several warm-up threads at once: strtok() is not reentrant */
+		name = STRDUP(SERVICE_CHECK_COMMAND(serv));
+		check_command = (name) ? find_command(strtok_r(name, "!", &last)) : NULL;
+		free(name);
+	}
+
+	return (check_command != NULL)
+	    && has_static_macros(SERVICE_CHECK_COMMAND(serv))
+	    && has_static_macros(check_command->command_line);
+}
+
+
+/* custom variables relevant to this module, with the offset of their values in ::service_vars_t */
+static const struct {
+	const char*	name;
+	size_t		offset;
+} service_var_index[] = {
+	{ CUSTOM_VAR_ENTITY_TYPE,	offsetof(service_vars_t, entity_type) },
+	{ NULL,				0 }
+};
+
+
+/* finds the custom variables of a service relevant to this module */
+void find_service_vars(const service* serv, service_vars_t* vars)
+{
+	customvariablesmember*	var;
+	size_t			i;
+
+	memset(vars, 0, sizeof(service_vars_t));
+	for (var = serv->custom_variables; var != NULL; var = var->next) {
+		for (i = 0; service_var_index[i].name != NULL; i++) {
+			const char** value = (const char**) ((char*) vars + service_var_index[i].offset);
+			if ((*value == NULL) && !strcmp(var->variable_name, service_var_index[i].name)) {
+				*value = var->variable_value;
+				break;
+			}
+		}
+	}
+}
+
+
+/* gets the cached route of a service (NULL if not cached) */
+static const char* get_cached_route(const char* host_name, const char* description, const service* serv)
+{
+	const char*	route = NULL;
+	size_t		id    = (serv != NULL) ? SERVICE_ID(serv) : service_slots;
+
+	if (route_cache == NULL) {
+		/* nothing to do: routes not cached */
+	} else if (id < service_slots) {
+		route = (!(service_flags[id] & SERVICE_ROUTE_CACHED)) ? NULL
+		      : (service_flags[id] & SERVICE_ROUTE_IGNORED) ? ADAPTER_REQUEST_IGNORE
+		      : service_routes[id];
+	} else {
+		route = route_cache_get(route_cache, host_name, description);
+	}
+
+	return route;
+}
+
+
+/* caches the route of a service, replacing the previous one (if any) */
+static int put_cached_route(const char* host_name, const char* description, const service* serv, const char* route)
+{
+	int	result = NEB_OK;
+	size_t	id     = (serv != NULL) ? SERVICE_ID(serv) : service_slots;
+	int	ignore = !strcmp(route, ADAPTER_REQUEST_IGNORE);
+
+	if (route_cache == NULL) {
+		result = NEB_ERROR;
+	} else if (id >= service_slots) {
+		result = (route_cache_put(route_cache, host_name, description, route) == 0) ? NEB_OK : NEB_ERROR;
+	} else {
+		const char* interned = NULL;
+		if (!ignore
+		    && (((route_pool == NULL) && ((route_pool = string_pool_create()) == NULL))
+		        || ((interned = string_pool_intern(route_pool, route)) == NULL))) {
+			result = NEB_ERROR;
+		} else {
+			if (service_flags[id] & SERVICE_ROUTE_CACHED) {
+				service_cached--;
+			}
+			service_routes[id] = interned;
+			service_flags[id]  = SERVICE_ROUTE_CACHED | ((ignore) ? SERVICE_ROUTE_IGNORED : 0);
+			service_cached++;
+		}
+	}
+
+	return result;
+}
+
+
+/* forgets the cached route of a service (if any), to be computed again on its next check */
+static void forget_cached_route(const char* host_name, const char* description)
+{
+	const service*	serv = find_service((char*) host_name, (char*) description);
+	size_t		id   = (serv != NULL) ? SERVICE_ID(serv) : service_slots;
+
+	if (route_cache == NULL) {
+		/* nothing to do: routes not cached */
+	} else if (id >= service_slots) {
+		route_cache_remove(route_cache, host_name, description);
+	} else if (service_flags[id] & SERVICE_ROUTE_CACHED) {
+		service_routes[id] = NULL;
+		service_flags[id]  = 0;
+		service_cached--;
+	}
+}
+
+
+/* route of a service computed in advance */
+typedef struct {
+	service*	serv;
+	char*		route;		/* request URL (ADAPTER_REQUEST_INVALID if not computed) */
+	int		cacheable;	/* whether route may be cached (not depending on volatile macros nor addresses) */
+} warmup_slot_t;
+
+
+/* services whose routes are computed in advance by a number of threads */
+typedef struct {
+	warmup_slot_t*	slots;
+	size_t		count;
+	size_t		next;		/* next slot to be taken by a thread */
+} warmup_t;
+
+
+/* computes the routes of services in advance, taking slots until none is left */
+static void* warm_up_thread(void* arg)
+{
+	warmup_t*	warmup  = (warmup_t*) arg;
+	char		buffer[ARENA_BUFFER_SIZE];
+	arena_t		arena;
+	context_t	context = { .op = "Warmup", .quiet = 1, .arena = arena_init(&arena, buffer, sizeof(buffer)) };
+	size_t		i;
+
+	while ((i = __atomic_fetch_add(&warmup->next, 1, __ATOMIC_RELAXED)) < warmup->count) {
+		warmup_slot_t*			slot = &warmup->slots[i];
+		nebstruct_service_check_data	data;
+
+		memset(&data, 0, sizeof(data));
+		data.host_name           = slot->serv->host_name;
+		data.service_description = slot->serv->description;
+#if (CURRENT_OBJECT_STRUCTURE_VERSION >= 400)
+		data.object_ptr          = slot->serv;
+#endif
+		if (is_service_excluded(slot->serv->host_name, slot->serv->description) || is_service_ignored(slot->serv)) {
+			slot->route     = STRDUP(ADAPTER_REQUEST_IGNORE);
+			slot->cacheable = 1;
+		} else if ((slot->cacheable = is_check_command_static(slot->serv))) {
+			context.uncacheable = 0;
+			slot->route     = get_adapter_request(&data, &context);
+			slot->cacheable = !context.uncacheable;
+		}
+		arena_reset(&arena);
+	}
+
+	return NULL;
+}
+
+
+/* computes the routes of all services in parallel (also resolving remote hosts), adding them to the route cache */
+static void warm_up_routes(context_t* context)
+{
+	warmup_t	warmup = { .slots = NULL, .count = 0, .next = 0 };
+	pthread_t	threads[MAX_WARMUP_THREADS];
+	size_t		thread_count = 0, ignored = 0, failed = 0, uncached = 0, i;
+	long		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	struct timespec	start, end;
+	service*	serv;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (serv = service_list; serv != NULL; serv = serv->next) {
+		warmup.count++;
+	}
+	if ((warmup.count == 0) || ((warmup.slots = (warmup_slot_t*) calloc(warmup.count, sizeof(warmup_slot_t))) == NULL)) {
+		return;
+	}
+	for (serv = service_list, i = 0; serv != NULL; serv = serv->next, i++) {
+		warmup.slots[i].serv = serv;
+	}
+
+	/* Nagios main thread also takes slots, and waits for all routes (so that objects don't change meanwhile) */
+	while ((thread_count + 1 < MAX_WARMUP_THREADS) && ((long) thread_count + 1 < cpus) && (thread_count + 1 < warmup.count)
+	       && (pthread_create(&threads[thread_count], NULL, warm_up_thread, &warmup) == 0)) {
+		thread_count++;
+	}
+	warm_up_thread(&warmup);
+	for (i = 0; i < thread_count; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	for (i = 0; i < warmup.count; i++) {
+		warmup_slot_t* slot = &warmup.slots[i];
+		if (!slot->cacheable) {
+			uncached++;
+		} else if (slot->route == ADAPTER_REQUEST_INVALID) {
+			failed++;
+		} else if (put_cached_route(slot->serv->host_name, slot->serv->description, slot->serv, slot->route) != NEB_OK) {
+			uncached++;
+		} else if (!strcmp(slot->route, ADAPTER_REQUEST_IGNORE)) {
+			ignored++;
+		}
+		free(slot->route);
+	}
+	free(warmup.slots);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	logging((failed) ? LOG_WARN : LOG_INFO, context,
+	        "Routes of %lu services computed in %ld ms by %lu threads: %lu ignored, %lu not cached, %lu failed%s",
+	        (unsigned long) warmup.count,
+	        (long) ((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000),
+	        (unsigned long) thread_count + 1, (unsigned long) ignored, (unsigned long) uncached, (unsigned long) failed,
+	        (failed) ? " (missing details or unresolvable hosts, retried on every check)" : "");
+}
+
+
 /* Nagios service check callback */
 int callback_service_check(int callback_type, void* data)
 {
 	int				result		= NEB_OK;
 	nebstruct_service_check_data*	check_data	= NULL;
 	char*				request_url	= NULL;
-	struct curl_slist*		curl_headers	= NULL;
-	CURL*				curl_handle	= NULL;
-	CURLcode			curl_result	= CURLE_OK;
+	const char*			route		= NULL;
 
-	#define HDRLEN			MAXBUFLEN
-	#define HDRSTRING		CORRELATOR_HTTP_HEADER ": " "n/a"
-	#define HDRTXOFFSET		(CORRELATOR_HTTP_HEADER_LEN + 2)	/* includes length of ": " separator */
 	#define CORRELATOR_PREFIX	"......"				/* six chars for the l64a prefix     */
 	#define CORRELATOR_PATTERN	"XXXXXX"				/* six chars for the mktemp pattern  */
 
-	char				corrHdr[HDRLEN]	= HDRSTRING;
+	adapter_request_t		request;
 	char*				corrPrefix	= NULL;
-	char*				correlator	= corrHdr + HDRTXOFFSET;
+	char*				correlator	= request.corr;
 	const char*			operation	= "NGSIAdapter";
-	context_t			context		= { .corr = correlator, .op = operation };
+	char				buffer[ARENA_BUFFER_SIZE];
+	arena_t				arena;
+	context_t			context		= { .corr = correlator, .op = operation,
+	                                                    .arena = arena_init(&arena, buffer, sizeof(buffer)) };
 
 	assert(strlen(CORRELATOR_HTTP_HEADER) == CORRELATOR_HTTP_HEADER_LEN);
+	assert(strlen(CORRELATOR_PREFIX "" CORRELATOR_PATTERN) == CORRELATOR_LEN);
 
 	assert(callback_type == NEBCALLBACK_SERVICE_CHECK_DATA);
 	check_data = (nebstruct_service_check_data*) data;
+	flush_logging();
 
 	/* Process output only AFTER plugin is executed */
 	if (check_data->type != NEBTYPE_SERVICECHECK_PROCESSED) {
 		return result;
 	}
 
+	/* Discard results of ignored services as soon as possible */
+	if (((route = get_cached_route(check_data->host_name, check_data->service_description,
+	                               SERVICE_CHECK_OBJECT(check_data))) != NULL)
+	    && !strcmp(route, ADAPTER_REQUEST_IGNORE)) {
+		return result;
+	}
+
 	/* Generate correlator to include in a HTTP header for the request */
-	strncpy(correlator, CORRELATOR_PREFIX "" CORRELATOR_PATTERN, HDRLEN - HDRTXOFFSET - 1);
+	strcpy(correlator, CORRELATOR_PREFIX "" CORRELATOR_PATTERN);
 	corrPrefix = l64a((long) time(NULL));
 	mktemp(correlator);
 	memcpy(correlator, corrPrefix, strlen(corrPrefix));
-	corrHdr[HDRLEN - 1] = '\0';
 	logging(LOG_DEBUG, &context, "New service check");
 
-	/* Async POST request to NGSI Adapter */
-	if ((request_url = get_adapter_request(check_data, &context)) == ADAPTER_REQUEST_INVALID) {
+	/* Async POST request to NGSI Adapter (reusing the route of previous results, if cached) */
+	if (route != NULL) {
+		request_url = STRDUP(route);
+	} else if (is_service_excluded(check_data->host_name, check_data->service_description)) {
+		logging(LOG_DEBUG, &context, "Ignoring data from excluded service %s", check_data->service_description);
+		request_url = STRDUP(ADAPTER_REQUEST_IGNORE);
+	} else {
+		request_url = get_adapter_request(check_data, &context);
+	}
+
+	/* cache the route, unless it depends on volatile macros (thus check command is expanded every time) or on
+	   addresses of remote hosts (resolved every time, from the cache of resolutions) */
+	if ((request_url == ADAPTER_REQUEST_INVALID) || (route != NULL) || (route_cache == NULL)) {
+		/* nothing to cache */
+	} else if (context.uncacheable) {
+		logging(LOG_DEBUG, &context, "Adapter request URL not cached: it includes a resolved address");
+	} else if (strcmp(request_url, ADAPTER_REQUEST_IGNORE)
+	           && !is_check_command_static((SERVICE_CHECK_OBJECT(check_data))
+	                                       ? SERVICE_CHECK_OBJECT(check_data)
+	                                       : find_service(check_data->host_name, check_data->service_description))) {
+		logging(LOG_DEBUG, &context, "Adapter request URL not cached: check command has volatile macros");
+	} else if (put_cached_route(check_data->host_name, check_data->service_description,
+	                            SERVICE_CHECK_OBJECT(check_data), request_url) != NEB_OK) {
+		logging(LOG_DEBUG, &context, "Cannot cache adapter request URL");
+	}
+
+	if (request_url == ADAPTER_REQUEST_INVALID) {
 		logging(LOG_ERROR, &context, "Cannot set adapter request URL");
 	} else if (!strcmp(request_url, ADAPTER_REQUEST_IGNORE)) {
 		/* nothing to do: plugin is ignored */
-	} else if ((curl_handle = curl_easy_init()) == NULL) {
-		logging(LOG_ERROR, &context, "Cannot open HTTP session");
 	} else {
-		char request_txt[MAXBUFLEN];
-		snprintf(request_txt, sizeof(request_txt)-1, "%s|%s",
-		         check_data->output, check_data->perf_data);
-		request_txt[sizeof(request_txt)-1] = '\0';
-		curl_headers = curl_slist_append(curl_headers, "Content-Type: text/plain");
-		curl_headers = curl_slist_append(curl_headers, corrHdr);
-		curl_easy_setopt(curl_handle, CURLOPT_URL, request_url);
-		curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
-		curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, request_txt);
-		curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, strlen(request_txt));
-		curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, curl_headers);
-		if ((curl_result = curl_easy_perform(curl_handle)) == CURLE_OK) {
-			logging(LOG_INFO, &context, "Request sent to %s",
-			        request_url);
-		} else {
-			logging(LOG_WARN, &context, "Request to %s failed: %s",
-			        request_url, curl_easy_strerror(curl_result));
-		}
-		curl_slist_free_all(curl_headers);
-		curl_easy_cleanup(curl_handle);
-		curl_handle = NULL;
+		/* body "output|perfdata" followed by long output lines (if any), not copied unless queued */
+		const adapter_body_part_t parts[] = {
+			{ .data = check_data->output },
+			{ .data = "|" },
+			{ .data = check_data->perf_data },
+			{ .data = "\n" },
+			{ .data = check_data->long_output, .escaped = 1 }
+		};
+		request.url        = request_url;
+		request.body       = NULL;
+		request.parts      = parts;
+		request.part_count = sizeof(parts) / sizeof(parts[0]);
+		request_url        = NULL;	/* ownership taken by dispatch_adapter_request() */
+		dispatch_adapter_request(&request, &context);
 	}
 	free(request_url);
 	request_url = NULL;
+	arena_reset(&arena);	/* transient strings of this check result */
 	return result;
 }
+
+
+/* Nagios process callback */
+int callback_process(int callback_type, void* data)
+{
+	nebstruct_process_data*	process_data	= (nebstruct_process_data*) data;
+	context_t		context		= { .op = "Process" };
+
+	assert(callback_type == NEBCALLBACK_PROCESS_DATA);
+
+	/* object definitions are stable while the event loop runs */
+	if (process_data->type == NEBTYPE_PROCESS_EVENTLOOPSTART) {
+		if (route_cache != NULL) {
+			route_cache_clear(route_cache);
+		} else if ((route_cache = route_cache_create(ROUTE_CACHE_BUCKETS)) == NULL) {
+			logging(LOG_WARN, &context, "Cannot create route cache: routes will be computed for every check");
+		}
+		if (resize_service_states(NAGIOS_SERVICE_COUNT) != NEB_OK) {
+			logging(LOG_WARN, &context, "Cannot index state of %lu services: routes cached by name",
+			        (unsigned long) NAGIOS_SERVICE_COUNT);
+		}
+		if (route_cache != NULL) {
+			warm_up_routes(&context);
+		}
+	} else if ((process_data->type == NEBTYPE_PROCESS_RESTART)
+	           || (process_data->type == NEBTYPE_PROCESS_SHUTDOWN)
+	           || (process_data->type == NEBTYPE_PROCESS_EVENTLOOPEND)) {
+		clear_service_states();		/* ids may change after reload, kept sized until event loop starts */
+		route_cache_free(route_cache);
+		route_cache = NULL;
+	}
+
+	return NEB_OK;
+}
+
+
+/* Nagios external command callback */
+int callback_external_command(int callback_type, void* data)
+{
+	nebstruct_external_command_data*	command_data = (nebstruct_external_command_data*) data;
+	const char*				name         = command_data->command_string;
+	context_t				context      = { .op = "Process" };
+	char					args[MAXBUFLEN] = "";	/* truncated args stay terminated */
+	char*					last = NULL;
+	char*					host_name;
+	char*					description;
+	service*				serv;
+
+	assert(callback_type == NEBCALLBACK_EXTERNAL_COMMAND_DATA);
+
+	/* changes of service or host definitions are applied before END event: routes only depend on the check
+	   command and custom variables of services (or those of their hosts, referenced by check command macros) */
+	if ((command_data->type != NEBTYPE_EXTERNALCOMMAND_END) || (route_cache == NULL)
+	    || (name == NULL) || (command_data->command_args == NULL)) {
+		/* nothing to do: no cached routes may change */
+	} else if (strcmp(name, "CHANGE_CUSTOM_HOST_VAR") && strcmp(name, "CHANGE_CUSTOM_SVC_VAR")
+	           && strcmp(name, "CHANGE_SVC_CHECK_COMMAND")) {
+		/* nothing to do: command not affecting routes */
+	} else if ((host_name = strtok_r(strncpy(args, command_data->command_args, sizeof(args) - 1), ";", &last)) == NULL) {
+		/* nothing to do: no host given */
+	} else if (!strcmp(name, "CHANGE_CUSTOM_HOST_VAR")) {
+		logging(LOG_DEBUG, &context, "Forgetting cached routes of services of %s after %s", host_name, name);
+		for (serv = service_list; serv != NULL; serv = serv->next) {
+			if (!strcmp(serv->host_name, host_name)) {
+				forget_cached_route(serv->host_name, serv->description);
+			}
+		}
+	} else if ((description = strtok_r(NULL, ";", &last)) != NULL) {
+		logging(LOG_DEBUG, &context, "Forgetting cached route of %s on %s after %s", description, host_name, name);
+		forget_cached_route(host_name, description);
+	}
+
+	return NEB_OK;
+}
@@ -34,9 +34,12 @@ extern "C" {
 #endif
 
 
+#include <regex.h>
 #include "objects.h"
 #include "nebmodules.h"
 #include "nebstructs.h"
+#include "arena.h"
+#include "url_template.h"
 
 
 /**
@@ -85,6 +88,9 @@ static const char* loglevel_names[] = {
 typedef struct {
 	const char* corr;		/**< The correlation id */
 	const char* op;			/**< The operation name */
+	int         quiet;		/**< Whether warnings are not logged (but summarized by the caller) */
+	arena_t*    arena;		/**< Arena for the transient strings of the operation (may be null) */
+	int         uncacheable;	/**< Whether the request composed depends on data that may change between checks */
 } context_t;
 
 /** HTTP header for correlation */
@@ -93,6 +99,63 @@ typedef struct {
 /** Length of ::CORRELATOR_HTTP_HEADER */
 #define CORRELATOR_HTTP_HEADER_LEN	17
 
+/** Length of correlators generated by this module */
+#define CORRELATOR_LEN			12
+
+/**@}*/
+
+
+/**
+ * @name Request queueing
+ * @{
+ */
+
+/** Policies to apply when the queue of pending requests is full */
+typedef enum {
+	OVERFLOW_DROP_NEW,		/**< Discard the new request */
+	OVERFLOW_DROP_OLD		/**< Discard the oldest request in the queue */
+} overflow_policy_t;
+
+/** Overflow policy names, indexed by value */
+static const char* overflow_policy_names[] = {
+	"drop_new",
+	"drop_old",
+	NULL
+};
+
+/** Default number of sender threads when requests are queued */
+#define DEFAULT_SENDER_COUNT		1
+
+/** Default capacity of the queue when concurrent or batched requests are enabled but no queue size is given */
+#define DEFAULT_QUEUE_SIZE		1024
+
+/** Default maximum delay (in milliseconds) of the first request of a batch */
+#define DEFAULT_BATCH_DELAY		1000
+
+/** Default size in bytes of the spool file of undelivered requests */
+#define DEFAULT_SPOOL_SIZE		67108864
+
+/** Default rate (requests per second) at which spooled requests are replayed */
+#define DEFAULT_REPLAY_RATE		10
+
+/** Default number of consecutive failures that make requests to NGSI Adapter be skipped for a while */
+#define DEFAULT_BREAKER_THRESHOLD	5
+
+/** Default time (in milliseconds) requests are skipped before retrying NGSI Adapter (doubled on every failed retry) */
+#define DEFAULT_BREAKER_WAIT		1000
+
+/** Maximum number of threads (including Nagios main thread) computing the routes of all services when the event loop starts */
+#define MAX_WARMUP_THREADS		8
+
+/** Default time (in seconds) resolved addresses of remote hosts are cached */
+#define DEFAULT_DNS_TTL			300
+
+/** Default time (in seconds) failed resolutions of remote hosts are cached */
+#define DEFAULT_DNS_NEGATIVE_TTL	30
+
+/** Default template of the identifier of entities named after their host and service (see ::entity_id_template) */
+#define DEFAULT_ENTITY_ID_TEMPLATE	"{region}:{host_name}:{service}"
+
 /**@}*/
 
 
@@ -108,6 +171,45 @@ typedef struct {
 #define SERVICE_CHECK_COMMAND(ptr)	(ptr)->check_command
 #endif
 
+/** Macros to get the id of a service and the number of services, as defined by Nagios 4.x (unavailable for Nagios 3.x) */
+#if (CURRENT_OBJECT_STRUCTURE_VERSION < 400)
+#define SERVICE_ID(ptr)			((size_t) -1)
+#define NAGIOS_SERVICE_COUNT		((size_t) 0)
+#else
+#define SERVICE_ID(ptr)			((size_t) (ptr)->id)
+#define NAGIOS_SERVICE_COUNT		((size_t) num_objects.services)
+#endif
+
+/** Macros to get the objects already resolved by Nagios 4.x (NULL for Nagios 3.x, so that they are looked up by name) */
+#if (CURRENT_OBJECT_STRUCTURE_VERSION < 400)
+#define SERVICE_CHECK_OBJECT(data)	((service*) NULL)
+#define SERVICE_HOST_OBJECT(ptr)	((host*) NULL)
+#define SERVICE_COMMAND_OBJECT(ptr)	((command*) NULL)
+#else
+#define SERVICE_CHECK_OBJECT(data)	((service*) (data)->object_ptr)
+#define SERVICE_HOST_OBJECT(ptr)	(ptr)->host_ptr
+#define SERVICE_COMMAND_OBJECT(ptr)	(ptr)->check_command_ptr
+#endif
+
+/**@}*/
+
+
+/**
+ * @name Nagios service custom variables
+ * @{
+ */
+
+/** Name of custom variable in service description. A custom variable "_entity_type" may
+ *  be included in Nagios configuration file when [defining a service](@NagiosCustomVars_ref);
+ *  such variable is renamed to be accesible from this module (converted to uppercase and
+ *  underscore removed). See ::customvariablesmember for details. */
+#define CUSTOM_VAR_ENTITY_TYPE		"ENTITY_TYPE"
+
+/** Custom variables of a service relevant to this module, whatever their position (see ::find_service_vars) */
+typedef struct {
+	const char*	entity_type;		/**< Value of ::CUSTOM_VAR_ENTITY_TYPE (NULL if not defined) */
+} service_vars_t;
+
 /**@}*/
 
 
@@ -145,12 +247,27 @@ typedef struct {
 /** Query string field holding the NGSI entity type */
 #define ADAPTER_QUERY_FIELD_TYPE	"type"
 
-/** Format spec, printf()-like, used in composing NGSI Adapter request URL. Please
- *  note that `id` comprises two colon-separated values (`id = region:uniqueid`)
- *  where `region` denotes the domain the entity belongs to. */
-#define ADAPTER_REQUEST_FORMAT		"%s/%s" \
-					"?" ADAPTER_QUERY_FIELD_ID "=%s:%s" \
-					"&" ADAPTER_QUERY_FIELD_TYPE "=%s"
+/** Template (see url_template.h) used in composing NGSI Adapter request URL, given
+ *  that of the entity identifier. Please note that `id` usually comprises several
+ *  colon-separated values (`id = region:uniqueid`) where `region` denotes the domain
+ *  the entity belongs to. */
+#define ADAPTER_REQUEST_TEMPLATE(id)	"{url}/{command}" \
+					"?" ADAPTER_QUERY_FIELD_ID "=" id \
+					"&" ADAPTER_QUERY_FIELD_TYPE "={type}"
+
+/** Entity identifier within ::ADAPTER_REQUEST_TEMPLATE standing for ::entity_id_template */
+#define ADAPTER_REQUEST_ENTITY_ID	"{" URL_TEMPLATE_NESTED "}"
+
+/** Scheme of NGSI Adapter URL to send requests as UDP datagrams (each one holding a record) */
+#define ADAPTER_UDP_SCHEME		"udp://"
+
+/** Name of the NGSI Adapter resource accepting batches of requests */
+#define ADAPTER_BATCH_RESOURCE		"_batch"
+
+/** Format spec, printf()-like, of the header of every record in a batch: the
+ *  request path and query string relative to adapter URL, the correlator and
+ *  the length of the body that follows the header (and a trailing newline) */
+#define ADAPTER_RECORD_FORMAT		"%s %s %lu\n"
 /**@}*/
 
 
@@ -179,6 +296,10 @@ extern char* const			module_version;
 /** Global handle of the module */
 extern void*				module_handle;
 
+/** Templates of the adapter request URLs composed by the specific module (null-terminated),
+ *  compiled into ::request_templates in the same order */
+extern const char* const		request_template_texts[];
+
 /**@}*/
 
 
@@ -187,9 +308,18 @@ extern void*				module_handle;
  * @{
  */
 
-/** URL of the NGSI Adapter to invoke to */
+/** URL of the NGSI Adapter to invoke to (the first one, if several are given) */
 extern char*				adapter_url;
 
+/** URLs of all the NGSI Adapter endpoints entities are distributed among */
+extern char**				adapter_urls;
+
+/** Number of NGSI Adapter endpoints */
+extern size_t				adapter_url_count;
+
+/** Path of the Unix domain socket to connect to NGSI Adapter through (if null, use TCP) */
+extern char*				adapter_socket;
+
 /** Identifier of the region the monitored entities belong to */
 extern char*				region_id;
 
@@ -199,6 +329,62 @@ extern char*				host_addr;
 /** Logging level */
 extern loglevel_t			log_level;
 
+/** Capacity of the queue of pending requests (zero means requests are sent synchronously) */
+extern size_t				queue_size;
+
+/** Number of threads sending queued requests */
+extern size_t				sender_count;
+
+/** Policy to apply when the queue of pending requests is full */
+extern overflow_policy_t		overflow_policy;
+
+/** Maximum number of concurrent requests per sender thread (zero means one at a time) */
+extern size_t				inflight_limit;
+
+/** Minimum number of concurrent requests per sender thread (zero means ::inflight_limit is fixed,
+ *  otherwise the actual limit is adjusted between both values according to adapter latency) */
+extern size_t				inflight_min;
+
+/** Maximum number of requests sent together in a batch (zero means no batching) */
+extern size_t				batch_size;
+
+/** Maximum delay (in milliseconds) of the first request of a batch before it is sent */
+extern size_t				batch_delay;
+
+/** Path of the spool file keeping undelivered requests (if null, such requests are discarded) */
+extern char*				spool_path;
+
+/** Maximum size in bytes of the spool file (oldest requests are discarded once full) */
+extern size_t				spool_size;
+
+/** Rate (requests per second) at which spooled requests are replayed */
+extern size_t				replay_rate;
+
+/** Number of consecutive failures that make requests be skipped (zero means requests are never skipped) */
+extern size_t				breaker_threshold;
+
+/** Initial time (in milliseconds) requests are skipped before retrying NGSI Adapter */
+extern size_t				breaker_wait;
+
+/** Pattern of host names or service descriptions to process (if null, all services not excluded) */
+extern regex_t*				include_pattern;
+
+/** Pattern of host names or service descriptions to ignore (if null, none is excluded) */
+extern regex_t*				exclude_pattern;
+
+/** Time (in seconds) resolved addresses of remote hosts are cached (zero means no cache),
+ *  also applied to the DNS cache of adapter hosts shared by HTTP sessions (zero means libcurl default) */
+extern size_t				dns_ttl;
+
+/** Time (in seconds) failed resolutions of remote hosts are cached */
+extern size_t				dns_negative_ttl;
+
+/** Template of the identifier of entities named after their host and service (if null, the default one) */
+extern char*				entity_id_template;
+
+/** Compiled templates of adapter request URLs (see ::request_template_texts) */
+extern url_template_t**			request_templates;
+
 /**@}*/
 
 
@@ -256,6 +442,9 @@ int init_module_handle_info(void* handle, context_t* context);
 /**
  * Composes the request to NGSI Adapter according to plugin data
  *
+ * Intermediate strings are allocated from the arena of the context (if any, or
+ * from a local one otherwise), whereas the returned URL is taken from heap.
+ *
  * @param[in] data			The plugin data passed by Nagios to the registered ::callback_service_check.
  * @param[in] context			The operations context (may be null).
  *
@@ -266,6 +455,16 @@ int init_module_handle_info(void* handle, context_t* context);
 char* get_adapter_request(nebstruct_service_check_data* data, context_t* context);
 
 
+/**
+ * Checks whether results of a service will always be ignored, given its definition
+ *
+ * @param[in] serv			The service definition.
+ *
+ * @return				True (non-zero) when ::get_adapter_request would return ::ADAPTER_REQUEST_IGNORE.
+ */
+int is_service_ignored(const service* serv);
+
+
 /**@}*/
 
 
@@ -306,6 +505,40 @@ int free_module_variables(void);
 int check_nagios_object_version(context_t* context);
 
 
+/**
+ * Checks whether a service is excluded by ::include_pattern and ::exclude_pattern
+ *
+ * @param[in] host_name			The host name of the service.
+ * @param[in] description		The service description.
+ *
+ * @return				True (non-zero) when the service is excluded.
+ */
+int is_service_excluded(const char* host_name, const char* description);
+
+
+/**
+ * Checks whether the check command of a service only references static macros
+ *
+ * Values of static macros (user macros, command arguments, names and addresses of
+ * host and service, and custom variables) only change along with object definitions,
+ * so that the adapter request of such a service may be reused for later results.
+ *
+ * @param[in] serv			The service.
+ *
+ * @return				True (non-zero) when no volatile macros (state, output, time...) are referenced.
+ */
+int is_check_command_static(const service* serv);
+
+
+/**
+ * Finds the custom variables of a service relevant to this module in a single scan
+ *
+ * @param[in]  serv			The service.
+ * @param[out] vars			The values of the custom variables (NULL if not defined).
+ */
+void find_service_vars(const service* serv, service_vars_t* vars);
+
+
 /**
  * Callback function invoked on ::NEBCALLBACK_SERVICE_CHECK_DATA events
  *
@@ -317,17 +550,54 @@ int check_nagios_object_version(context_t* context);
 int callback_service_check(int callback_type, void* data);
 
 
+/**
+ * Callback function invoked on ::NEBCALLBACK_PROCESS_DATA events
+ *
+ * Routes of adapter requests are cached only while the event loop runs (that is,
+ * once Nagios object definitions are loaded), and are flushed on restart. When
+ * the event loop starts, services to be ignored are found in advance, so that
+ * their results are discarded before any further processing.
+ *
+ * @param[in] callback_type		The event type (always ::NEBCALLBACK_PROCESS_DATA).
+ * @param[in] data			The event data (::nebstruct_process_data*).
+ *
+ * @retval NEB_OK			Regardless event processing result, NEB_OK is returned.
+ */
+int callback_process(int callback_type, void* data);
+
+
+/**
+ * Callback function invoked on ::NEBCALLBACK_EXTERNAL_COMMAND_DATA events
+ *
+ * The cached route of a service is forgotten after `CHANGE_SVC_CHECK_COMMAND`
+ * and `CHANGE_CUSTOM_SVC_VAR` external commands about it, and those of all the
+ * services of a host after `CHANGE_CUSTOM_HOST_VAR` (as check commands may refer
+ * to host custom variables). Other commands don't affect routes.
+ *
+ * @param[in] callback_type		The event type (always ::NEBCALLBACK_EXTERNAL_COMMAND_DATA).
+ * @param[in] data			The event data (::nebstruct_external_command_data*).
+ *
+ * @retval NEB_OK			Regardless event processing result, NEB_OK is returned.
+ */
+int callback_external_command(int callback_type, void* data);
+
+
 /**
  * Gets command details of executed plugin from event data passed to ::callback_service_check
  *
+ * With Nagios 4.x, the service, host and command objects already resolved by
+ * Nagios are taken from the event data; otherwise, they are looked up by name.
+ *
  * @param[in]  data			The event data.
  * @param[out] args			The command line arguments of executed plugin.
  * @param[out] nrpe			True (non-zero) when plugin is remotely executed via NRPE.
  * @param[out] serv			The details of service definition associated to the plugin.
+ * @param[in]  arena			The arena where command name and arguments are allocated.
  *
  * @return			The command name (may not coincide with executable name) of executed plugin.
  */
-char* find_plugin_command_name(nebstruct_service_check_data* data, char** args, int* nrpe, const service** serv);
+char* find_plugin_command_name(nebstruct_service_check_data* data, char** args, int* nrpe, const service** serv,
+                               arena_t* arena);
 
 
 /**
@@ -344,7 +614,43 @@ int resolve_address(const char* hostname, char* addr, size_t addrmaxlen);
 
 
 /**
- * Writes a formatted message to Nagios log
+ * Creates the cache of addresses of remote hosts, unless disabled (see ::dns_ttl)
+ *
+ * @param[in] context			The operations context (may be null).
+ *
+ * @retval NEB_OK			Successfully created (or disabled).
+ * @retval NEB_ERROR			Not successfully created.
+ */
+int init_remote_address_cache(context_t* context);
+
+
+/**
+ * Releases the cache of addresses of remote hosts (if any)
+ *
+ * @param[in] context			The operations context (may be null).
+ */
+void free_remote_address_cache(context_t* context);
+
+
+/**
+ * Resolves a given remote hostname to get the IP address, avoiding DNS queries
+ * while the address is kept in the cache (see ::dns_ttl). Unlike ::resolve_address,
+ * it is thread-safe even with the cache disabled
+ *
+ * @param[in]  hostname			The hostname.
+ * @param[in]  addr			The buffer where IP address will be written to.
+ * @param[in]  addrmaxlen		The length of the buffer.
+ *
+ * @retval NEB_OK			Successfully resolved.
+ * @retval NEB_ERROR			Not successfully resolved.
+ */
+int resolve_remote_address(const char* hostname, char* addr, size_t addrmaxlen);
+
+
+/**
+ * Writes a formatted message to Nagios log (messages from threads other than
+ * Nagios main thread are queued, and written as soon as the latter logs or
+ * processes a service check)
  *
  * @param[in] level			The logging level.
  * @param[in] context			The operations context (may be null).
@@ -25,7 +25,8 @@
  *
  * - [FIWARE GEri global instances](@FIWARE_GEri_ref). There are no restrictions on the command names and the plugins to
  *   be used, but the resulting NGSI entity type must be explicitly given with a custom variable "_entity_type" in the
- *   service definition (or using a service template). Entity identifier will be "{region}:{host_name}:{service_desc}".
+ *   service definition (or using a service template). Entity identifier will be "{region}:{host_name}:{service_desc}",
+ *   unless other template is given as module argument.
  */
 
 
@@ -69,6 +70,13 @@ char* const module_version		= MODULE_VERSION;
 void*       module_handle		= NULL;
 
 
+/* define adapter request templates (previously declared) */
+const char* const request_template_texts[] = {
+	[GE_REQUEST_TEMPLATE]		= GE_ADAPTER_REQUEST_TEMPLATE,
+	NULL
+};
+
+
 /* initializes module handle and info (name and version) */
 int init_module_handle_info(void* handle, context_t* context)
 {
@@ -91,10 +99,19 @@ char* get_adapter_request(nebstruct_service_check_data* data, context_t* context
 	char* args   = NULL;
 	int   nrpe   = 0;
 
+	/* Transient strings taken from the arena of the context, or from a local one */
+	char     buffer[ARENA_BUFFER_SIZE];
+	arena_t  local;
+	arena_t* arena = (context && context->arena) ? context->arena : arena_init(&local, buffer, sizeof(buffer));
+
 	/* Build request according to plugin details */
 	const service* serv;
 
-	if ((name = find_plugin_command_name(data, &args, &nrpe, &serv)) == NULL) {
+	if (((serv = SERVICE_CHECK_OBJECT(data)) != NULL) && is_service_ignored(serv)) {
+		/* service already known (Nagios 4.x): skip plugin details */
+		logging(LOG_DEBUG, context, "Ignoring data from service %s", serv->description);
+		result = STRDUP(ADAPTER_REQUEST_IGNORE);
+	} else if ((name = find_plugin_command_name(data, &args, &nrpe, &serv, arena)) == NULL) {
 		logging(LOG_WARN, context, "Cannot get plugin command name");
 		result = STRDUP(ADAPTER_REQUEST_INVALID);
 	} else if (args == NULL) {
@@ -105,15 +122,16 @@ char* get_adapter_request(nebstruct_service_check_data* data, context_t* context
 		result = STRDUP(ADAPTER_REQUEST_INVALID);
 	} else {
 		const char*		type = NULL;
-		customvariablesmember*	vars = serv->custom_variables;
+		service_vars_t		vars;
 
 		/* get entity type (must be explicitly defined as custom variable) and request URL */
-		if ((vars == NULL) || strcmp(vars->variable_name, CUSTOM_VAR_ENTITY_TYPE)) {
+		find_service_vars(serv, &vars);
+		if (vars.entity_type == NULL) {
 			char var_lowercase[MAXBUFLEN] = CUSTOM_VAR_ENTITY_TYPE;
 			char* p; for (p = var_lowercase ; *p; ++p) *p = tolower(*p);
 			logging(LOG_DEBUG, context, "No custom variable _%s found", var_lowercase);
 		} else {
-			type = vars->variable_value;
+			type = vars.entity_type;
 			if (!strcmp(type, GE_ENTITY_TYPE)) {
 				result = get_adapter_request_for_ge(context, name, args, type, serv);
 			} else {
@@ -129,24 +147,36 @@ char* get_adapter_request(nebstruct_service_check_data* data, context_t* context
 		}
 	}
 
-	free(args);
-	args = NULL;
-	free(name);
-	name = NULL;
+	if (arena == &local) {
+		arena_reset(&local);
+	}
 	return result;
 }
 
 
-/* [GEri global instance] gets adapter request URL */
-char* get_adapter_request_for_ge(context_t* context, char* name, char* args, const char* type, const service* serv)
+/* checks whether results of a service are ignored (not defining a known entity type) */
+int is_service_ignored(const service* serv)
 {
-	char* result = NULL;
-	char  buffer[MAXBUFLEN];
+	service_vars_t vars;
+
+	find_service_vars(serv, &vars);
+	return (vars.entity_type == NULL) || strcmp(vars.entity_type, GE_ENTITY_TYPE);
+}
 
-	snprintf(buffer, sizeof(buffer)-1, GE_ADAPTER_REQUEST_FORMAT,
-	         adapter_url, name, region_id, serv->host_name, serv->description);
-	buffer[sizeof(buffer)-1] = '\0';
 
-	result = STRDUP(buffer);
+/* [GEri global instance] gets adapter request URL */
+char* get_adapter_request_for_ge(context_t* context, char* name, char* args, const char* type, const service* serv)
+{
+	char*			result = NULL;
+	url_template_values_t	values = {
+		[URL_TEMPLATE_FIELD_URL]	= adapter_url,
+		[URL_TEMPLATE_FIELD_COMMAND]	= name,
+		[URL_TEMPLATE_FIELD_REGION]	= region_id,
+		[URL_TEMPLATE_FIELD_HOST_NAME]	= serv->host_name,
+		[URL_TEMPLATE_FIELD_SERVICE]	= serv->description,
+		[URL_TEMPLATE_FIELD_TYPE]	= GE_ENTITY_TYPE
+	};
+
+	result = url_template_expand(request_templates[GE_REQUEST_TEMPLATE], values);
 	return result;
 }
@@ -37,20 +37,6 @@ extern "C" {
 #include "ngsi_event_broker_common.h"
 
 
-/**
- * @name Nagios service custom variables
- * @{
- */
-
-/** Name of custom variable in service description. A custom variable "_entity_type" may
- *  be included in Nagios configuration file when [defining a service](@NagiosCustomVars_ref);
- *  such variable is renamed to be accesible from this module (converted to uppercase and
- *  underscore removed). See ::customvariablesmember for details. */
-#define CUSTOM_VAR_ENTITY_TYPE		"ENTITY_TYPE"
-
-/**@}*/
-
-
 /**
  * @name GEri global instance monitoring
  * @{
@@ -59,10 +45,11 @@ extern "C" {
 /** Entity type of a GEri global instance */
 #define GE_ENTITY_TYPE			"ge"
 
-/** Adapter request query string fields (`id = region:host_name:service_description`) */
-#define GE_ADAPTER_REQUEST_FORMAT	"%s/%s" \
-					"?" ADAPTER_QUERY_FIELD_ID "=%s:%s:%s" \
-					"&" ADAPTER_QUERY_FIELD_TYPE "=" GE_ENTITY_TYPE
+/** Index of the adapter request template of GEri global instances (see ::request_template_texts) */
+#define GE_REQUEST_TEMPLATE		0
+
+/** Adapter request template (`id = region:host_name:service_description`, unless given as module argument) */
+#define GE_ADAPTER_REQUEST_TEMPLATE	ADAPTER_REQUEST_TEMPLATE(ADAPTER_REQUEST_ENTITY_ID)
 
 /**
  * Composes the request to NGSI Adapter according to plugin data from GEri global instance
@@ -32,8 +32,9 @@
  * entity identifier will be "{region}:{ifaddr}/{ifport}", taking address and port from the check command arguments.
  *
  * For host service (i.e. OpenStack service) monitoring, there are no restrictions on the command names and the plugins
- * to be used. The entity identifier will be "{region}:{host_name}:{service_desc}" and the entity type "host_service"
- * should be explicitly given with a custom variable "_entity_type" at service definition (or using a service template).
+ * to be used. The entity identifier will be "{region}:{host_name}:{service_desc}" (unless other template is given as
+ * module argument) and the entity type "host_service" should be explicitly given with a custom variable "_entity_type"
+ * at service definition (or using a service template).
  *
  * For any other plugin executed locally, the entity type "host" will be assumed and resulting entity identifier will be
  * "{region}:{localaddr}". But if plugin is executed remotely via NRPE, we will assume an instance (i.e. VM) is being
@@ -84,6 +85,15 @@ char* const module_version		= MODULE_VERSION;
 void*       module_handle		= NULL;
 
 
+/* define adapter request templates (previously declared) */
+const char* const request_template_texts[] = {
+	[DEM_REQUEST_TEMPLATE]		= DEM_ADAPTER_REQUEST_TEMPLATE,
+	[NPM_REQUEST_TEMPLATE]		= NPM_ADAPTER_REQUEST_TEMPLATE,
+	[SRV_REQUEST_TEMPLATE]		= SRV_ADAPTER_REQUEST_TEMPLATE,
+	NULL
+};
+
+
 /* initializes module handle and info (name and version) */
 int init_module_handle_info(void* handle, context_t* context)
 {
@@ -106,9 +116,14 @@ char* get_adapter_request(nebstruct_service_check_data* data, context_t* context
 	char* args   = NULL;
 	int   nrpe   = 0;
 
+	/* Transient strings taken from the arena of the context, or from a local one */
+	char     buffer[ARENA_BUFFER_SIZE];
+	arena_t  local;
+	arena_t* arena = (context && context->arena) ? context->arena : arena_init(&local, buffer, sizeof(buffer));
+
 	/* Build request according to plugin details */
 	const service* serv;
-	if ((name = find_plugin_command_name(data, &args, &nrpe, &serv)) == NULL) {
+	if ((name = find_plugin_command_name(data, &args, &nrpe, &serv, arena)) == NULL) {
 		logging(LOG_WARN, context, "Cannot get plugin command name");
 		result = ADAPTER_REQUEST_INVALID;
 	} else if (serv == NULL) {
@@ -116,15 +131,16 @@ char* get_adapter_request(nebstruct_service_check_data* data, context_t* context
 		result = ADAPTER_REQUEST_INVALID;
 	} else {
 		const char*		type = NULL;
-		customvariablesmember*	vars = serv->custom_variables;
+		service_vars_t		vars;
 
 		/* get entity type, either explicitly from custom variable or implicitly, assuming that:
 		 * - SNMP plugin implies NPM monitoring
 		 * - NRPE plugin implies DEM remote instance monitoring
 		 * - None of the above implies DEM local host monitoring
 		 */
-		if ((vars != NULL) && !strcmp(vars->variable_name, CUSTOM_VAR_ENTITY_TYPE)) {
-			type = vars->variable_value;
+		find_service_vars(serv, &vars);
+		if (vars.entity_type != NULL) {
+			type = vars.entity_type;
 			logging(LOG_DEBUG, context, "Explicit entity type %s from custom variables", type);
 		} else if (!strcmp(name, SNMP_PLUGIN)) {
 			type = NPM_DEFAULT_ENTITY_TYPE;
@@ -141,28 +157,51 @@ char* get_adapter_request(nebstruct_service_check_data* data, context_t* context
 		if (!strcmp(type, SRV_DEFAULT_ENTITY_TYPE)) {
 			result = srv_get_adapter_request(context, name, args, type, serv);
 		} else if (!strcmp(type, NPM_DEFAULT_ENTITY_TYPE)) {
-			result = npm_get_adapter_request(context, name, args, type);
+			result = npm_get_adapter_request(context, name, args, type, arena);
 		} else {
-			result = dem_get_adapter_request(context, name, args, type, nrpe);
+			result = dem_get_adapter_request(context, name, args, type, nrpe, arena);
 		}
 	}
 
-	free(args);
-	args = NULL;
-	free(name);
-	name = NULL;
+	if (arena == &local) {
+		arena_reset(&local);
+	}
 	return result;
 }
 
 
+/* checks whether results of a service are ignored (never: entity type may be implicit) */
+int is_service_ignored(const service* serv)
+{
+	return 0;
+}
+
+
+/* options of SNMP plugin relevant to NPM monitoring (as in optstring ":H:C:o:m:") */
+static const option_spec_t npm_plugin_options = {
+	.kind   = { ['H'] = OPTION_SPEC_VALUE, ['C'] = OPTION_SPEC_VALUE,
+	            ['o'] = OPTION_SPEC_VALUE, ['m'] = OPTION_SPEC_VALUE },
+	.silent = 1
+};
+
+
+/* options of NRPE plugin relevant to DEM monitoring (as in optstring ":H:nup:t:c:a:") */
+static const option_spec_t dem_plugin_options = {
+	.kind   = { ['H'] = OPTION_SPEC_VALUE, ['n'] = OPTION_SPEC_FLAG,  ['u'] = OPTION_SPEC_FLAG,
+	            ['p'] = OPTION_SPEC_VALUE, ['t'] = OPTION_SPEC_VALUE, ['c'] = OPTION_SPEC_VALUE,
+	            ['a'] = OPTION_SPEC_VALUE },
+	.silent = 1
+};
+
+
 /* [NPM monitoring] gets adapter request URL */
-char* npm_get_adapter_request(context_t* context, char* name, char* args, const char* type)
+char* npm_get_adapter_request(context_t* context, char* name, char* args, const char* type, arena_t* arena)
 {
 	char*		result = NULL;
 	option_list_t	opts   = NULL;
 
 	/* Take adapter query fields from plugin arguments */
-	if ((opts = parse_args(args, ":H:C:o:m:")) == NULL) {
+	if ((opts = parse_args_into(args, &npm_plugin_options, arena)) == NULL) {
 		logging(LOG_WARN, context, "Cannot get plugin options");
 		result = ADAPTER_REQUEST_INVALID;
 	} else {
@@ -190,37 +229,43 @@ char* npm_get_adapter_request(context_t* context, char* name, char* args, const
 			logging(LOG_WARN, context, "Missing plugin options");
 			result = ADAPTER_REQUEST_INVALID;
 		} else {
-			char buffer[MAXBUFLEN];
-			snprintf(buffer, sizeof(buffer)-1, NPM_ADAPTER_REQUEST_FORMAT,
-			         adapter_url, name, region_id, host, port, type);
-			buffer[sizeof(buffer)-1] = '\0';
-			result = strdup(buffer);
+			char			ifport[sizeof("-2147483648")];
+			url_template_values_t	values = {
+				[URL_TEMPLATE_FIELD_URL]	= adapter_url,
+				[URL_TEMPLATE_FIELD_COMMAND]	= name,
+				[URL_TEMPLATE_FIELD_REGION]	= region_id,
+				[URL_TEMPLATE_FIELD_ADDRESS]	= host,
+				[URL_TEMPLATE_FIELD_PORT]	= ifport,
+				[URL_TEMPLATE_FIELD_TYPE]	= type
+			};
+			sprintf(ifport, "%d", port);
+			result = url_template_expand(request_templates[NPM_REQUEST_TEMPLATE], values);
 		}
 	}
 
-	free_option_list(opts);
-	opts = NULL;
 	return result;
 }
 
 
 /* [DEM monitoring] gets adapter request URL */
-char* dem_get_adapter_request(context_t* context, char* name, char* args, const char* type, int nrpe)
+char* dem_get_adapter_request(context_t* context, char* name, char* args, const char* type, int nrpe, arena_t* arena)
 {
-	char		buffer[MAXBUFLEN];
-	char*		result = NULL;
-	option_list_t	opts   = NULL;
+	char*			result = NULL;
+	option_list_t		opts   = NULL;
+	url_template_values_t	values = {
+		[URL_TEMPLATE_FIELD_URL]	= adapter_url,
+		[URL_TEMPLATE_FIELD_COMMAND]	= name,
+		[URL_TEMPLATE_FIELD_REGION]	= region_id,
+		[URL_TEMPLATE_FIELD_TYPE]	= type
+	};
 
 	/* Take adapter query fields from plugin arguments, distinguishing
 	   between local executions (host_addr as identifier) and NRPE plugin
 	   executions (-H plugin argument as identifier) */
 	if (!nrpe) {
-		char* addr = host_addr;
-		snprintf(buffer, sizeof(buffer)-1, DEM_ADAPTER_REQUEST_FORMAT,
-		         adapter_url, name, region_id, addr, type);
-		buffer[sizeof(buffer)-1] = '\0';
-		result = strdup(buffer);
-	} else if ((opts = parse_args(args, ":H:nup:t:c:a:")) == NULL) {
+		values[URL_TEMPLATE_FIELD_ADDRESS] = host_addr;
+		result = url_template_expand(request_templates[DEM_REQUEST_TEMPLATE], values);
+	} else if ((opts = parse_args_into(args, &dem_plugin_options, arena)) == NULL) {
 		logging(LOG_WARN, context, "Cannot get NRPE plugin options");
 		result = ADAPTER_REQUEST_INVALID;
 	} else {
@@ -239,19 +284,19 @@ char* dem_get_adapter_request(context_t* context, char* name, char* args, const
 		if (host == NULL) {
 			logging(LOG_WARN, context, "Missing NRPE plugin options");
 			result = ADAPTER_REQUEST_INVALID;
-		} else if (resolve_address(host, addr, INET_ADDRSTRLEN) == NEB_ERROR) {
+		} else if (resolve_remote_address(host, addr, INET_ADDRSTRLEN) == NEB_ERROR) {
 			logging(LOG_WARN, context, "Cannot resolve remote address for %s", host);
 			result = ADAPTER_REQUEST_INVALID;
 		} else {
-			snprintf(buffer, sizeof(buffer)-1, DEM_ADAPTER_REQUEST_FORMAT,
-			         adapter_url, name, region_id, addr, type);
-			buffer[sizeof(buffer)-1] = '\0';
-			result = strdup(buffer);
+			/* address may change: resolve it again (from the cache, if enabled) on every check */
+			if (context != NULL) {
+				context->uncacheable = 1;
+			}
+			values[URL_TEMPLATE_FIELD_ADDRESS] = addr;
+			result = url_template_expand(request_templates[DEM_REQUEST_TEMPLATE], values);
 		}
 	}
 
-	free_option_list(opts);
-	opts = NULL;
 	return result;
 }
 
@@ -259,13 +304,16 @@ char* dem_get_adapter_request(context_t* context, char* name, char* args, const
 /* [Host service monitoring] gets adapter request URL */
 char* srv_get_adapter_request(context_t* context, char* name, char* args, const char* type, const service* serv)
 {
-	char* result = NULL;
-	char  buffer[MAXBUFLEN];
-
-	snprintf(buffer, sizeof(buffer)-1, SRV_ADAPTER_REQUEST_FORMAT,
-	         adapter_url, name, region_id, serv->host_name, serv->description, type);
-	buffer[sizeof(buffer)-1] = '\0';
-
-	result = strdup(buffer);
+	char*			result = NULL;
+	url_template_values_t	values = {
+		[URL_TEMPLATE_FIELD_URL]	= adapter_url,
+		[URL_TEMPLATE_FIELD_COMMAND]	= name,
+		[URL_TEMPLATE_FIELD_REGION]	= region_id,
+		[URL_TEMPLATE_FIELD_HOST_NAME]	= serv->host_name,
+		[URL_TEMPLATE_FIELD_SERVICE]	= serv->description,
+		[URL_TEMPLATE_FIELD_TYPE]	= type
+	};
+
+	result = url_template_expand(request_templates[SRV_REQUEST_TEMPLATE], values);
 	return result;
 }
@@ -38,20 +38,6 @@ extern "C" {
 #include "ngsi_event_broker_common.h"
 
 
-/**
- * @name Nagios service custom variables
- * @{
- */
-
-/** Name of custom variable in service description. A custom variable "_entity_type" may
- *  be included in Nagios configuration file when [defining a service](@NagiosCustomVars_ref);
- *  such variable is renamed to be accesible from this module (converted to uppercase and
- *  underscore removed). See ::customvariablesmember for details. */
-#define CUSTOM_VAR_ENTITY_TYPE		"ENTITY_TYPE"
-
-/**@}*/
-
-
 /**
  * @name DEM monitoring
  * @{
@@ -72,8 +58,11 @@ extern "C" {
 /** Default entity type for DEM monitoring, if none of the former applies */
 #define DEM_DEFAULT_ENTITY_TYPE		DEM_ENTITY_TYPE_HOST_VIRTUAL
 
-/** Adapter request query string fields (`id = region:hostaddr`) */
-#define DEM_ADAPTER_REQUEST_FORMAT	ADAPTER_REQUEST_FORMAT
+/** Index of the adapter request template for DEM monitoring (see ::request_template_texts) */
+#define DEM_REQUEST_TEMPLATE		0
+
+/** Adapter request template (`id = region:hostaddr`) */
+#define DEM_ADAPTER_REQUEST_TEMPLATE	ADAPTER_REQUEST_TEMPLATE("{region}:{address}")
 
 /**@}*/
 
@@ -86,10 +75,11 @@ extern "C" {
 /** Default entity type for network elements being monitored, when no type is specified */
 #define NPM_DEFAULT_ENTITY_TYPE		"interface"
 
-/** Adapter request query string fields (`id = region:hostaddr/port`) */
-#define NPM_ADAPTER_REQUEST_FORMAT	"%s/%s" \
-					"?" ADAPTER_QUERY_FIELD_ID "=%s:%s/%d" \
-					"&" ADAPTER_QUERY_FIELD_TYPE "=%s"
+/** Index of the adapter request template for NPM monitoring (see ::request_template_texts) */
+#define NPM_REQUEST_TEMPLATE		1
+
+/** Adapter request template (`id = region:hostaddr/port`) */
+#define NPM_ADAPTER_REQUEST_TEMPLATE	ADAPTER_REQUEST_TEMPLATE("{region}:{address}/{port}")
 /**@}*/
 
 
@@ -101,10 +91,11 @@ extern "C" {
 /** Default entity type for host services being monitored, when no type is specified */
 #define SRV_DEFAULT_ENTITY_TYPE		"host_service"
 
-/** Adapter request query string fields (`id = region:hostname:servname`) */
-#define SRV_ADAPTER_REQUEST_FORMAT	"%s/%s" \
-					"?" ADAPTER_QUERY_FIELD_ID "=%s:%s:%s" \
-					"&" ADAPTER_QUERY_FIELD_TYPE "=%s"
+/** Index of the adapter request template for host service monitoring (see ::request_template_texts) */
+#define SRV_REQUEST_TEMPLATE		2
+
+/** Adapter request template (`id = region:hostname:servname`, unless given as module argument) */
+#define SRV_ADAPTER_REQUEST_TEMPLATE	ADAPTER_REQUEST_TEMPLATE(ADAPTER_REQUEST_ENTITY_ID)
 /**@}*/
 
 
@@ -122,10 +113,11 @@ extern "C" {
  * @param[in] args	The command line arguments for the plugin (result of ::find_plugin_command_name).
  * @param[in] type	The entity type associated to the resource being monitored.
  * @param[in] nrpe	True (non-zero) when plugin is remotely executed via NRPE.
+ * @param[in] arena	The arena where plugin options are allocated.
  *
  * @return		The request URL to invoke NGSI Adapter (including query string).
  */
-char* dem_get_adapter_request(context_t* context, char* name, char* args, const char* type, int nrpe);
+char* dem_get_adapter_request(context_t* context, char* name, char* args, const char* type, int nrpe, arena_t* arena);
 
 
 /**
@@ -135,10 +127,11 @@ char* dem_get_adapter_request(context_t* context, char* name, char* args, const
  * @param[in] name	The name of the command for the plugin (result of ::find_plugin_command_name).
  * @param[in] args	The command line arguments for the plugin (result of ::find_plugin_command_name).
  * @param[in] type	The entity type associated to the resource being monitored.
+ * @param[in] arena	The arena where plugin options are allocated.
  *
  * @return		The request URL to invoke NGSI Adapter (including query string).
  */
-char* npm_get_adapter_request(context_t* context, char* name, char* args, const char* type);
+char* npm_get_adapter_request(context_t* context, char* name, char* args, const char* type, arena_t* arena);
 
 
 /**
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   request_queue.c
+ * @brief  Bounded lock-free queue implementation
+ *
+ * This file consists of the implementation of a bounded MPMC queue based on a
+ * ring of slots, each one tagged with a sequence number that tells producers
+ * and consumers whether the slot is ready to be written or read. Positions are
+ * claimed with a compare-and-swap, so no locks are ever taken.
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "request_queue.h"
+
+
+/* size of a cache line, to keep producer and consumer positions apart */
+#define CACHE_LINE_SIZE		64
+
+
+/* queue slot: sequence number followed by item contents */
+typedef struct {
+	size_t		seq;
+	unsigned char	data[];
+} queue_slot_t;
+
+
+/* queue definition */
+struct request_queue {
+	unsigned char*	slots;
+	size_t		slot_size;
+	size_t		item_size;
+	size_t		mask;
+	char		pad0[CACHE_LINE_SIZE];
+	size_t		enqueue_pos;
+	char		pad1[CACHE_LINE_SIZE];
+	size_t		dequeue_pos;
+	char		pad2[CACHE_LINE_SIZE];
+};
+
+
+/* gets the slot for a given position */
+#define SLOT(queue, pos)	((queue_slot_t*) ((queue)->slots + ((pos) & (queue)->mask) * (queue)->slot_size))
+
+
+/* creates a new queue */
+request_queue_t* request_queue_create(size_t capacity, size_t item_size)
+{
+	request_queue_t*	queue = NULL;
+	size_t			size  = 2;
+	size_t			i;
+
+	while (size < capacity) size <<= 1;
+	if ((capacity > 0) && (item_size > 0)
+	    && ((queue = (request_queue_t*) calloc(1, sizeof(request_queue_t))) != NULL)) {
+		queue->item_size = item_size;
+		queue->slot_size = (sizeof(queue_slot_t) + item_size + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+		queue->mask      = size - 1;
+		if ((queue->slots = (unsigned char*) malloc(size * queue->slot_size)) == NULL) {
+			free(queue);
+			queue = NULL;
+		} else {
+			for (i = 0; i < size; i++) {
+				SLOT(queue, i)->seq = i;
+			}
+		}
+	}
+
+	return queue;
+}
+
+
+/* releases resources for given queue */
+void request_queue_free(request_queue_t* queue)
+{
+	if (queue != NULL) {
+		free(queue->slots);
+		free(queue);
+	}
+}
+
+
+/* gets the actual capacity of the queue */
+size_t request_queue_capacity(const request_queue_t* queue)
+{
+	return queue->mask + 1;
+}
+
+
+/* copies an item at the tail of the queue */
+int request_queue_push(request_queue_t* queue, const void* item)
+{
+	queue_slot_t*	slot;
+	size_t		pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+
+	for (;;) {
+		size_t   seq  = __atomic_load_n(&(slot = SLOT(queue, pos))->seq, __ATOMIC_ACQUIRE);
+		intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, 1,
+			                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return -1;	/* full */
+		} else {
+			pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(slot->data, item, queue->item_size);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+
+/* copies and removes the item at the head of the queue */
+int request_queue_pop(request_queue_t* queue, void* item)
+{
+	queue_slot_t*	slot;
+	size_t		pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+
+	for (;;) {
+		size_t   seq  = __atomic_load_n(&(slot = SLOT(queue, pos))->seq, __ATOMIC_ACQUIRE);
+		intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1, 1,
+			                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return -1;	/* empty */
+		} else {
+			pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(item, slot->data, queue->item_size);
+	__atomic_store_n(&slot->seq, pos + queue->mask + 1, __ATOMIC_RELEASE);
+	return 0;
+}
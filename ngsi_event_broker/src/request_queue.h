@@ -0,0 +1,103 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   request_queue.h
+ * @brief  Bounded lock-free queue macros and declarations
+ *
+ * This file declares a fixed-capacity, lock-free, multi-producer/multi-consumer
+ * FIFO queue of fixed-size items, used to hand over requests from the Nagios
+ * main thread to the sender threads of the [Event Broker](@NagiosModule_ref).
+ */
+
+
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Opaque queue type */
+typedef struct request_queue request_queue_t;
+
+
+/**
+ * Creates a new queue
+ *
+ * @param[in] capacity		The maximum number of items (rounded up to a power of two).
+ * @param[in] item_size		The size in bytes of every item.
+ *
+ * @return			The new queue, or NULL if it could not be created.
+ */
+request_queue_t* request_queue_create(size_t capacity, size_t item_size);
+
+
+/**
+ * Releases resources for given queue (items still queued are discarded)
+ *
+ * @param[in] queue		The queue.
+ */
+void request_queue_free(request_queue_t* queue);
+
+
+/**
+ * Gets the actual capacity of the queue
+ *
+ * @param[in] queue		The queue.
+ *
+ * @return			The maximum number of items.
+ */
+size_t request_queue_capacity(const request_queue_t* queue);
+
+
+/**
+ * Copies an item at the tail of the queue
+ *
+ * @param[in] queue		The queue.
+ * @param[in] item		The item to copy (of the size given at creation).
+ *
+ * @retval 0			Successfully queued.
+ * @retval -1			Queue is full.
+ */
+int request_queue_push(request_queue_t* queue, const void* item);
+
+
+/**
+ * Copies and removes the item at the head of the queue
+ *
+ * @param[in]  queue		The queue.
+ * @param[out] item		The buffer where item will be copied to.
+ *
+ * @retval 0			Successfully dequeued.
+ * @retval -1			Queue is empty.
+ */
+int request_queue_pop(request_queue_t* queue, void* item);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*REQUEST_QUEUE_H*/
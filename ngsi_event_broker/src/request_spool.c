@@ -0,0 +1,362 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   request_spool.c
+ * @brief  Disk-backed spool of requests implementation
+ *
+ * This file consists of the implementation of a persistent spool of records,
+ * appended to a ring buffer stored in a memory-mapped file. Every record has a
+ * header with a sequence number and a checksum, and the positions of the first
+ * and next records are kept in a file header. The position of the next record
+ * is only updated once the record is completely written, so that the contents
+ * of the spool survive a crash of the process: when reopened, records are
+ * checked from the oldest one and the spool is truncated at the first invalid
+ * record found. A record never wraps around the end of the buffer: a marker is
+ * written instead, and the record is placed at the beginning.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "request_spool.h"
+
+
+/* magic number identifying spool files */
+#define SPOOL_MAGIC		0x4e454253	/* "NEBS" */
+
+
+/* version of the layout of spool files */
+#define SPOOL_VERSION		1
+
+
+/* magic number of a valid record */
+#define RECORD_MAGIC		0x5245434f	/* "RECO" */
+
+
+/* magic number of the marker telling next record is at the beginning of the buffer */
+#define WRAP_MAGIC		0x57524150	/* "WRAP" */
+
+
+/* alignment of records and offset of the buffer within the file */
+#define RECORD_ALIGN		8
+#define BUFFER_OFFSET		64
+
+
+/* rounds up a size to record alignment */
+#define ALIGN(size)		(((size) + RECORD_ALIGN - 1) & ~((size_t) RECORD_ALIGN - 1))
+
+
+/* file header */
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint64_t	size;		/* size of the file */
+	uint64_t	head;		/* offset of the oldest record within the buffer */
+	uint64_t	tail;		/* offset of the next record within the buffer */
+	uint64_t	next_seq;	/* sequence number of the next record */
+} spool_header_t;
+
+
+/* record header, followed by record contents */
+typedef struct {
+	uint32_t	magic;
+	uint32_t	length;
+	uint64_t	seq;
+	uint32_t	checksum;
+	uint32_t	reserved;
+} record_header_t;
+
+
+/* spool definition */
+struct request_spool {
+	spool_header_t*	header;
+	unsigned char*	buffer;
+	size_t		capacity;
+	size_t		count;
+	uint64_t	next_seq;
+	pthread_mutex_t	mutex;
+	int		fd;
+};
+
+
+/* gets the record at a given offset */
+#define RECORD(spool, pos)	((record_header_t*) ((spool)->buffer + (pos)))
+
+
+/* gets the size taken by a record of a given length */
+static size_t record_size(size_t length)
+{
+	return ALIGN(sizeof(record_header_t) + length);
+}
+
+
+/* computes the checksum of a record (FNV-1a, seeded with its sequence number) */
+static uint32_t record_checksum(uint64_t seq, const unsigned char* data, size_t length)
+{
+	uint32_t hash = 2166136261U ^ (uint32_t) seq ^ (uint32_t) (seq >> 32);
+	size_t   i;
+
+	for (i = 0; i < length; i++) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+	return hash;
+}
+
+
+/* gets the actual offset of the record at a given position, skipping to the beginning if needed */
+static size_t record_offset(const request_spool_t* spool, size_t pos)
+{
+	return ((spool->capacity - pos < sizeof(record_header_t)) || (RECORD(spool, pos)->magic == WRAP_MAGIC)) ? 0 : pos;
+}
+
+
+/* gets the number of bytes in use */
+static size_t used_bytes(const request_spool_t* spool)
+{
+	return (spool->header->tail + spool->capacity - spool->header->head) % spool->capacity;
+}
+
+
+/* checks whether there is a valid record at a given offset */
+static int valid_record(const request_spool_t* spool, size_t pos)
+{
+	const record_header_t* record = RECORD(spool, pos);
+
+	return (record->magic == RECORD_MAGIC)
+	    && (record_size(record->length) <= spool->capacity - pos)
+	    && (record->checksum == record_checksum(record->seq, (const unsigned char*) (record + 1), record->length));
+}
+
+
+/* discards the oldest record */
+static void drop_oldest(request_spool_t* spool)
+{
+	size_t pos = record_offset(spool, spool->header->head);
+
+	pos = (pos + record_size(RECORD(spool, pos)->length)) % spool->capacity;
+	__atomic_store_n(&spool->header->head, (uint64_t) pos, __ATOMIC_RELEASE);
+	spool->count--;
+}
+
+
+/* resets the spool to empty */
+static void reset_spool(request_spool_t* spool, size_t size)
+{
+	spool->header->magic    = SPOOL_MAGIC;
+	spool->header->version  = SPOOL_VERSION;
+	spool->header->size     = size;
+	spool->header->head     = 0;
+	spool->header->tail     = 0;
+	spool->header->next_seq = spool->next_seq = 1;
+	spool->count = 0;
+}
+
+
+/* recovers records of a previous run, truncating the spool at the first invalid one */
+static void recover_spool(request_spool_t* spool, size_t size)
+{
+	spool_header_t*	header = spool->header;
+	size_t		pos, max_count = spool->capacity / sizeof(record_header_t);
+	uint64_t	last_seq = 0;
+
+	if ((header->magic != SPOOL_MAGIC) || (header->version != SPOOL_VERSION) || (header->size != size)
+	    || (header->head >= spool->capacity) || (header->tail >= spool->capacity)
+	    || (header->head % RECORD_ALIGN) || (header->tail % RECORD_ALIGN)) {
+		reset_spool(spool, size);
+		return;
+	}
+
+	spool->count = 0;
+	for (pos = header->head; pos != header->tail; spool->count++) {
+		size_t offset = record_offset(spool, pos);
+		if (offset == header->tail) {
+			break;
+		} else if ((spool->count == max_count) || !valid_record(spool, offset)
+		           || (RECORD(spool, offset)->seq <= last_seq)
+		           || ((offset < header->tail)
+		               && (offset + record_size(RECORD(spool, offset)->length) > header->tail))) {
+			header->tail = pos;	/* truncate */
+			break;
+		}
+		last_seq = RECORD(spool, offset)->seq;
+		pos = (offset + record_size(RECORD(spool, offset)->length)) % spool->capacity;
+	}
+
+	spool->next_seq = (header->next_seq > last_seq) ? header->next_seq : last_seq + 1;
+	header->next_seq = spool->next_seq;
+}
+
+
+/* opens a spool file */
+request_spool_t* request_spool_open(const char* path, size_t size)
+{
+	request_spool_t*	spool = NULL;
+	struct stat		st;
+	void*			map;
+	int			fd;
+
+	size &= ~((size_t) RECORD_ALIGN - 1);
+	if ((path == NULL) || (size < REQUEST_SPOOL_MIN_SIZE)) {
+		return NULL;
+	} else if ((fd = open(path, O_RDWR | O_CREAT, 0600)) == -1) {
+		return NULL;
+	}
+
+	/* reserve disk space in advance, as failing to do so later would crash the process */
+	if ((flock(fd, LOCK_EX | LOCK_NB) == -1)
+	    || (fstat(fd, &st) == -1)
+	    || (((size_t) st.st_size != size) && (ftruncate(fd, size) == -1))
+	    || (posix_fallocate(fd, 0, size) != 0)
+	    || ((map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+		close(fd);
+	} else if ((spool = (request_spool_t*) calloc(1, sizeof(request_spool_t))) == NULL) {
+		munmap(map, size);
+		close(fd);
+	} else {
+		spool->fd       = fd;
+		spool->header   = (spool_header_t*) map;
+		spool->buffer   = (unsigned char*) map + BUFFER_OFFSET;
+		spool->capacity = size - BUFFER_OFFSET;
+		pthread_mutex_init(&spool->mutex, NULL);
+		recover_spool(spool, size);
+	}
+
+	return spool;
+}
+
+
+/* closes a spool */
+void request_spool_close(request_spool_t* spool)
+{
+	if (spool != NULL) {
+		size_t size = spool->header->size;
+		msync(spool->header, size, MS_SYNC);
+		munmap(spool->header, size);
+		close(spool->fd);
+		pthread_mutex_destroy(&spool->mutex);
+		free(spool);
+	}
+}
+
+
+/* gets the number of records */
+size_t request_spool_count(request_spool_t* spool)
+{
+	size_t count;
+
+	pthread_mutex_lock(&spool->mutex);
+	count = spool->count;
+	pthread_mutex_unlock(&spool->mutex);
+	return count;
+}
+
+
+/* appends a record, discarding the oldest ones if there is no room */
+int request_spool_append(request_spool_t* spool, const void* data, size_t length, size_t* dropped)
+{
+	record_header_t*	record;
+	size_t			size = record_size(length);
+	size_t			pos, needed, discarded = 0;
+
+	if ((size >= spool->capacity) || (length > UINT32_MAX)) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&spool->mutex);
+	for (;;) {
+		if (spool->count == 0) {
+			__atomic_store_n(&spool->header->head, 0, __ATOMIC_RELEASE);
+			__atomic_store_n(&spool->header->tail, 0, __ATOMIC_RELEASE);
+		}
+		pos    = spool->header->tail;
+		needed = size;
+		if (spool->capacity - pos < size) {
+			needed += spool->capacity - pos;	/* gap up to the end of the buffer */
+			pos = 0;
+		}
+		if (used_bytes(spool) + needed < spool->capacity) {
+			break;
+		}
+		drop_oldest(spool);
+		discarded++;
+	}
+
+	/* write record before making it visible */
+	record = RECORD(spool, pos);
+	memcpy(record + 1, data, length);
+	record->length   = (uint32_t) length;
+	record->seq      = spool->next_seq;
+	record->checksum = record_checksum(record->seq, (const unsigned char*) (record + 1), length);
+	record->reserved = 0;
+	record->magic    = RECORD_MAGIC;
+	if ((pos == 0) && (spool->header->tail != 0)
+	    && (spool->capacity - spool->header->tail >= sizeof(record_header_t))) {
+		RECORD(spool, spool->header->tail)->magic = WRAP_MAGIC;
+	}
+	__atomic_store_n(&spool->header->next_seq, ++spool->next_seq, __ATOMIC_RELEASE);
+	__atomic_store_n(&spool->header->tail, (uint64_t) ((pos + size) % spool->capacity), __ATOMIC_RELEASE);
+	spool->count++;
+	pthread_mutex_unlock(&spool->mutex);
+
+	if (dropped != NULL) *dropped = discarded;
+	return 0;
+}
+
+
+/* copies the oldest record, without removing it */
+void* request_spool_peek(request_spool_t* spool, uint64_t* seq, size_t* length)
+{
+	unsigned char* data = NULL;
+
+	pthread_mutex_lock(&spool->mutex);
+	if (spool->count > 0) {
+		const record_header_t* record = RECORD(spool, record_offset(spool, spool->header->head));
+		if ((data = (unsigned char*) malloc(record->length + 1)) != NULL) {
+			memcpy(data, record + 1, record->length);
+			data[record->length] = '\0';
+			*seq    = record->seq;
+			*length = record->length;
+		}
+	}
+	pthread_mutex_unlock(&spool->mutex);
+
+	return data;
+}
+
+
+/* removes the oldest record, unless already discarded */
+int request_spool_remove(request_spool_t* spool, uint64_t seq)
+{
+	int result = -1;
+
+	pthread_mutex_lock(&spool->mutex);
+	if ((spool->count > 0) && (RECORD(spool, record_offset(spool, spool->header->head))->seq == seq)) {
+		drop_oldest(spool);
+		result = 0;
+	}
+	pthread_mutex_unlock(&spool->mutex);
+
+	return result;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   request_spool.h
+ * @brief  Disk-backed spool of requests macros and declarations
+ *
+ * This file declares a persistent FIFO spool of variable-size records, stored
+ * in a memory-mapped file of fixed size, used by the [Event Broker](@NagiosModule_ref)
+ * to keep requests that could not be delivered to NGSI Adapter until they are
+ * replayed. When full, oldest records are discarded to make room for new ones.
+ */
+
+
+#ifndef REQUEST_SPOOL_H
+#define REQUEST_SPOOL_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** Minimum size in bytes of a spool file */
+#define REQUEST_SPOOL_MIN_SIZE		4096
+
+
+/** Opaque spool type */
+typedef struct request_spool request_spool_t;
+
+
+/**
+ * Opens a spool file, creating it if needed or recovering the records of a previous run
+ *
+ * A file with a different size or not recognized as a spool is reinitialized,
+ * and any record found corrupted (i.e. partially written because of a crash)
+ * is discarded along with those following it.
+ *
+ * @param[in] path		The path of the spool file.
+ * @param[in] size		The size in bytes of the file (including control data).
+ *
+ * @return			The spool, or NULL if it could not be opened.
+ */
+request_spool_t* request_spool_open(const char* path, size_t size);
+
+
+/**
+ * Closes a spool, flushing its contents to disk
+ *
+ * @param[in] spool		The spool.
+ */
+void request_spool_close(request_spool_t* spool);
+
+
+/**
+ * Gets the number of records in the spool
+ *
+ * @param[in] spool		The spool.
+ *
+ * @return			The number of records.
+ */
+size_t request_spool_count(request_spool_t* spool);
+
+
+/**
+ * Appends a record to the spool, discarding the oldest ones if there is no room
+ *
+ * @param[in]  spool		The spool.
+ * @param[in]  data		The record contents.
+ * @param[in]  length		The length of the record.
+ * @param[out] dropped		The number of oldest records discarded (may be null).
+ *
+ * @retval 0			Successfully appended.
+ * @retval -1			Record larger than spool capacity.
+ */
+int request_spool_append(request_spool_t* spool, const void* data, size_t length, size_t* dropped);
+
+
+/**
+ * Copies the oldest record of the spool, without removing it
+ *
+ * @param[in]  spool		The spool.
+ * @param[out] seq		The sequence number of the record (to remove it later).
+ * @param[out] length		The length of the record.
+ *
+ * @return			The record contents followed by a null character (to be freed by
+ *				caller), or NULL if spool is empty.
+ */
+void* request_spool_peek(request_spool_t* spool, uint64_t* seq, size_t* length);
+
+
+/**
+ * Removes the oldest record of the spool, unless already discarded
+ *
+ * @param[in] spool		The spool.
+ * @param[in] seq		The sequence number of the record, as given by request_spool_peek().
+ *
+ * @retval 0			Successfully removed.
+ * @retval -1			Record is no longer the oldest one.
+ */
+int request_spool_remove(request_spool_t* spool, uint64_t seq);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*REQUEST_SPOOL_H*/
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   route_cache.c
+ * @brief  Cache of adapter request routes implementation
+ *
+ * This file consists of the implementation of a hash table with separate
+ * chaining, keyed by the host name and description of a service. Every entry
+ * is a single allocation holding both key strings and the route, to keep the
+ * number of allocations (and cache misses when comparing keys) low.
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "route_cache.h"
+
+
+/* entry of the cache, followed by its strings (host, service and route) */
+typedef struct route_entry {
+	struct route_entry*	next;
+	uint32_t		hash;
+	size_t			host_len;
+	size_t			service_len;
+} route_entry_t;
+
+
+/* cache definition */
+struct route_cache {
+	route_entry_t**	buckets;
+	size_t		size;
+	size_t		count;
+};
+
+
+/* gets the strings of an entry */
+#define ENTRY_HOST(entry)	((char*) ((entry) + 1))
+#define ENTRY_SERVICE(entry)	(ENTRY_HOST(entry) + (entry)->host_len + 1)
+#define ENTRY_ROUTE(entry)	(ENTRY_SERVICE(entry) + (entry)->service_len + 1)
+
+
+/* hashes the key of a service (FNV-1a of both strings, separated by a null character) */
+static uint32_t hash_key(const char* host, const char* service)
+{
+	uint32_t		hash = 2166136261U;
+	const unsigned char*	ptr;
+
+	for (ptr = (const unsigned char*) host; *ptr; ptr++) {
+		hash = (hash ^ *ptr) * 16777619U;
+	}
+	hash *= 16777619U;
+	for (ptr = (const unsigned char*) service; *ptr; ptr++) {
+		hash = (hash ^ *ptr) * 16777619U;
+	}
+	return hash;
+}
+
+
+/* finds the entry of a service, returning the link pointing to it (or to NULL if not found) */
+static route_entry_t** find_entry(const route_cache_t* cache, const char* host, const char* service, uint32_t hash)
+{
+	route_entry_t** link = &cache->buckets[hash % cache->size];
+
+	for (; *link != NULL; link = &(*link)->next) {
+		if (((*link)->hash == hash)
+		    && !strcmp(ENTRY_HOST(*link), host) && !strcmp(ENTRY_SERVICE(*link), service)) {
+			break;
+		}
+	}
+	return link;
+}
+
+
+/* creates a new cache */
+route_cache_t* route_cache_create(size_t buckets)
+{
+	route_cache_t* cache = NULL;
+
+	if ((buckets == 0) || ((cache = (route_cache_t*) calloc(1, sizeof(route_cache_t))) == NULL)) {
+		return NULL;
+	} else if ((cache->buckets = (route_entry_t**) calloc(buckets, sizeof(route_entry_t*))) == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->size = buckets;
+	return cache;
+}
+
+
+/* releases resources for given cache */
+void route_cache_free(route_cache_t* cache)
+{
+	if (cache != NULL) {
+		route_cache_clear(cache);
+		free(cache->buckets);
+		free(cache);
+	}
+}
+
+
+/* removes all the entries */
+void route_cache_clear(route_cache_t* cache)
+{
+	size_t i;
+
+	for (i = 0; (cache->count > 0) && (i < cache->size); i++) {
+		while (cache->buckets[i] != NULL) {
+			route_entry_t* entry = cache->buckets[i];
+			cache->buckets[i] = entry->next;
+			free(entry);
+			cache->count--;
+		}
+	}
+}
+
+
+/* gets the number of entries */
+size_t route_cache_count(const route_cache_t* cache)
+{
+	return cache->count;
+}
+
+
+/* gets the route of a service */
+const char* route_cache_get(const route_cache_t* cache, const char* host, const char* service)
+{
+	route_entry_t* entry = *find_entry(cache, host, service, hash_key(host, service));
+	return (entry) ? ENTRY_ROUTE(entry) : NULL;
+}
+
+
+/* sets the route of a service */
+int route_cache_put(route_cache_t* cache, const char* host, const char* service, const char* route)
+{
+	uint32_t	hash        = hash_key(host, service);
+	route_entry_t**	link        = find_entry(cache, host, service, hash);
+	size_t		host_len    = strlen(host);
+	size_t		service_len = strlen(service);
+	size_t		route_len   = strlen(route);
+	route_entry_t*	entry;
+
+	if ((entry = (route_entry_t*) malloc(sizeof(route_entry_t) + host_len + service_len + route_len + 3)) == NULL) {
+		return -1;
+	}
+
+	entry->hash        = hash;
+	entry->host_len    = host_len;
+	entry->service_len = service_len;
+	memcpy(ENTRY_HOST(entry), host, host_len + 1);
+	memcpy(ENTRY_SERVICE(entry), service, service_len + 1);
+	memcpy(ENTRY_ROUTE(entry), route, route_len + 1);
+
+	/* replace the previous entry (if any) */
+	if (*link != NULL) {
+		entry->next = (*link)->next;
+		free(*link);
+		cache->count--;
+	} else {
+		entry->next = NULL;
+	}
+	*link = entry;
+	cache->count++;
+	return 0;
+}
+
+
+/* removes the route of a service */
+int route_cache_remove(route_cache_t* cache, const char* host, const char* service)
+{
+	route_entry_t**	link = find_entry(cache, host, service, hash_key(host, service));
+	route_entry_t*	entry;
+
+	if ((entry = *link) == NULL) {
+		return -1;
+	}
+	*link = entry->next;
+	free(entry);
+	cache->count--;
+	return 0;
+}
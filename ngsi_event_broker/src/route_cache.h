@@ -0,0 +1,131 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   route_cache.h
+ * @brief  Cache of adapter request routes macros and declarations
+ *
+ * This file declares a cache used by the [Event Broker](@NagiosModule_ref) to
+ * keep the request URL (route) composed for every service, given that it only
+ * depends on the service definition. Thus, neither object lookups nor macro
+ * expansion are needed for further results of the same service, as long as
+ * the cache is flushed whenever definitions may change.
+ */
+
+
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Default number of buckets of a cache */
+#define ROUTE_CACHE_BUCKETS		4096
+
+
+/** Opaque cache type */
+typedef struct route_cache route_cache_t;
+
+
+/**
+ * Creates a new empty cache
+ *
+ * @param[in] buckets		The number of buckets of the hash table (not a limit of entries).
+ *
+ * @return			The new cache, or NULL if it could not be created.
+ */
+route_cache_t* route_cache_create(size_t buckets);
+
+
+/**
+ * Releases resources for given cache
+ *
+ * @param[in] cache		The cache.
+ */
+void route_cache_free(route_cache_t* cache);
+
+
+/**
+ * Removes all the entries of the cache
+ *
+ * @param[in] cache		The cache.
+ */
+void route_cache_clear(route_cache_t* cache);
+
+
+/**
+ * Gets the number of entries in the cache
+ *
+ * @param[in] cache		The cache.
+ *
+ * @return			The number of entries.
+ */
+size_t route_cache_count(const route_cache_t* cache);
+
+
+/**
+ * Gets the route of a service
+ *
+ * @param[in] cache		The cache.
+ * @param[in] host		The host name of the service.
+ * @param[in] service		The description of the service.
+ *
+ * @return			The route (owned by the cache), or NULL if not found.
+ */
+const char* route_cache_get(const route_cache_t* cache, const char* host, const char* service);
+
+
+/**
+ * Sets the route of a service, replacing the previous one (if any)
+ *
+ * @param[in] cache		The cache.
+ * @param[in] host		The host name of the service.
+ * @param[in] service		The description of the service.
+ * @param[in] route		The route (copied).
+ *
+ * @retval 0			Successfully set.
+ * @retval -1			Cannot allocate memory.
+ */
+int route_cache_put(route_cache_t* cache, const char* host, const char* service, const char* route);
+
+
+/**
+ * Removes the route of a service
+ *
+ * @param[in] cache		The cache.
+ * @param[in] host		The host name of the service.
+ * @param[in] service		The description of the service.
+ *
+ * @retval 0			Successfully removed.
+ * @retval -1			Not found.
+ */
+int route_cache_remove(route_cache_t* cache, const char* host, const char* service);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*ROUTE_CACHE_H*/
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   string_pool.c
+ * @brief  Pool of interned strings implementation
+ *
+ * This file consists of the implementation of a pool of strings stored one
+ * after another in large chunks of memory (thus, with no allocation per string
+ * and no fragmentation), plus an open addressing hash table of references to
+ * them, doubled whenever half full. Strings longer than a chunk get their own.
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "string_pool.h"
+
+
+/* initial number of slots of the hash table (power of two) */
+#define INITIAL_SLOTS		1024
+
+
+/* chunk of memory, followed by the strings stored in it */
+typedef struct string_chunk {
+	struct string_chunk*	next;
+	size_t			capacity;
+	size_t			used;
+} string_chunk_t;
+
+
+/* pool definition */
+struct string_pool {
+	const char**		slots;		/* interned strings (NULL if free) */
+	uint32_t*		hashes;		/* hashes of the interned strings */
+	size_t			size;		/* number of slots */
+	size_t			count;		/* number of strings */
+	size_t			bytes;		/* size of the strings */
+	string_chunk_t*		chunks;		/* chunks (the first one being filled) */
+};
+
+
+/* hashes a string (FNV-1a), returning also its length */
+static uint32_t hash_string(const char* str, size_t* len)
+{
+	uint32_t		hash = 2166136261U;
+	const unsigned char*	ptr;
+
+	for (ptr = (const unsigned char*) str; *ptr; ptr++) {
+		hash = (hash ^ *ptr) * 16777619U;
+	}
+	*len = ptr - (const unsigned char*) str;
+	return hash;
+}
+
+
+/* doubles the number of slots of the hash table */
+static int grow_slots(string_pool_t* pool)
+{
+	size_t		size   = pool->size * 2;
+	const char**	slots  = (const char**) calloc(size, sizeof(const char*));
+	uint32_t*	hashes = (uint32_t*) calloc(size, sizeof(uint32_t));
+	size_t		i, j;
+
+	if ((slots == NULL) || (hashes == NULL)) {
+		free(slots);
+		free(hashes);
+		return -1;
+	}
+	for (i = 0; i < pool->size; i++) {
+		if (pool->slots[i] != NULL) {
+			for (j = pool->hashes[i] & (size - 1); slots[j] != NULL; j = (j + 1) & (size - 1));
+			slots[j]  = pool->slots[i];
+			hashes[j] = pool->hashes[i];
+		}
+	}
+	free(pool->slots);
+	free(pool->hashes);
+	pool->slots  = slots;
+	pool->hashes = hashes;
+	pool->size   = size;
+	return 0;
+}
+
+
+/* stores a copy of a string in a chunk, getting a new one if needed */
+static const char* store_string(string_pool_t* pool, const char* str, size_t len)
+{
+	string_chunk_t*	chunk = pool->chunks;
+	char*		copy;
+
+	if ((chunk == NULL) || (chunk->capacity - chunk->used < len + 1)) {
+		size_t capacity = (len + 1 > STRING_POOL_CHUNK_SIZE) ? len + 1 : STRING_POOL_CHUNK_SIZE;
+		if ((chunk = (string_chunk_t*) malloc(sizeof(string_chunk_t) + capacity)) == NULL) {
+			return NULL;
+		}
+		chunk->capacity = capacity;
+		chunk->used     = 0;
+		if ((pool->chunks != NULL) && (capacity > STRING_POOL_CHUNK_SIZE)) {
+			/* keep filling the current chunk */
+			chunk->next = pool->chunks->next;
+			pool->chunks->next = chunk;
+		} else {
+			chunk->next  = pool->chunks;
+			pool->chunks = chunk;
+		}
+	}
+
+	copy = (char*) (chunk + 1) + chunk->used;
+	memcpy(copy, str, len + 1);
+	chunk->used += len + 1;
+	return copy;
+}
+
+
+/* creates a new empty pool */
+string_pool_t* string_pool_create(void)
+{
+	string_pool_t* pool = NULL;
+
+	if ((pool = (string_pool_t*) calloc(1, sizeof(string_pool_t))) == NULL) {
+		return NULL;
+	} else if (((pool->slots = (const char**) calloc(INITIAL_SLOTS, sizeof(const char*))) == NULL)
+	           || ((pool->hashes = (uint32_t*) calloc(INITIAL_SLOTS, sizeof(uint32_t))) == NULL)) {
+		free(pool->slots);
+		free(pool);
+		return NULL;
+	}
+
+	pool->size = INITIAL_SLOTS;
+	return pool;
+}
+
+
+/* releases resources for given pool */
+void string_pool_free(string_pool_t* pool)
+{
+	if (pool != NULL) {
+		while (pool->chunks != NULL) {
+			string_chunk_t* chunk = pool->chunks;
+			pool->chunks = chunk->next;
+			free(chunk);
+		}
+		free(pool->slots);
+		free(pool->hashes);
+		free(pool);
+	}
+}
+
+
+/* gets the interned copy of a string */
+const char* string_pool_intern(string_pool_t* pool, const char* str)
+{
+	size_t		len;
+	uint32_t	hash = hash_string(str, &len);
+	size_t		i;
+
+	for (i = hash & (pool->size - 1); pool->slots[i] != NULL; i = (i + 1) & (pool->size - 1)) {
+		if ((pool->hashes[i] == hash) && !strcmp(pool->slots[i], str)) {
+			return pool->slots[i];
+		}
+	}
+
+	/* not found: add it (growing the table first if half full) */
+	if ((pool->count + 1) * 2 > pool->size) {
+		if (grow_slots(pool) != 0) {
+			return NULL;
+		}
+		for (i = hash & (pool->size - 1); pool->slots[i] != NULL; i = (i + 1) & (pool->size - 1));
+	}
+	if ((pool->slots[i] = store_string(pool, str, len)) != NULL) {
+		pool->hashes[i] = hash;
+		pool->count++;
+		pool->bytes += len + 1;
+	}
+	return pool->slots[i];
+}
+
+
+/* gets the number of strings */
+size_t string_pool_count(const string_pool_t* pool)
+{
+	return pool->count;
+}
+
+
+/* gets the size of the strings */
+size_t string_pool_size(const string_pool_t* pool)
+{
+	return pool->bytes;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   string_pool.h
+ * @brief  Pool of interned strings macros and declarations
+ *
+ * This file declares a pool used by the [Event Broker](@NagiosModule_ref) to
+ * keep a single copy of every distinct string (e.g. the routes of services)
+ * for the whole module lifetime. Interned strings are never released but with
+ * the pool, so that references to them may be kept without copies, and equal
+ * strings obtained again (e.g. after a reload) take no further memory.
+ */
+
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Size in bytes of the memory chunks where strings are stored */
+#define STRING_POOL_CHUNK_SIZE		65536
+
+
+/** Opaque pool type */
+typedef struct string_pool string_pool_t;
+
+
+/**
+ * Creates a new empty pool
+ *
+ * @return			The new pool, or NULL if it could not be created.
+ */
+string_pool_t* string_pool_create(void);
+
+
+/**
+ * Releases resources for given pool (including all interned strings)
+ *
+ * @param[in] pool		The pool.
+ */
+void string_pool_free(string_pool_t* pool);
+
+
+/**
+ * Gets the interned copy of a string, adding it to the pool if not found
+ *
+ * @param[in] pool		The pool.
+ * @param[in] str		The string.
+ *
+ * @return			The interned string (valid until the pool is released), or NULL on errors.
+ */
+const char* string_pool_intern(string_pool_t* pool, const char* str);
+
+
+/**
+ * Gets the number of distinct strings in the pool
+ *
+ * @param[in] pool		The pool.
+ *
+ * @return			The number of strings.
+ */
+size_t string_pool_count(const string_pool_t* pool);
+
+
+/**
+ * Gets the size in bytes of the memory taken by the strings in the pool
+ *
+ * @param[in] pool		The pool.
+ *
+ * @return			The size of the strings (including terminators).
+ */
+size_t string_pool_size(const string_pool_t* pool);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*STRING_POOL_H*/
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   url_template.c
+ * @brief  Templates of adapter request URLs implementation
+ *
+ * This file consists of the implementation of templates compiled into a list of
+ * operations, each one copying either a literal (taken from a single buffer with
+ * all the literals of the template) or the value of a field. Expansion takes two
+ * passes: the first one sums up the lengths, the second one copies with memcpy()
+ * into a buffer allocated with the exact size. Percent-encoding of values takes
+ * a lookup table of encoded lengths, so that values needing no encoding at all
+ * (the usual case) are found while measured, and then copied as they are.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "url_template.h"
+
+
+/* operation copying a literal */
+#define LITERAL			-1
+
+
+/* initial number of operations */
+#define INITIAL_OPS		8
+
+
+/* initial size of the literals */
+#define INITIAL_LITERALS	64
+
+
+/* length of every character once percent-encoded (unreserved characters are kept as they are) */
+static const unsigned char encoded_lengths[256] = {
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 1, 1, 3,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3,
+	3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 1,
+	3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 1, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3
+};
+
+
+/* hexadecimal digits of percent-encoded characters */
+static const char hex_digits[] = "0123456789ABCDEF";
+
+
+/* names of the fields, as referenced in templates */
+static const char* const field_names[URL_TEMPLATE_FIELD_COUNT] = {
+	[URL_TEMPLATE_FIELD_URL]	= "url",
+	[URL_TEMPLATE_FIELD_COMMAND]	= "command",
+	[URL_TEMPLATE_FIELD_REGION]	= "region",
+	[URL_TEMPLATE_FIELD_HOST_NAME]	= "host_name",
+	[URL_TEMPLATE_FIELD_SERVICE]	= "service",
+	[URL_TEMPLATE_FIELD_ADDRESS]	= "address",
+	[URL_TEMPLATE_FIELD_PORT]	= "port",
+	[URL_TEMPLATE_FIELD_TYPE]	= "type"
+};
+
+
+/* operation of a template */
+typedef struct url_template_op {
+	int			field;		/* field to copy (LITERAL if none) */
+	size_t			offset;		/* offset of the literal */
+	size_t			length;		/* length of the literal */
+} url_template_op_t;
+
+
+/* template definition */
+struct url_template {
+	url_template_op_t*	ops;		/* operations */
+	size_t			count;		/* number of operations */
+	size_t			capacity;	/* allocated operations */
+	char*			literals;	/* text of all the literals */
+	size_t			used;		/* length of the literals */
+	size_t			size;		/* allocated size of the literals */
+};
+
+
+/* makes room for another operation and for a number of bytes of literals */
+static int reserve(url_template_t* tmpl, size_t bytes)
+{
+	if (tmpl->count == tmpl->capacity) {
+		size_t			capacity = (tmpl->capacity) ? (tmpl->capacity * 2) : INITIAL_OPS;
+		url_template_op_t*	ops	 = (url_template_op_t*) realloc(tmpl->ops, capacity * sizeof(url_template_op_t));
+		if (ops == NULL) {
+			return 1;
+		}
+		tmpl->ops      = ops;
+		tmpl->capacity = capacity;
+	}
+	if (tmpl->used + bytes > tmpl->size) {
+		size_t	size	 = tmpl->used + bytes + INITIAL_LITERALS;
+		char*	literals = (char*) realloc(tmpl->literals, size);
+		if (literals == NULL) {
+			return 1;
+		}
+		tmpl->literals = literals;
+		tmpl->size     = size;
+	}
+	return 0;
+}
+
+
+/* appends a literal to a template, merged with the previous operation if also a literal */
+static int append_literal(url_template_t* tmpl, const char* text, size_t length)
+{
+	url_template_op_t* last;
+
+	if (length == 0) {
+		return 0;
+	} else if (reserve(tmpl, length)) {
+		return 1;
+	}
+	last = (tmpl->count > 0) ? &tmpl->ops[tmpl->count-1] : NULL;
+	if ((last == NULL) || (last->field != LITERAL)) {
+		last = &tmpl->ops[tmpl->count++];
+		last->field  = LITERAL;
+		last->offset = tmpl->used;
+		last->length = 0;
+	}
+	memcpy(tmpl->literals + tmpl->used, text, length);
+	tmpl->used   += length;
+	last->length += length;
+	return 0;
+}
+
+
+/* appends the operations of a template text, returning non-zero if invalid */
+static int append_text(url_template_t* tmpl, const char* text, const char* nested)
+{
+	const char* ptr = text;
+
+	while (*ptr) {
+		size_t span = strcspn(ptr, "{}");
+		if (append_literal(tmpl, ptr, span)) {
+			return 1;
+		}
+		ptr += span;
+		if (*ptr == '\0') {
+			break;
+		} else if (ptr[1] == *ptr) {
+			/* escaped brace */
+			if (append_literal(tmpl, ptr, 1)) {
+				return 1;
+			}
+			ptr += 2;
+		} else if (*ptr == '}') {
+			return 1;
+		} else {
+			const char* name = ptr + 1;
+			const char* end  = strchr(name, '}');
+			size_t      len  = (end) ? (size_t) (end - name) : 0;
+			int         i;
+
+			if (end == NULL) {
+				return 1;
+			}
+			for (i = 0; (i < URL_TEMPLATE_FIELD_COUNT)
+			            && (strncmp(field_names[i], name, len) || field_names[i][len]); i++);
+			if (i < URL_TEMPLATE_FIELD_COUNT) {
+				url_template_op_t* op;
+				if (reserve(tmpl, 0)) {
+					return 1;
+				}
+				op = &tmpl->ops[tmpl->count++];
+				op->field  = i;
+				op->offset = 0;
+				op->length = 0;
+			} else if (nested && (len == strlen(URL_TEMPLATE_NESTED)) && !strncmp(name, URL_TEMPLATE_NESTED, len)) {
+				if (append_text(tmpl, nested, NULL)) {
+					return 1;
+				}
+			} else {
+				return 1;
+			}
+			ptr = end + 1;
+		}
+	}
+	return 0;
+}
+
+
+/* compiles a template */
+url_template_t* url_template_compile(const char* text, const char* nested)
+{
+	url_template_t* tmpl = NULL;
+
+	if ((tmpl = (url_template_t*) calloc(1, sizeof(url_template_t))) == NULL) {
+		return NULL;
+	} else if (append_text(tmpl, text, nested)) {
+		url_template_free(tmpl);
+		return NULL;
+	}
+	return tmpl;
+}
+
+
+/* releases resources for given template */
+void url_template_free(url_template_t* tmpl)
+{
+	if (tmpl != NULL) {
+		free(tmpl->ops);
+		free(tmpl->literals);
+		free(tmpl);
+	}
+}
+
+
+/* gets the length of a string once percent-encoded */
+size_t url_encoded_length(const char* str, size_t* raw)
+{
+	const unsigned char*	ptr;
+	size_t			length = 0;
+
+	for (ptr = (const unsigned char*) str; *ptr; ptr++) {
+		length += encoded_lengths[*ptr];
+	}
+	if (raw != NULL) {
+		*raw = ptr - (const unsigned char*) str;
+	}
+	return length;
+}
+
+
+/* percent-encodes a string into a buffer */
+char* url_encode(char* dst, const char* src)
+{
+	const unsigned char* ptr;
+
+	for (ptr = (const unsigned char*) src; *ptr; ptr++) {
+		if (encoded_lengths[*ptr] == 1) {
+			*dst++ = *ptr;
+		} else {
+			*dst++ = '%';
+			*dst++ = hex_digits[*ptr >> 4];
+			*dst++ = hex_digits[*ptr & 0x0F];
+		}
+	}
+	return dst;
+}
+
+
+/* expands a template into a newly allocated string of the exact length */
+char* url_template_expand(const url_template_t* tmpl, const url_template_values_t values)
+{
+	size_t	lengths[URL_TEMPLATE_FIELD_COUNT];
+	size_t	raw[URL_TEMPLATE_FIELD_COUNT];
+	size_t	length = 0;
+	char*	result = NULL;
+	char*	ptr;
+	size_t	i;
+
+	/* fields may be referenced several times: measure each value just once */
+	for (i = 0; i < URL_TEMPLATE_FIELD_COUNT; i++) {
+		if (values[i] == NULL) {
+			lengths[i] = raw[i] = 0;
+		} else if (i == URL_TEMPLATE_FIELD_URL) {
+			lengths[i] = raw[i] = strlen(values[i]);
+		} else {
+			lengths[i] = url_encoded_length(values[i], &raw[i]);
+		}
+	}
+	for (i = 0; i < tmpl->count; i++) {
+		const url_template_op_t* op = &tmpl->ops[i];
+		length += (op->field == LITERAL) ? op->length : lengths[op->field];
+	}
+
+	if ((result = (char*) malloc(length + 1)) != NULL) {
+		for (ptr = result, i = 0; i < tmpl->count; i++) {
+			const url_template_op_t* op = &tmpl->ops[i];
+			if (op->field == LITERAL) {
+				memcpy(ptr, tmpl->literals + op->offset, op->length);
+				ptr += op->length;
+			} else if (raw[op->field] == 0) {
+				/* empty or null value */
+			} else if (lengths[op->field] == raw[op->field]) {
+				memcpy(ptr, values[op->field], raw[op->field]);
+				ptr += raw[op->field];
+			} else {
+				ptr = url_encode(ptr, values[op->field]);
+			}
+		}
+		*ptr = '\0';
+	}
+	return result;
+}
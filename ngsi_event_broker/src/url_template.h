@@ -0,0 +1,130 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   url_template.h
+ * @brief  Templates of adapter request URLs macros and declarations
+ *
+ * This file declares the templates used by the [Event Broker](@NagiosModule_ref)
+ * to compose the URLs of requests to NGSI Adapter. A template is a text where
+ * fields are referenced by name between braces (e.g. `{region}:{host_name}`),
+ * compiled once into a list of literal and field copy operations, so that URLs
+ * are later expanded with no parsing at all. Literal braces are written twice.
+ * Values of fields are percent-encoded as they are copied (except that of `{url}`).
+ */
+
+
+#ifndef URL_TEMPLATE_H
+#define URL_TEMPLATE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stddef.h>
+
+
+/** Name of the field standing for a nested template given at compilation (see ::url_template_compile) */
+#define URL_TEMPLATE_NESTED		"id"
+
+
+/** Fields that may be referenced in templates */
+typedef enum {
+	URL_TEMPLATE_FIELD_URL,		/**< `{url}`: the URL of NGSI Adapter */
+	URL_TEMPLATE_FIELD_COMMAND,	/**< `{command}`: the name of the plugin command */
+	URL_TEMPLATE_FIELD_REGION,	/**< `{region}`: the region id */
+	URL_TEMPLATE_FIELD_HOST_NAME,	/**< `{host_name}`: the host name of the service */
+	URL_TEMPLATE_FIELD_SERVICE,	/**< `{service}`: the service description */
+	URL_TEMPLATE_FIELD_ADDRESS,	/**< `{address}`: the address of the monitored resource */
+	URL_TEMPLATE_FIELD_PORT,	/**< `{port}`: the port of the monitored resource */
+	URL_TEMPLATE_FIELD_TYPE,	/**< `{type}`: the entity type */
+	URL_TEMPLATE_FIELD_COUNT	/**< Number of fields (not a field) */
+} url_template_field_t;
+
+
+/** Values of the fields, indexed by ::url_template_field_t (null values expand to nothing, and
+ *  values are percent-encoded, except that of ::URL_TEMPLATE_FIELD_URL) */
+typedef const char* url_template_values_t[URL_TEMPLATE_FIELD_COUNT];
+
+
+/** Opaque template type */
+typedef struct url_template url_template_t;
+
+
+/**
+ * Compiles a template
+ *
+ * @param[in] text		The text of the template.
+ * @param[in] nested		The text of the template expanded in place of field `{id}` (may be null, and
+ *				must not reference such field itself).
+ *
+ * @return			The compiled template, or NULL if invalid (i.e. unknown fields or unbalanced
+ *				braces) or it could not be allocated.
+ */
+url_template_t* url_template_compile(const char* text, const char* nested);
+
+
+/**
+ * Releases resources for given template
+ *
+ * @param[in] tmpl		The template.
+ */
+void url_template_free(url_template_t* tmpl);
+
+
+/**
+ * Expands a template into a newly allocated string of the exact length
+ *
+ * @param[in] tmpl		The template.
+ * @param[in] values		The values of the fields.
+ *
+ * @return			The expanded string (to be released by caller), or NULL on errors.
+ */
+char* url_template_expand(const url_template_t* tmpl, const url_template_values_t values);
+
+
+/**
+ * Gets the length of a string once percent-encoded (i.e. all characters except unreserved ones in RFC 3986)
+ *
+ * @param[in] str		The string.
+ * @param[out] raw		The length of the string itself (may be null).
+ *
+ * @return			The length of the encoded string (not including terminator).
+ */
+size_t url_encoded_length(const char* str, size_t* raw);
+
+
+/**
+ * Percent-encodes a string into a buffer
+ *
+ * @param[out] dst		The buffer (of ::url_encoded_length bytes at least, no terminator is written).
+ * @param[in] src		The string.
+ *
+ * @return			The position of the buffer past the last encoded character.
+ */
+char* url_encode(char* dst, const char* src);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /*URL_TEMPLATE_H*/
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_arena.cc
+ * @brief  Test suite to verify the arena allocator
+ *
+ * This file defines unit tests to verify the arena used to allocate transient
+ * strings while processing a check result (see arena.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include "arena.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// Arena test suite
+class ArenaTest: public TestFixture
+{
+	// tests
+	void alloc_takes_memory_from_buffer();
+	void alloc_returns_aligned_memory();
+	void alloc_takes_heap_chunk_when_buffer_exhausted();
+	void reset_rewinds_to_buffer();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(ArenaTest);
+	CPPUNIT_TEST(alloc_takes_memory_from_buffer);
+	CPPUNIT_TEST(alloc_returns_aligned_memory);
+	CPPUNIT_TEST(alloc_takes_heap_chunk_when_buffer_exhausted);
+	CPPUNIT_TEST(reset_rewinds_to_buffer);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(ArenaTest::suite());
+	ArenaTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	ArenaTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Some string
+#define SOME_STRING		"http://adapter:1337/check_disk?id=region:host1&type=host"
+
+
+///
+/// Suite setup
+///
+void ArenaTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void ArenaTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void ArenaTest::setUp()
+{
+}
+
+
+///
+/// Tests teardown
+///
+void ArenaTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void ArenaTest::alloc_takes_memory_from_buffer()
+{
+	char	buffer[ARENA_BUFFER_SIZE];
+	arena_t	arena;
+
+	// given
+	arena_init(&arena, buffer, sizeof(buffer));
+
+	// when
+	char* first  = arena_strdup(&arena, SOME_STRING);
+	char* second = arena_strdup(&arena, "other");
+
+	// then
+	CPPUNIT_ASSERT(first && (string(first) == SOME_STRING));
+	CPPUNIT_ASSERT(second && (string(second) == "other"));
+	CPPUNIT_ASSERT((first >= buffer) && (second > first) && (second < buffer + sizeof(buffer)));
+	CPPUNIT_ASSERT(arena.chunks == NULL);
+	arena_reset(&arena);
+}
+
+
+void ArenaTest::alloc_returns_aligned_memory()
+{
+	char	buffer[ARENA_BUFFER_SIZE];
+	arena_t	arena;
+	bool	all_aligned = true;
+
+	// given
+	arena_init(&arena, buffer + 1, sizeof(buffer) - 1);	// misaligned buffer
+
+	// when
+	for (size_t i = 1; i < 10; i++) {
+		void* ptr = arena_alloc(&arena, i);
+		all_aligned = all_aligned && ptr && (((size_t) ptr % sizeof(void*)) == 0);
+	}
+
+	// then
+	CPPUNIT_ASSERT(all_aligned);
+	arena_reset(&arena);
+}
+
+
+void ArenaTest::alloc_takes_heap_chunk_when_buffer_exhausted()
+{
+	char	buffer[64];
+	arena_t	arena;
+
+	// given
+	arena_init(&arena, buffer, sizeof(buffer));
+	string large(2 * ARENA_CHUNK_SIZE, 'x');
+
+	// when
+	char* first  = arena_strdup(&arena, SOME_STRING);
+	char* second = arena_strdup(&arena, large.c_str());
+
+	// then
+	CPPUNIT_ASSERT(first && (string(first) == SOME_STRING));
+	CPPUNIT_ASSERT(second && (large == second));
+	CPPUNIT_ASSERT(arena.chunks != NULL);
+	arena_reset(&arena);
+}
+
+
+void ArenaTest::reset_rewinds_to_buffer()
+{
+	char	buffer[ARENA_BUFFER_SIZE];
+	arena_t	arena;
+
+	// given
+	arena_init(&arena, buffer, sizeof(buffer));
+	char* first = (char*) arena_alloc(&arena, sizeof(buffer) / 2);
+	arena_alloc(&arena, sizeof(buffer));
+
+	// when
+	arena_reset(&arena);
+
+	// then
+	char* again = (char*) arena_alloc(&arena, 1);
+	CPPUNIT_ASSERT(arena.chunks == NULL);
+	CPPUNIT_ASSERT(again && (again == first));
+	arena_reset(&arena);
+}
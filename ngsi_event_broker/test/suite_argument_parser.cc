@@ -81,6 +81,11 @@ class ArgumentParserTest: public TestFixture
 	void parse_ok_with_valid_argument_opts_space_separation();
 	void parse_ok_with_valid_argument_opts_tab_separation();
 	void parse_ok_with_valid_argument_opts_no_separation();
+	void parse_into_arena_allocates_no_option_values();
+	void parse_ok_with_quoted_values();
+	void parse_ok_with_grouped_options_and_positional_args();
+	void parse_stops_at_end_of_options();
+	void scan_returns_views_of_values();
 
 public:
 	static void suiteSetUp();
@@ -94,6 +99,11 @@ public:
 	CPPUNIT_TEST(parse_ok_with_valid_argument_opts_space_separation);
 	CPPUNIT_TEST(parse_ok_with_valid_argument_opts_tab_separation);
 	CPPUNIT_TEST(parse_ok_with_valid_argument_opts_no_separation);
+	CPPUNIT_TEST(parse_into_arena_allocates_no_option_values);
+	CPPUNIT_TEST(parse_ok_with_quoted_values);
+	CPPUNIT_TEST(parse_ok_with_grouped_options_and_positional_args);
+	CPPUNIT_TEST(parse_stops_at_end_of_options);
+	CPPUNIT_TEST(scan_returns_views_of_values);
 	CPPUNIT_TEST_SUITE_END();
 };
 
@@ -320,3 +330,106 @@ void ArgumentParserTest::parse_ok_with_valid_argument_opts(const string& separat
 	CPPUNIT_ASSERT(found_opt_valid_2);
 	CPPUNIT_ASSERT(optlist.size() == 2);
 }
+
+
+void ArgumentParserTest::parse_into_arena_allocates_no_option_values()
+{
+	char		buffer[ARENA_BUFFER_SIZE];
+	arena_t		arena;
+	option_spec_t	spec;
+
+	// given
+	string optstr  = OPTSTR_PREFIX "a:b:";
+	string argline = "-a first -bsecond";
+	compile_option_spec(&spec, optstr.c_str());
+	arena_init(&arena, buffer, sizeof(buffer));
+
+	// when
+	option_list_t opts = ::parse_args_into(argline.c_str(), &spec, &arena);
+
+	// then
+	CPPUNIT_ASSERT(opts != NULL);
+	CPPUNIT_ASSERT((opts[0].opt == 'a') && opts[0].val && (string(opts[0].val) == "first"));
+	CPPUNIT_ASSERT((opts[1].opt == 'b') && opts[1].val && (string(opts[1].val) == "second"));
+	CPPUNIT_ASSERT(opts[2].opt == NO_CHAR);
+	CPPUNIT_ASSERT((opts[0].val > buffer) && (opts[1].val < buffer + sizeof(buffer)));
+	CPPUNIT_ASSERT(arena.chunks == NULL);
+	arena_reset(&arena);
+}
+
+
+void ArgumentParserTest::parse_ok_with_quoted_values()
+{
+	// given
+	string optstr  = OPTSTR_PREFIX "a:b:c:";
+	string argline = "-a 'first value' -b\"second\tvalue\" -c \"\"";
+
+	// when
+	list<OptionValue> optlist;
+	parse_args(argline, optstr, optlist);
+
+	// then
+	list<OptionValue>::iterator iter = optlist.begin();
+	CPPUNIT_ASSERT(optlist.size() == 3);
+	CPPUNIT_ASSERT((iter->opt == 'a') && (iter->val == "first value"));
+	CPPUNIT_ASSERT((++iter)->opt == 'b' && (iter->val == "second\tvalue"));
+	CPPUNIT_ASSERT((++iter)->opt == 'c' && (iter->val == ""));
+}
+
+
+void ArgumentParserTest::parse_ok_with_grouped_options_and_positional_args()
+{
+	// given
+	string optstr  = OPTSTR_PREFIX "H:nuc:a:";
+	string argline = "-H host -nu -c check_disk -a arg1 arg2 -a arg3";
+
+	// when
+	list<OptionValue> optlist;
+	parse_args(argline, optstr, optlist);
+
+	// then
+	string opts, vals;
+	for (list<OptionValue>::iterator iter = optlist.begin(); iter != optlist.end(); iter++) {
+		opts += (char) iter->opt;
+		vals += iter->val + ",";
+	}
+	CPPUNIT_ASSERT_EQUAL(string("Hnucaa"), opts);
+	CPPUNIT_ASSERT_EQUAL(string("host,,,check_disk,arg1,arg3,"), vals);
+}
+
+
+void ArgumentParserTest::parse_stops_at_end_of_options()
+{
+	// given
+	string optstr  = OPTSTR_PREFIX "a:b:";
+	string argline = "-a value -- -b value";
+
+	// when
+	list<OptionValue> optlist;
+	parse_args(argline, optstr, optlist);
+
+	// then
+	CPPUNIT_ASSERT(optlist.size() == 1);
+	CPPUNIT_ASSERT((optlist.front().opt == 'a') && (optlist.front().val == "value"));
+}
+
+
+void ArgumentParserTest::scan_returns_views_of_values()
+{
+	struct option_value	optlist[4];
+	option_spec_t		spec;
+
+	// given
+	const char* argline = "-a first -b 'second value'";
+	compile_option_spec(&spec, OPTSTR_PREFIX "a:b:");
+
+	// when
+	size_t count = scan_args(argline, &spec, optlist, 4);
+
+	// then
+	CPPUNIT_ASSERT(count == 2);
+	CPPUNIT_ASSERT((optlist[0].opt == 'a') && (optlist[0].val == argline + 3) && (optlist[0].len == 5));
+	CPPUNIT_ASSERT((optlist[1].opt == 'b') && (optlist[1].off == 13) && (optlist[1].len == 12));
+	CPPUNIT_ASSERT(string(argline + optlist[1].off, optlist[1].len) == "second value");
+	CPPUNIT_ASSERT(optlist[2].opt == NO_CHAR);
+}
@@ -59,6 +59,7 @@ extern "C" {
 	char* const module_name		= PACKAGE_NAME;
 	char* const module_version	= PACKAGE_VERSION;
 	void*       module_handle	= NULL;
+	const char* const request_template_texts[] = { NULL };
 }
 
 
@@ -72,6 +73,10 @@ extern "C" {
 	{
 		return NULL;
 	}
+	int is_service_ignored(const service* serv)
+	{
+		return 0;
+	}
 }
 
 
@@ -119,6 +124,26 @@ class BrokerCommonTest: public TestFixture
 	void init_fails_when_callback_cannot_be_registered();
 	void init_ok_with_valid_mandatory_args();
 	void init_ok_with_optional_logging_arg();
+	void init_ok_with_optional_queueing_args();
+	void init_fails_with_invalid_queue_size();
+	void init_fails_with_invalid_overflow_policy();
+	void init_ok_with_optional_inflight_limit_arg();
+	void init_ok_with_optional_adaptive_inflight_limit_arg();
+	void init_fails_with_invalid_inflight_limit_range();
+	void init_ok_with_optional_batching_args();
+	void init_ok_with_udp_adapter_url();
+	void init_fails_with_invalid_udp_adapter_url();
+	void init_ok_with_optional_adapter_socket_arg();
+	void init_ok_with_optional_spool_args();
+	void init_fails_with_invalid_spool_size();
+	void init_ok_with_several_adapter_urls();
+	void init_fails_when_mixing_udp_and_http_adapter_urls();
+	void init_ok_with_optional_service_pattern_args();
+	void init_fails_with_invalid_service_pattern();
+	void init_ok_with_optional_dns_ttl_arg();
+	void init_fails_with_invalid_dns_ttl();
+	void init_ok_with_optional_entity_id_template_arg();
+	void init_fails_with_invalid_entity_id_template();
 
 public:
 	static void suiteSetUp();
@@ -138,6 +163,26 @@ public:
 	CPPUNIT_TEST(init_fails_when_callback_cannot_be_registered);
 	CPPUNIT_TEST(init_ok_with_valid_mandatory_args);
 	CPPUNIT_TEST(init_ok_with_optional_logging_arg);
+	CPPUNIT_TEST(init_ok_with_optional_queueing_args);
+	CPPUNIT_TEST(init_fails_with_invalid_queue_size);
+	CPPUNIT_TEST(init_fails_with_invalid_overflow_policy);
+	CPPUNIT_TEST(init_ok_with_optional_inflight_limit_arg);
+	CPPUNIT_TEST(init_ok_with_optional_adaptive_inflight_limit_arg);
+	CPPUNIT_TEST(init_fails_with_invalid_inflight_limit_range);
+	CPPUNIT_TEST(init_ok_with_optional_batching_args);
+	CPPUNIT_TEST(init_ok_with_udp_adapter_url);
+	CPPUNIT_TEST(init_fails_with_invalid_udp_adapter_url);
+	CPPUNIT_TEST(init_ok_with_optional_adapter_socket_arg);
+	CPPUNIT_TEST(init_ok_with_optional_spool_args);
+	CPPUNIT_TEST(init_fails_with_invalid_spool_size);
+	CPPUNIT_TEST(init_ok_with_several_adapter_urls);
+	CPPUNIT_TEST(init_fails_when_mixing_udp_and_http_adapter_urls);
+	CPPUNIT_TEST(init_ok_with_optional_service_pattern_args);
+	CPPUNIT_TEST(init_fails_with_invalid_service_pattern);
+	CPPUNIT_TEST(init_ok_with_optional_dns_ttl_arg);
+	CPPUNIT_TEST(init_fails_with_invalid_dns_ttl);
+	CPPUNIT_TEST(init_ok_with_optional_entity_id_template_arg);
+	CPPUNIT_TEST(init_fails_with_invalid_entity_id_template);
 	CPPUNIT_TEST_SUITE_END();
 };
 
@@ -540,3 +585,458 @@ void BrokerCommonTest::init_ok_with_optional_logging_arg()
 	CPPUNIT_ASSERT(region == ::region_id);
 	CPPUNIT_ASSERT(::log_level == level);
 }
+
+
+void BrokerCommonTest::init_ok_with_optional_queueing_args()
+{
+	// given
+	int	flags	= 0;
+	size_t	size	= 16,
+		threads	= 2;
+	overflow_policy_t policy = OVERFLOW_DROP_OLD;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-q" << size
+		<< ' ' << "-t" << threads
+		<< ' ' << "-o" << overflow_policy_names[policy]
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::queue_size == size);
+	CPPUNIT_ASSERT(::sender_count == threads);
+	CPPUNIT_ASSERT(::overflow_policy == policy);
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_queue_size()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-q" << "not_a_number"
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_overflow_policy()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-q" << 16
+		<< ' ' << "-o" << "drop_none"
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_inflight_limit_arg()
+{
+	// given
+	int	flags	= 0;
+	size_t	limit	= 8;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-n" << limit
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::inflight_limit == limit);
+	CPPUNIT_ASSERT(::queue_size == DEFAULT_QUEUE_SIZE);	// requests are queued
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_adaptive_inflight_limit_arg()
+{
+	// given
+	int	flags	= 0;
+	size_t	min	= 2,
+		max	= 32;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-n" << min << ':' << max
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::inflight_min == min);
+	CPPUNIT_ASSERT(::inflight_limit == max);
+	CPPUNIT_ASSERT(::queue_size == DEFAULT_QUEUE_SIZE);	// requests are queued
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_inflight_limit_range()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-n" << "32:2"
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_batching_args()
+{
+	// given
+	int	flags	= 0;
+	size_t	size	= 100,
+		delay	= 500;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-b" << size
+		<< ' ' << "-d" << delay
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::batch_size == size);
+	CPPUNIT_ASSERT(::batch_delay == delay);
+	CPPUNIT_ASSERT(::queue_size == DEFAULT_QUEUE_SIZE);	// requests are queued
+}
+
+
+void BrokerCommonTest::init_ok_with_udp_adapter_url()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_UDP_SCHEME "127.0.0.1:1234",
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(url == ::adapter_url);
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_udp_adapter_url()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_UDP_SCHEME "127.0.0.1",	// missing port
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_adapter_socket_arg()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		socket	= "/var/run/ngsi_adapter.sock",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-U" << socket
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(socket == ::adapter_socket);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_spool_args()
+{
+	// given
+	int	flags	= 0;
+	size_t	size	= 65536,
+		rate	= 5;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		path	= "suite_broker_common.spool",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-s" << path
+		<< ' ' << "-S" << size
+		<< ' ' << "-R" << rate
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(path == ::spool_path);
+	CPPUNIT_ASSERT(::spool_size == size);
+	CPPUNIT_ASSERT(::replay_rate == rate);
+	CPPUNIT_ASSERT(access(path.c_str(), F_OK) == 0);
+	unlink(path.c_str());
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_spool_size()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-s" << "suite_broker_common.spool"
+		<< ' ' << "-S" << 100
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_several_adapter_urls()
+{
+	// given
+	int	flags	= 0;
+	string	url1	= "http://adapter1:1337",
+		url2	= "http://adapter2:1337",
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url1
+		<< ' ' << "-u" << url2
+		<< ' ' << "-r" << region
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::adapter_url_count == 2);
+	CPPUNIT_ASSERT(url1 == ::adapter_url);
+	CPPUNIT_ASSERT(url2 == ::adapter_urls[1]);
+}
+
+
+void BrokerCommonTest::init_fails_when_mixing_udp_and_http_adapter_urls()
+{
+	// given
+	int	flags	= 0;
+	string	url1	= ADAPTER_URL,
+		url2	= ADAPTER_UDP_SCHEME "127.0.0.1:1337",
+		region	= REGION_ID,
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url1
+		<< ' ' << "-u" << url2
+		<< ' ' << "-r" << region
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_service_pattern_args()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		include	= "^(web|db)[0-9]+$",
+		exclude	= "^Ping$",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-i" << include
+		<< ' ' << "-e" << exclude
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(!::is_service_excluded("web1", "Disk"));
+	CPPUNIT_ASSERT(::is_service_excluded("web1", "Ping"));
+	CPPUNIT_ASSERT(::is_service_excluded("mail1", "Disk"));
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_service_pattern()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		exclude	= "(unbalanced",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-e" << exclude
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_dns_ttl_arg()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		ttl	= "600:60",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-D" << ttl
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::dns_ttl == 600);
+	CPPUNIT_ASSERT(::dns_negative_ttl == 60);
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_dns_ttl()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		ttl	= "600:",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-D" << ttl
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
+
+
+void BrokerCommonTest::init_ok_with_optional_entity_id_template_arg()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		id	= "{region}-{service}@{host_name}",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-T" << id
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(!init_error);
+	CPPUNIT_ASSERT(::entity_id_template && (string(::entity_id_template) == id));
+	CPPUNIT_ASSERT(::request_templates != NULL);
+}
+
+
+void BrokerCommonTest::init_fails_with_invalid_entity_id_template()
+{
+	// given
+	int	flags	= 0;
+	string	url	= ADAPTER_URL,
+		region	= REGION_ID,
+		id	= "{region}:{hostname}",
+		argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << url
+		<< ' ' << "-r" << region
+		<< ' ' << "-T" << id
+		)).str();
+
+	// when
+	bool init_error = nebmodule_init(flags, argline, module_handle) == NEB_ERROR;
+
+	// then
+	CPPUNIT_ASSERT(init_error);
+}
@@ -59,6 +59,10 @@ using CppUnit::BriefTestProgressListener;
 using namespace std;
 
 
+// Nagios list of services
+extern "C" service*	service_list;
+
+
 // Forward declarations for friend members
 extern "C" {
 	int			__wrap_gethostname(char*, size_t);
@@ -77,6 +81,7 @@ extern "C" {
 	CURL*			__wrap_curl_easy_init(void);
 	CURLcode		__wrap_curl_easy_setopt(CURL*, CURLoption, ...);
 	CURLcode		__wrap_curl_easy_perform(CURL*);
+	CURLcode		__wrap_curl_easy_getinfo(CURL*, CURLINFO, ...);
 	void			__wrap_curl_easy_cleanup(CURL*);
 	const char*		__wrap_curl_easy_strerror(CURLcode);
 }
@@ -112,14 +117,24 @@ class BrokerFiwareTest: public TestFixture
 	static CURLcode		__retval_curl_global_init;
 	friend CURLcode		::__wrap_curl_global_init(long);
 	friend void		::__wrap_curl_global_cleanup(void);
+	static size_t		__hitcnt_curl_easy_init;
 	static CURL*		__retval_curl_easy_init;
 	friend CURL*		::__wrap_curl_easy_init(void);
 	static bool		__header_curl_easy_setopt;
+	static curl_read_callback	__readfn_curl_easy_setopt;
+	static void*		__readdata_curl_easy_setopt;
+	static curl_seek_callback	__seekfn_curl_easy_setopt;
+	static void*		__seekdata_curl_easy_setopt;
+	static long		__postsize_curl_easy_setopt;
 	static CURLcode		__retval_curl_easy_setopt;
 	friend CURLcode		::__wrap_curl_easy_setopt(CURL*, CURLoption, ...);
 	static size_t		__hitcnt_curl_easy_perform;
+	static string		__body_curl_easy_perform;
+	static bool		__rewind_curl_easy_perform;
 	static CURLcode		__retval_curl_easy_perform;
 	friend CURLcode		::__wrap_curl_easy_perform(CURL*);
+	static long		__status_curl_easy_getinfo;
+	friend CURLcode		::__wrap_curl_easy_getinfo(CURL*, CURLINFO, ...);
 	friend void		::__wrap_curl_easy_cleanup(CURL*);
 	static const char*	__retval_curl_easy_strerror;
 	friend const char*	::__wrap_curl_easy_strerror(CURLcode);
@@ -140,7 +155,26 @@ class BrokerFiwareTest: public TestFixture
 	void callback_skips_request_if_curl_initialization_fails();
 	void callback_skips_request_if_curl_perform_fails();
 	void callback_sends_request_if_curl_perform_succeeds();
+	void callback_sends_request_if_entity_type_is_not_first_custom_variable();
 	void callback_sends_request_with_corr_and_content_type_headers();
+	void callback_reuses_curl_handle_in_subsequent_requests();
+	void callback_reopens_curl_handle_if_curl_perform_fails();
+	void callback_skips_requests_after_consecutive_failures();
+	void callback_skips_requests_after_consecutive_server_errors();
+	void callback_reuses_cached_route_once_event_loop_starts();
+	void callback_forgets_cached_route_after_change_command();
+	void callback_keeps_cached_route_after_unrelated_change_command();
+	void callback_keeps_cached_route_after_change_command_of_other_service();
+	void callback_skips_request_of_service_ignored_once_event_loop_starts();
+	void callback_skips_request_of_excluded_service();
+	void callback_uses_route_computed_when_event_loop_starts();
+	void callback_streams_whole_body_including_long_output();
+	void callback_streams_whole_body_again_after_rewind();
+	void callback_does_not_cache_route_of_command_with_volatile_macros();
+	void check_command_is_static_unless_volatile_macros_referenced();
+	void request_for_ge_follows_default_entity_id_template();
+	void request_for_ge_follows_entity_id_template_arg();
+	void request_for_ge_encodes_host_name_and_service_description();
 
 public:
 	static void suiteSetUp();
@@ -159,7 +193,26 @@ public:
 	CPPUNIT_TEST(callback_skips_request_if_curl_initialization_fails);
 	CPPUNIT_TEST(callback_skips_request_if_curl_perform_fails);
 	CPPUNIT_TEST(callback_sends_request_if_curl_perform_succeeds);
+	CPPUNIT_TEST(callback_sends_request_if_entity_type_is_not_first_custom_variable);
 	CPPUNIT_TEST(callback_sends_request_with_corr_and_content_type_headers);
+	CPPUNIT_TEST(callback_reuses_curl_handle_in_subsequent_requests);
+	CPPUNIT_TEST(callback_reopens_curl_handle_if_curl_perform_fails);
+	CPPUNIT_TEST(callback_skips_requests_after_consecutive_failures);
+	CPPUNIT_TEST(callback_skips_requests_after_consecutive_server_errors);
+	CPPUNIT_TEST(callback_reuses_cached_route_once_event_loop_starts);
+	CPPUNIT_TEST(callback_forgets_cached_route_after_change_command);
+	CPPUNIT_TEST(callback_keeps_cached_route_after_unrelated_change_command);
+	CPPUNIT_TEST(callback_keeps_cached_route_after_change_command_of_other_service);
+	CPPUNIT_TEST(callback_skips_request_of_service_ignored_once_event_loop_starts);
+	CPPUNIT_TEST(callback_skips_request_of_excluded_service);
+	CPPUNIT_TEST(callback_uses_route_computed_when_event_loop_starts);
+	CPPUNIT_TEST(callback_streams_whole_body_including_long_output);
+	CPPUNIT_TEST(callback_streams_whole_body_again_after_rewind);
+	CPPUNIT_TEST(callback_does_not_cache_route_of_command_with_volatile_macros);
+	CPPUNIT_TEST(check_command_is_static_unless_volatile_macros_referenced);
+	CPPUNIT_TEST(request_for_ge_follows_default_entity_id_template);
+	CPPUNIT_TEST(request_for_ge_follows_entity_id_template_arg);
+	CPPUNIT_TEST(request_for_ge_encodes_host_name_and_service_description);
 	CPPUNIT_TEST_SUITE_END();
 };
 
@@ -348,6 +401,10 @@ void __wrap_curl_global_cleanup(void)
 }
 
 
+/// Hit counter for ::__wrap_curl_easy_init
+size_t BrokerFiwareTest::__hitcnt_curl_easy_init = 0;
+
+
 /// Return value from ::__wrap_curl_easy_init
 CURL* BrokerFiwareTest::__retval_curl_easy_init = NULL;
 
@@ -355,6 +412,9 @@ CURL* BrokerFiwareTest::__retval_curl_easy_init = NULL;
 /// Mock for ::curl_easy_init
 CURL* __wrap_curl_easy_init(void)
 {
+	if (BrokerFiwareTest::__retval_curl_easy_init != NULL) {
+		++BrokerFiwareTest::__hitcnt_curl_easy_init;
+	}
 	return BrokerFiwareTest::__retval_curl_easy_init;
 }
 
@@ -364,6 +424,26 @@ CURL* __wrap_curl_easy_init(void)
 bool BrokerFiwareTest::__header_curl_easy_setopt = false;
 
 
+/// Read callback given to ::__wrap_curl_easy_setopt (body streamed if not null)
+curl_read_callback BrokerFiwareTest::__readfn_curl_easy_setopt = NULL;
+
+
+/// Read callback data given to ::__wrap_curl_easy_setopt
+void* BrokerFiwareTest::__readdata_curl_easy_setopt = NULL;
+
+
+/// Seek callback given to ::__wrap_curl_easy_setopt (body rewindable if not null)
+curl_seek_callback BrokerFiwareTest::__seekfn_curl_easy_setopt = NULL;
+
+
+/// Seek callback data given to ::__wrap_curl_easy_setopt
+void* BrokerFiwareTest::__seekdata_curl_easy_setopt = NULL;
+
+
+/// Body size given to ::__wrap_curl_easy_setopt
+long BrokerFiwareTest::__postsize_curl_easy_setopt = 0;
+
+
 /// Return value from ::__wrap_curl_easy_setopt
 CURLcode BrokerFiwareTest::__retval_curl_easy_setopt = CURLE_OK;
 
@@ -371,6 +451,33 @@ CURLcode BrokerFiwareTest::__retval_curl_easy_setopt = CURLE_OK;
 /// Mock for ::curl_easy_setopt
 CURLcode __wrap_curl_easy_setopt(CURL* handle, CURLoption option, ...)
 {
+	if (option == CURLOPT_READFUNCTION) {
+		va_list ap;
+		va_start(ap, option);
+		BrokerFiwareTest::__readfn_curl_easy_setopt = va_arg(ap, curl_read_callback);
+		va_end(ap);
+	} else if (option == CURLOPT_READDATA) {
+		va_list ap;
+		va_start(ap, option);
+		BrokerFiwareTest::__readdata_curl_easy_setopt = va_arg(ap, void*);
+		va_end(ap);
+	} else if (option == CURLOPT_SEEKFUNCTION) {
+		va_list ap;
+		va_start(ap, option);
+		BrokerFiwareTest::__seekfn_curl_easy_setopt = va_arg(ap, curl_seek_callback);
+		va_end(ap);
+	} else if (option == CURLOPT_SEEKDATA) {
+		va_list ap;
+		va_start(ap, option);
+		BrokerFiwareTest::__seekdata_curl_easy_setopt = va_arg(ap, void*);
+		va_end(ap);
+	} else if (option == CURLOPT_POSTFIELDSIZE) {
+		va_list ap;
+		va_start(ap, option);
+		BrokerFiwareTest::__postsize_curl_easy_setopt = va_arg(ap, long);
+		va_end(ap);
+	}
+
 	if ((BrokerFiwareTest::__retval_curl_easy_setopt == CURLE_OK) && (option == CURLOPT_HTTPHEADER)) {
 		bool		has_corr = false;
 		bool		has_type = false;
@@ -400,6 +507,14 @@ CURLcode __wrap_curl_easy_setopt(CURL* handle, CURLoption option, ...)
 size_t BrokerFiwareTest::__hitcnt_curl_easy_perform = 0;
 
 
+/// Body read by ::__wrap_curl_easy_perform (in small pieces) from the read callback, if any
+string BrokerFiwareTest::__body_curl_easy_perform;
+
+
+/// Whether ::__wrap_curl_easy_perform rewinds the body after reading its first piece (as if connection were lost)
+bool BrokerFiwareTest::__rewind_curl_easy_perform = false;
+
+
 /// Return value from ::__wrap_curl_easy_perform
 CURLcode BrokerFiwareTest::__retval_curl_easy_perform = CURLE_OK;
 
@@ -410,10 +525,46 @@ CURLcode __wrap_curl_easy_perform(CURL* handle)
 	if (BrokerFiwareTest::__retval_curl_easy_perform == CURLE_OK) {
 		++BrokerFiwareTest::__hitcnt_curl_easy_perform;
 	}
+	if (BrokerFiwareTest::__readfn_curl_easy_setopt != NULL) {
+		char	buffer[7];
+		size_t	length;
+		BrokerFiwareTest::__body_curl_easy_perform.clear();
+		if (BrokerFiwareTest::__rewind_curl_easy_perform) {
+			BrokerFiwareTest::__readfn_curl_easy_setopt(buffer, 1, sizeof(buffer),
+			                                            BrokerFiwareTest::__readdata_curl_easy_setopt);
+			if ((BrokerFiwareTest::__seekfn_curl_easy_setopt == NULL)
+			    || (BrokerFiwareTest::__seekfn_curl_easy_setopt(BrokerFiwareTest::__seekdata_curl_easy_setopt,
+			                                                   0, SEEK_SET) != CURL_SEEKFUNC_OK)) {
+				return CURLE_SEND_FAIL_REWIND;
+			}
+		}
+		while ((length = BrokerFiwareTest::__readfn_curl_easy_setopt(buffer, 1, sizeof(buffer),
+		                 BrokerFiwareTest::__readdata_curl_easy_setopt)) > 0) {
+			BrokerFiwareTest::__body_curl_easy_perform.append(buffer, length);
+		}
+	}
 	return BrokerFiwareTest::__retval_curl_easy_perform;
 }
 
 
+/// HTTP status returned by ::__wrap_curl_easy_getinfo
+long BrokerFiwareTest::__status_curl_easy_getinfo = 200;
+
+
+/// Mock for ::curl_easy_getinfo (only HTTP status is available)
+CURLcode __wrap_curl_easy_getinfo(CURL* handle, CURLINFO info, ...)
+{
+	if (info != CURLINFO_RESPONSE_CODE) {
+		return CURLE_FAILED_INIT;
+	}
+	va_list ap;
+	va_start(ap, info);
+	*va_arg(ap, long*) = BrokerFiwareTest::__status_curl_easy_getinfo;
+	va_end(ap);
+	return CURLE_OK;
+}
+
+
 /// Mock for ::curl_easy_cleanup
 void __wrap_curl_easy_cleanup(CURL* handle)
 {
@@ -468,16 +619,9 @@ int BrokerFiwareTest::nebmodule_deinit(int flags, int reason)
 ///
 void BrokerFiwareTest::suiteSetUp()
 {
-	// Setup broker arguments
-	string argline	= ((ostringstream&)(ostringstream().flush()
-		<<        "-u" << ADAPTER_URL
-		<< ' ' << "-r" << REGION_ID
-		)).str();
-
 	::adapter_url	= NULL;
 	::region_id	= NULL;
 	::host_addr	= NULL;
-	nebmodule_init(0, argline, MODULE_HANDLE);
 }
 
 
@@ -495,6 +639,13 @@ void BrokerFiwareTest::suiteTearDown()
 ///
 void BrokerFiwareTest::setUp()
 {
+	// Setup broker arguments (module is deinitialized after every test)
+	string argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << ADAPTER_URL
+		<< ' ' << "-r" << REGION_ID
+		)).str();
+
+	nebmodule_init(0, argline, MODULE_HANDLE);
 }
 
 
@@ -520,9 +671,18 @@ void BrokerFiwareTest::tearDown()
 	__retval_curl_easy_init			= NULL;
 	__retval_curl_easy_setopt		= CURLE_OK;
 	__retval_curl_easy_perform		= CURLE_OK;
+	__status_curl_easy_getinfo		= 200;
 	__retval_curl_easy_strerror		= NULL;
 	__header_curl_easy_setopt		= false;
+	__readfn_curl_easy_setopt		= NULL;
+	__readdata_curl_easy_setopt		= NULL;
+	__seekfn_curl_easy_setopt		= NULL;
+	__seekdata_curl_easy_setopt		= NULL;
+	__rewind_curl_easy_perform		= false;
+	__postsize_curl_easy_setopt		= 0;
+	__body_curl_easy_perform.clear();
 	__hitcnt_curl_easy_perform		= 0;
+	__hitcnt_curl_easy_init			= 0;
 }
 
 
@@ -636,6 +796,7 @@ void BrokerFiwareTest::callback_skips_request_if_cannot_find_command_arguments()
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__retval_find_command			= &check_command;
 	__retval_find_service			= &check_service;
@@ -671,6 +832,7 @@ void BrokerFiwareTest::callback_skips_request_if_cannot_find_custom_variables()
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -712,6 +874,7 @@ void BrokerFiwareTest::callback_skips_request_if_cannot_find_custom_variable_ent
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -753,6 +916,7 @@ void BrokerFiwareTest::callback_skips_request_if_unknown_entity_type()
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -794,6 +958,7 @@ void BrokerFiwareTest::callback_skips_request_if_curl_initialization_fails()
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -836,6 +1001,7 @@ void BrokerFiwareTest::callback_skips_request_if_curl_perform_fails()
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -879,6 +1045,7 @@ void BrokerFiwareTest::callback_sends_request_if_curl_perform_succeeds()
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -899,6 +1066,55 @@ void BrokerFiwareTest::callback_sends_request_if_curl_perform_succeeds()
 }
 
 
+void BrokerFiwareTest::callback_sends_request_if_entity_type_is_not_first_custom_variable()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars[2];
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars[1] = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_vars[0] = {
+		variable_name:			"OTHER",
+		variable_value:			"other",
+		has_been_modified:		0,
+		next:				&check_vars[1]
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars[0];
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 1;	// entity type found despite its position
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+	CPPUNIT_ASSERT(!::is_service_ignored(&check_service));
+}
+
+
 void BrokerFiwareTest::callback_sends_request_with_corr_and_content_type_headers()
 {
 	host					check_host;
@@ -922,6 +1138,7 @@ void BrokerFiwareTest::callback_sends_request_with_corr_and_content_type_headers
 	check_data.service_description		= check_service.description;
 	check_data.output			= SOME_CHECK_OUTPUT_DATA;
 	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
 	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
 	__output_get_raw_command_line_r		= check_command.command_line;
 	__output_process_macros_r		= check_command.command_line;
@@ -942,3 +1159,772 @@ void BrokerFiwareTest::callback_sends_request_with_corr_and_content_type_headers
 	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
 	CPPUNIT_ASSERT_EQUAL(BrokerFiwareTest::__header_curl_easy_setopt, true);
 }
+
+
+void BrokerFiwareTest::callback_reuses_curl_handle_in_subsequent_requests()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_init_hitcnt	= 1;	// same handle (and connection) is reused
+	size_t expected_curl_perform_hitcnt	= 2;
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_init_hitcnt == __hitcnt_curl_easy_init);
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_reopens_curl_handle_if_curl_perform_fails()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_COULDNT_CONNECT;
+	size_t expected_curl_init_hitcnt	= 2;	// handle is discarded after failure
+	size_t expected_curl_perform_hitcnt	= 1;
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	__retval_curl_easy_perform		= CURLE_OK;
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_init_hitcnt == __hitcnt_curl_easy_init);
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_skips_requests_after_consecutive_failures()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_COULDNT_CONNECT;
+	::breaker_threshold			= 2;
+	::breaker_wait				= 60000;
+	size_t expected_curl_init_hitcnt	= 2;	// third request is skipped
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_init_hitcnt == __hitcnt_curl_easy_init);
+}
+
+
+void BrokerFiwareTest::callback_skips_requests_after_consecutive_server_errors()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	__status_curl_easy_getinfo		= 503;
+	::breaker_threshold			= 2;
+	::breaker_wait				= 60000;
+	size_t expected_curl_perform_hitcnt	= 2;	// third request is skipped
+	size_t expected_curl_init_hitcnt	= 1;	// session is kept
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+	CPPUNIT_ASSERT(expected_curl_init_hitcnt == __hitcnt_curl_easy_init);
+}
+
+
+void BrokerFiwareTest::callback_reuses_cached_route_once_event_loop_starts()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 2;	// second request uses cached route
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	__retval_find_host			= NULL;	// route no longer computable
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_forgets_cached_route_after_change_command()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+	nebstruct_external_command_data		command_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	command_data.type			= NEBTYPE_EXTERNALCOMMAND_END;
+	command_data.command_string		= (char*) "CHANGE_CUSTOM_SVC_VAR";
+	command_data.command_args		= (char*) REMOTEHOST_ADDR ";" SOME_DESCRIPTION ";" CUSTOM_VAR_ENTITY_TYPE ";x";
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 1;	// second request skipped (route is computed again)
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	__retval_find_host			= NULL;	// route no longer computable
+
+	// when
+	::callback_external_command(NEBCALLBACK_EXTERNAL_COMMAND_DATA, &command_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_keeps_cached_route_after_unrelated_change_command()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+	nebstruct_external_command_data		command_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	command_data.type			= NEBTYPE_EXTERNALCOMMAND_END;
+	command_data.command_string		= (char*) "CHANGE_SVC_CHECK_INTERVAL";
+	command_data.command_args		= (char*) REMOTEHOST_ADDR ";" SOME_DESCRIPTION ";10";
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 2;	// second request uses cached route
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	__retval_find_host			= NULL;	// route no longer computable
+
+	// when
+	::callback_external_command(NEBCALLBACK_EXTERNAL_COMMAND_DATA, &command_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_keeps_cached_route_after_change_command_of_other_service()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+	nebstruct_external_command_data		command_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	command_data.type			= NEBTYPE_EXTERNALCOMMAND_END;
+	command_data.command_string		= (char*) "CHANGE_SVC_CHECK_COMMAND";
+	command_data.command_args		= (char*) REMOTEHOST_ADDR ";other_service;" SOME_CHECK_NAME;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 2;	// second request uses cached route
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	__retval_find_host			= NULL;	// route no longer computable
+
+	// when
+	::callback_external_command(NEBCALLBACK_EXTERNAL_COMMAND_DATA, &command_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_skips_request_of_service_ignored_once_event_loop_starts()
+{
+	host					check_host;
+	service					check_service, defined_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	defined_service				= check_service;
+	defined_service.custom_variables	= NULL;	// no entity type when event loop started
+	defined_service.next			= NULL;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 0;
+	::service_list				= &defined_service;
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::service_list				= NULL;
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_skips_request_of_excluded_service()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 0;
+	::exclude_pattern			= (regex_t*) malloc(sizeof(regex_t));
+	regcomp(::exclude_pattern, "^" SOME_DESCRIPTION "$", REG_EXTENDED | REG_NOSUB);
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_does_not_cache_route_of_command_with_volatile_macros()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " -s $SERVICESTATE$ $ARG1$";
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 1;	// second request requires expanding command again
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+	__retval_find_host			= NULL;	// route no longer computable
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::check_command_is_static_unless_volatile_macros_referenced()
+{
+	service					check_service;
+	command					check_command;
+
+	// given
+	check_service.service_check_command	= SOME_CHECK_NAME "!$HOSTADDRESS$!$$!$_HOSTPORT$";
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "$USER1$/" SOME_CHECK_NAME " -H $ARG1$ -p $ARG3$";
+	__retval_find_command			= &check_command;
+
+	// when
+	bool static_command = ::is_check_command_static(&check_service);
+	check_service.service_check_command	= SOME_CHECK_NAME "!$HOSTADDRESS$!$LONGDATETIME$";
+	bool volatile_args = !::is_check_command_static(&check_service);
+	check_service.service_check_command	= SOME_CHECK_NAME "!$HOSTADDRESS:other$";
+	bool ondemand_args = !::is_check_command_static(&check_service);
+
+	// then
+	CPPUNIT_ASSERT(static_command);
+	CPPUNIT_ASSERT(volatile_args);
+	CPPUNIT_ASSERT(ondemand_args);
+}
+
+
+void BrokerFiwareTest::callback_uses_route_computed_when_event_loop_starts()
+{
+	host					check_host;
+	service					check_service, defined_services[100];
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+	nebstruct_process_data			process_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	for (size_t i = 0; i < 100; i++) {	// routes computed by several threads
+		defined_services[i]		= check_service;
+		defined_services[i].next	= (i < 99) ? &defined_services[i+1] : NULL;
+	}
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= SOME_CHECK_PERF_DATA;
+	check_data.long_output			= NULL;
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	size_t expected_curl_perform_hitcnt	= 1;	// request uses route computed in advance
+	::service_list				= &defined_services[0];
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::service_list				= NULL;
+	__retval_find_host			= NULL;	// route no longer computable
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(expected_curl_perform_hitcnt == __hitcnt_curl_easy_perform);
+}
+
+
+void BrokerFiwareTest::callback_streams_whole_body_including_long_output()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_vars = {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	string perf_data(2 * MAXBUFLEN, 'x');	// longer than any former fixed-size buffer
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= (char*) perf_data.c_str();
+	check_data.long_output			= (char*) "/ 10%\\n\\n/var 20%\\\\\\n";	// escaped by Nagios
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	string expected_body			= string(SOME_CHECK_OUTPUT_DATA) + "|" + perf_data
+						  + "\n/ 10%\n/var 20%\\";	// no empty nor trailing lines
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(__readfn_curl_easy_setopt != NULL);
+	CPPUNIT_ASSERT_EQUAL(expected_body, __body_curl_easy_perform);
+	CPPUNIT_ASSERT_EQUAL((long) expected_body.size(), __postsize_curl_easy_setopt);
+}
+
+
+void BrokerFiwareTest::callback_streams_whole_body_again_after_rewind()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	customvariablesmember			check_vars;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_host.name				= REMOTEHOST_ADDR;
+	check_vars = (customvariablesmember) {
+		variable_name:			CUSTOM_VAR_ENTITY_TYPE,
+		variable_value:			GE_ENTITY_TYPE
+	};
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME "!" SOME_CHECK_ARGS;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= &check_vars;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	check_data.output			= SOME_CHECK_OUTPUT_DATA;
+	check_data.perf_data			= NULL;
+	check_data.long_output			= (char*) "/ 10%\\n/var 20%";
+	check_data.type				= NEBTYPE_SERVICECHECK_PROCESSED;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= check_command.command_line;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__retval_curl_easy_init			= CURL_HANDLE;
+	__retval_curl_easy_perform		= CURLE_OK;
+	__rewind_curl_easy_perform		= true;
+	string expected_body			= string(SOME_CHECK_OUTPUT_DATA) + "|\n/ 10%\n/var 20%";
+
+	// when
+	::callback_service_check(NEBCALLBACK_SERVICE_CHECK_DATA, &check_data);
+
+	// then
+	CPPUNIT_ASSERT(__seekfn_curl_easy_setopt != NULL);
+	CPPUNIT_ASSERT_EQUAL(expected_body, __body_curl_easy_perform);
+	CPPUNIT_ASSERT(__hitcnt_curl_easy_perform == 1);
+}
+
+
+void BrokerFiwareTest::request_for_ge_follows_default_entity_id_template()
+{
+	service					check_service;
+
+	// given
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.description		= SOME_DESCRIPTION;
+	string expected_request			= ADAPTER_URL "/" SOME_CHECK_NAME
+						  "?id=" REGION_ID ":" REMOTEHOST_ADDR ":" SOME_DESCRIPTION
+						  "&type=" GE_ENTITY_TYPE;
+
+	// when
+	char* request = ::get_adapter_request_for_ge(NULL, SOME_CHECK_NAME, "", GE_ENTITY_TYPE, &check_service);
+
+	// then
+	CPPUNIT_ASSERT(request != NULL);
+	CPPUNIT_ASSERT_EQUAL(expected_request, string(request));
+	free(request);
+}
+
+
+void BrokerFiwareTest::request_for_ge_follows_entity_id_template_arg()
+{
+	service					check_service;
+
+	// given
+	string argline	= ((ostringstream&)(ostringstream().flush()
+		<<        "-u" << ADAPTER_URL
+		<< ' ' << "-r" << REGION_ID
+		<< ' ' << "-T" << "{service}@{host_name}"
+		)).str();
+	nebmodule_deinit(0, NEBMODULE_NEB_SHUTDOWN);
+	nebmodule_init(0, argline, MODULE_HANDLE);
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.description		= SOME_DESCRIPTION;
+	string expected_request			= ADAPTER_URL "/" SOME_CHECK_NAME
+						  "?id=" SOME_DESCRIPTION "@" REMOTEHOST_ADDR
+						  "&type=" GE_ENTITY_TYPE;
+
+	// when
+	char* request = ::get_adapter_request_for_ge(NULL, SOME_CHECK_NAME, "", GE_ENTITY_TYPE, &check_service);
+
+	// then
+	CPPUNIT_ASSERT(request != NULL);
+	CPPUNIT_ASSERT_EQUAL(expected_request, string(request));
+	free(request);
+}
+
+
+void BrokerFiwareTest::request_for_ge_encodes_host_name_and_service_description()
+{
+	service					check_service;
+
+	// given
+	check_service.host_name			= "web#1";
+	check_service.description		= "HTTP & HTTPS";
+	string expected_request			= ADAPTER_URL "/" SOME_CHECK_NAME
+						  "?id=" REGION_ID ":web%231:HTTP%20%26%20HTTPS"
+						  "&type=" GE_ENTITY_TYPE;
+
+	// when
+	char* request = ::get_adapter_request_for_ge(NULL, SOME_CHECK_NAME, "", GE_ENTITY_TYPE, &check_service);
+
+	// then
+	CPPUNIT_ASSERT(request != NULL);
+	CPPUNIT_ASSERT_EQUAL(expected_request, string(request));
+	free(request);
+}
@@ -38,6 +38,8 @@
 #include "suite_config.h"
 #include "ngsi_event_broker_common.h"
 #include "ngsi_event_broker_xifi.h"
+#include "nebcallbacks.h"
+#include "broker.h"
 #include "cppunit/TestResult.h"
 #include "cppunit/TestFixture.h"
 #include "cppunit/TextTestRunner.h"
@@ -82,14 +84,24 @@ using namespace std;
 #define SNMP_MIBLIST		"miblist"
 
 
+/// Another address of the remote host, once its resolution changes
+#define REMOTEHOST_NEW_ADDR	"169.254.0.2"
+
+
 /// Some SNMP OID
 #define SNMP_OID		".1.3.6.1.2.1.2.2.1.8." STR(SOME_PORT_PLUS_1)
 
 
+// Nagios list of services
+extern "C" service*	service_list;
+
+
 // Forward declarations for friend members
 extern "C" {
 	int			__wrap_gethostname(char*, size_t);
 	struct hostent*		__wrap_gethostbyname(const char*);
+	int			__wrap_getaddrinfo(const char*, const char*, const struct addrinfo*, struct addrinfo**);
+	void			__wrap_freeaddrinfo(struct addrinfo*);
 	host*			__wrap_find_host(char*);
 	service*		__wrap_find_service(char*, char*);
 	command*		__wrap_find_command(char*);
@@ -106,7 +118,11 @@ class BrokerXifiTest: public TestFixture
 	// mocks: return & output values, and friend declaration to access static members
 	static int		__retval_gethostname;
 	friend int		::__wrap_gethostname(char*, size_t);
+	static size_t		__hitcnt_gethostbyname;
 	friend struct hostent*	::__wrap_gethostbyname(const char*);
+	static const char* volatile __output_getaddrinfo;
+	static size_t		__hitcnt_getaddrinfo;
+	friend int		::__wrap_getaddrinfo(const char*, const char*, const struct addrinfo*, struct addrinfo**);
 	static host*		__retval_find_host;
 	friend host*		::__wrap_find_host(char*);
 	static service*		__retval_find_service;
@@ -141,6 +157,10 @@ class BrokerXifiTest: public TestFixture
 	void DEM_get_request_ok_remote_vm_by_hostname();
 	void DEM_invalid_request_unknown_remote_vm_hostname();
 	void DEM_invalid_request_missing_nrpe_host_argument();
+	void DEM_remote_request_is_not_cacheable();
+	void DEM_local_request_is_cacheable();
+	void DEM_remote_request_follows_changed_resolution_after_ttl();
+	void DEM_remote_requests_computed_when_event_loop_starts_without_dns_cache();
 	void NPM_get_request_ok_local_snmp_plugin_implicit_entity_type();
 	void NPM_get_request_ok_local_snmp_plugin_explicit_entity_type();
 	void NPM_wrong_request_local_snmp_plugin_custom_entity_type();
@@ -168,6 +188,10 @@ public:
 	CPPUNIT_TEST(DEM_get_request_ok_remote_vm_by_hostname);
 	CPPUNIT_TEST(DEM_invalid_request_unknown_remote_vm_hostname);
 	CPPUNIT_TEST(DEM_invalid_request_missing_nrpe_host_argument);
+	CPPUNIT_TEST(DEM_remote_request_is_not_cacheable);
+	CPPUNIT_TEST(DEM_local_request_is_cacheable);
+	CPPUNIT_TEST(DEM_remote_request_follows_changed_resolution_after_ttl);
+	CPPUNIT_TEST(DEM_remote_requests_computed_when_event_loop_starts_without_dns_cache);
 	CPPUNIT_TEST(NPM_get_request_ok_local_snmp_plugin_implicit_entity_type);
 	CPPUNIT_TEST(NPM_get_request_ok_local_snmp_plugin_explicit_entity_type);
 	CPPUNIT_TEST(NPM_wrong_request_local_snmp_plugin_custom_entity_type);
@@ -211,6 +235,10 @@ int __wrap_gethostname(char* name, size_t len)
 }
 
 
+/// Hit counter for ::__wrap_gethostbyname
+size_t BrokerXifiTest::__hitcnt_gethostbyname = 0;
+
+
 /// Mock for ::gethostbyname
 struct hostent* __wrap_gethostbyname(const char* name)
 {
@@ -221,6 +249,7 @@ struct hostent* __wrap_gethostbyname(const char* name)
 	string			hostname(name);
 	const char*		hostaddr;
 
+	__atomic_add_fetch(&BrokerXifiTest::__hitcnt_gethostbyname, 1, __ATOMIC_RELAXED);
 	if (hostname == LOCALHOST_NAME || hostname == LOCALHOST_ADDR) {
 		hostaddr = LOCALHOST_ADDR;
 	} else if (hostname == REMOTEHOST_NAME || hostname == REMOTEHOST_ADDR) {
@@ -235,6 +264,54 @@ struct hostent* __wrap_gethostbyname(const char* name)
 }
 
 
+/// Address of the remote host resolved by ::__wrap_getaddrinfo
+const char* volatile BrokerXifiTest::__output_getaddrinfo = REMOTEHOST_ADDR;
+
+
+/// Hit counter for ::__wrap_getaddrinfo
+size_t BrokerXifiTest::__hitcnt_getaddrinfo = 0;
+
+
+/// Mock for ::getaddrinfo (used to resolve remote hosts, maybe from several threads at once)
+int __wrap_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints, struct addrinfo** res)
+{
+	struct {
+		struct addrinfo		info;
+		struct sockaddr_in	addr;
+	}*				result;
+
+	string				hostname(node);
+	const char*			hostaddr;
+
+	__atomic_add_fetch(&BrokerXifiTest::__hitcnt_getaddrinfo, 1, __ATOMIC_RELAXED);
+	if (hostname == LOCALHOST_NAME || hostname == LOCALHOST_ADDR) {
+		hostaddr = LOCALHOST_ADDR;
+	} else if (hostname == REMOTEHOST_NAME) {
+		hostaddr = BrokerXifiTest::__output_getaddrinfo;
+	} else if (hostname == REMOTEHOST_ADDR) {
+		hostaddr = REMOTEHOST_ADDR;
+	} else {
+		return EAI_NONAME;
+	}
+
+	result = (typeof(result)) calloc(1, sizeof(*result));
+	result->addr.sin_family = AF_INET;
+	inet_pton(AF_INET, hostaddr, &result->addr.sin_addr);
+	result->info.ai_family  = AF_INET;
+	result->info.ai_addr    = (struct sockaddr*) &result->addr;
+	result->info.ai_addrlen = sizeof(result->addr);
+	*res = &result->info;
+	return 0;
+}
+
+
+/// Mock for ::freeaddrinfo (releases results of ::__wrap_getaddrinfo)
+void __wrap_freeaddrinfo(struct addrinfo* res)
+{
+	free(res);
+}
+
+
 /// Return value from ::__wrap_find_host
 host* BrokerXifiTest::__retval_find_host = NULL;
 
@@ -417,6 +494,8 @@ void BrokerXifiTest::setUp()
 void BrokerXifiTest::tearDown()
 {
 	__retval_gethostname			= EXIT_SUCCESS;
+	__hitcnt_gethostbyname			= 0;
+	__hitcnt_getaddrinfo			= 0;
 	__retval_find_host			= NULL;
 	__retval_find_service			= NULL;
 	__retval_find_command			= NULL;
@@ -896,6 +975,162 @@ void BrokerXifiTest::DEM_invalid_request_missing_nrpe_host_argument()
 }
 
 
+void BrokerXifiTest::DEM_remote_request_is_not_cacheable()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	nebstruct_service_check_data		check_data;
+	context_t				context = { NULL };
+
+	// given
+	check_service.host_name			= REMOTEHOST_ADDR;
+	check_service.service_check_command	= NRPE_PLUGIN "!" SOME_CHECK_NAME;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= NULL;
+	check_command.name			= NRPE_PLUGIN;
+	check_command.command_line		= "$USER1$/" NRPE_PLUGIN " -H $HOSTADDRESS$ -c $ARG1$";
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= "/usr/bin/" NRPE_PLUGIN " -H " REMOTEHOST_NAME " -c arguments";
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+
+	// when
+	char* actual_request = ::get_adapter_request(&check_data, &context);
+
+	// then
+	CPPUNIT_ASSERT(actual_request != ADAPTER_REQUEST_INVALID);
+	CPPUNIT_ASSERT(context.uncacheable);	// remote address is resolved again on every check
+	::free(actual_request);
+}
+
+
+void BrokerXifiTest::DEM_local_request_is_cacheable()
+{
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	nebstruct_service_check_data		check_data;
+	context_t				context = { NULL };
+
+	// given
+	check_service.host_name			= LOCALHOST_ADDR;
+	check_service.service_check_command	= SOME_CHECK_NAME;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= NULL;
+	check_command.name			= SOME_CHECK_NAME;
+	check_command.command_line		= "$USER1$/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= "/usr/bin/" SOME_CHECK_NAME " " SOME_CHECK_ARGS;
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+
+	// when
+	char* actual_request = ::get_adapter_request(&check_data, &context);
+
+	// then
+	CPPUNIT_ASSERT(actual_request != ADAPTER_REQUEST_INVALID);
+	CPPUNIT_ASSERT(!context.uncacheable);
+	::free(actual_request);
+}
+
+
+void BrokerXifiTest::DEM_remote_request_follows_changed_resolution_after_ttl()
+{
+	string					first_request, cached_request, refreshed_request;
+	host					check_host;
+	service					check_service;
+	command					check_command;
+	nebstruct_service_check_data		check_data;
+
+	// given
+	check_service.host_name			= REMOTEHOST_NAME;
+	check_service.service_check_command	= NRPE_PLUGIN "!" SOME_CHECK_NAME;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= NULL;
+	check_command.name			= NRPE_PLUGIN;
+	check_command.command_line		= "$USER1$/" NRPE_PLUGIN " -H $HOSTNAME$ -c $ARG1$";
+	check_data.host_name			= check_service.host_name;
+	check_data.service_description		= check_service.description;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= "/usr/bin/" NRPE_PLUGIN " -H " REMOTEHOST_NAME " -c arguments";
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	__output_getaddrinfo			= REMOTEHOST_ADDR;
+	::dns_ttl				= 1;	// seconds
+	::dns_negative_ttl			= 1;
+	init_remote_address_cache(NULL);
+
+	// when
+	get_adapter_request(&check_data, first_request);
+	__output_getaddrinfo			= REMOTEHOST_NEW_ADDR;
+	get_adapter_request(&check_data, cached_request);
+	usleep(1100000);			// TTL expires: next lookup refreshes the address in background
+	for (int retries = 20; retries > 0; retries--, usleep(100000)) {
+		get_adapter_request(&check_data, refreshed_request);
+		if (refreshed_request.find(REMOTEHOST_NEW_ADDR) != string::npos) break;
+	}
+	free_remote_address_cache(NULL);
+	::dns_ttl				= DEFAULT_DNS_TTL;
+	::dns_negative_ttl			= DEFAULT_DNS_NEGATIVE_TTL;
+	__output_getaddrinfo			= REMOTEHOST_ADDR;
+
+	// then
+	CPPUNIT_ASSERT(first_request.find(":" REMOTEHOST_ADDR "&") != string::npos);
+	CPPUNIT_ASSERT(cached_request.find(":" REMOTEHOST_ADDR "&") != string::npos);
+	CPPUNIT_ASSERT(refreshed_request.find(":" REMOTEHOST_NEW_ADDR "&") != string::npos);
+}
+
+
+void BrokerXifiTest::DEM_remote_requests_computed_when_event_loop_starts_without_dns_cache()
+{
+	host					check_host;
+	service					check_service, defined_services[100];
+	command					check_command;
+	nebstruct_process_data			process_data;
+
+	// given
+	check_service.host_name			= REMOTEHOST_NAME;
+	check_service.service_check_command	= NRPE_PLUGIN "!" SOME_CHECK_NAME;
+	check_service.description		= SOME_DESCRIPTION;
+	check_service.custom_variables		= NULL;
+	for (size_t i = 0; i < 100; i++) {	// routes computed by several threads
+		defined_services[i]		= check_service;
+		defined_services[i].next	= (i < 99) ? &defined_services[i+1] : NULL;
+	}
+	check_command.name			= NRPE_PLUGIN;
+	check_command.command_line		= "$USER1$/" NRPE_PLUGIN " -H $HOSTNAME$ -c $ARG1$";
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPSTART;
+	__output_get_raw_command_line_r		= check_command.command_line;
+	__output_process_macros_r		= "/usr/bin/" NRPE_PLUGIN " -H " REMOTEHOST_NAME " -c arguments";
+	__retval_find_command			= &check_command;
+	__retval_find_service			= &check_service;
+	__retval_find_host			= &check_host;
+	::dns_ttl				= 0;	// option `-D 0`: no cache of remote addresses
+	init_remote_address_cache(NULL);
+
+	// when
+	::service_list				= &defined_services[0];
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	::service_list				= NULL;
+	process_data.type			= NEBTYPE_PROCESS_EVENTLOOPEND;
+	::callback_process(NEBCALLBACK_PROCESS_DATA, &process_data);
+	free_remote_address_cache(NULL);
+	::dns_ttl				= DEFAULT_DNS_TTL;
+
+	// then
+	CPPUNIT_ASSERT_EQUAL((size_t) 100, __hitcnt_getaddrinfo);	// every remote host resolved (reentrant)
+	CPPUNIT_ASSERT_EQUAL((size_t) 0, __hitcnt_gethostbyname);	// not resolved by non-reentrant function
+}
+
+
 void BrokerXifiTest::NPM_get_request_ok_local_snmp_plugin_implicit_entity_type()
 {
 	string					request;
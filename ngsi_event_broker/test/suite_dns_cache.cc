@@ -0,0 +1,297 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_dns_cache.cc
+ * @brief  Test suite to verify the cache of hostname resolutions
+ *
+ * This file defines unit tests to verify the cache used to keep the addresses
+ * of remote hosts checked via NRPE (see dns_cache.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "dns_cache.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// DNS cache test suite
+class DnsCacheTest: public TestFixture
+{
+	// tests
+	void resolve_queries_dns_once_while_not_expired();
+	void resolve_fails_while_failure_not_expired();
+	void resolve_returns_last_address_while_refreshing();
+	void resolve_fails_when_buffer_too_short();
+	void watch_notifies_refreshes_without_lookups();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(DnsCacheTest);
+	CPPUNIT_TEST(resolve_queries_dns_once_while_not_expired);
+	CPPUNIT_TEST(resolve_fails_while_failure_not_expired);
+	CPPUNIT_TEST(resolve_returns_last_address_while_refreshing);
+	CPPUNIT_TEST(resolve_fails_when_buffer_too_short);
+	CPPUNIT_TEST(watch_notifies_refreshes_without_lookups);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(DnsCacheTest::suite());
+	DnsCacheTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	DnsCacheTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Some host name
+#define SOME_HOST		"host1"
+
+
+/// Some IP address
+#define SOME_ADDR		"10.0.0.1"
+
+
+/// Other IP address
+#define OTHER_ADDR		"10.0.0.2"
+
+
+/// Some long time to live (milliseconds)
+#define LONG_TTL		60000
+
+
+/// Some short time to live (milliseconds)
+#define SHORT_TTL		50
+
+
+/// Address returned by fake resolver (if empty, resolution fails)
+static string fake_addr;
+
+
+/// Number of calls to fake resolver
+static volatile size_t fake_calls;
+
+
+/// Fake resolver
+static int fake_resolve(const char* hostname, char* addr, size_t addrmaxlen)
+{
+	int result = -1;
+	if (!fake_addr.empty()) {
+		strncpy(addr, fake_addr.c_str(), addrmaxlen);
+		result = 0;
+	}
+	__sync_fetch_and_add(&fake_calls, 1);
+	return result;
+}
+
+
+/// Last address notified to fake listener
+static char notified_addr[16];
+
+
+/// Number of calls to fake listener
+static volatile size_t notified_calls;
+
+
+/// Fake listener
+static void fake_listen(const char* hostname, const char* addr, void* arg)
+{
+	strncpy(notified_addr, addr, sizeof(notified_addr) - 1);
+	__sync_fetch_and_add(&notified_calls, 1);
+}
+
+
+///
+/// Suite setup
+///
+void DnsCacheTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void DnsCacheTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void DnsCacheTest::setUp()
+{
+	fake_addr  = SOME_ADDR;
+	fake_calls = 0;
+	notified_calls = 0;
+	memset(notified_addr, 0, sizeof(notified_addr));
+}
+
+
+///
+/// Tests teardown
+///
+void DnsCacheTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void DnsCacheTest::resolve_queries_dns_once_while_not_expired()
+{
+	char addr[16] = "";
+	dns_cache_stats_t stats;
+
+	// given
+	dns_cache_t* cache = dns_cache_create(LONG_TTL, LONG_TTL, fake_resolve);
+	dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+	fake_addr = OTHER_ADDR;
+
+	// when
+	int result = dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+
+	// then
+	dns_cache_get_stats(cache, &stats);
+	CPPUNIT_ASSERT(result == 0);
+	CPPUNIT_ASSERT(string(addr) == SOME_ADDR);
+	CPPUNIT_ASSERT(fake_calls == 1);
+	CPPUNIT_ASSERT(stats.hits == 1 && stats.misses == 1);
+	dns_cache_free(cache);
+}
+
+
+void DnsCacheTest::resolve_fails_while_failure_not_expired()
+{
+	char addr[16] = "";
+
+	// given
+	fake_addr = "";
+	dns_cache_t* cache = dns_cache_create(LONG_TTL, LONG_TTL, fake_resolve);
+	dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+	fake_addr = SOME_ADDR;
+
+	// when
+	int result = dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+
+	// then
+	CPPUNIT_ASSERT(result == -1);
+	CPPUNIT_ASSERT(fake_calls == 1);
+	dns_cache_free(cache);
+}
+
+
+void DnsCacheTest::resolve_returns_last_address_while_refreshing()
+{
+	char addr[16] = "";
+	dns_cache_stats_t stats;
+
+	// given
+	dns_cache_t* cache = dns_cache_create(0, 0, fake_resolve);	// always expired
+	dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+	fake_addr = OTHER_ADDR;
+
+	// when
+	int result = dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+
+	// then
+	CPPUNIT_ASSERT(result == 0);
+	CPPUNIT_ASSERT(string(addr) == SOME_ADDR);
+	for (size_t i = 0; (i < 100) && (fake_calls < 2); i++) {
+		usleep(10000);	// wait for background refresh
+	}
+	dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+	dns_cache_get_stats(cache, &stats);
+	CPPUNIT_ASSERT(string(addr) == OTHER_ADDR);
+	CPPUNIT_ASSERT(stats.misses == 1 && stats.refreshes >= 1);
+	dns_cache_free(cache);
+}
+
+
+void DnsCacheTest::resolve_fails_when_buffer_too_short()
+{
+	char addr[16] = "";
+
+	// given
+	dns_cache_t* cache = dns_cache_create(LONG_TTL, LONG_TTL, fake_resolve);
+	dns_cache_resolve(cache, SOME_HOST, addr, sizeof(addr));
+
+	// when
+	int result = dns_cache_resolve(cache, SOME_HOST, addr, strlen(SOME_ADDR));
+
+	// then
+	CPPUNIT_ASSERT(result == -1);
+	dns_cache_free(cache);
+}
+
+
+void DnsCacheTest::watch_notifies_refreshes_without_lookups()
+{
+	// given
+	dns_cache_t* cache = dns_cache_create(SHORT_TTL, SHORT_TTL, fake_resolve);
+
+	// when
+	int result = dns_cache_watch(cache, SOME_HOST, fake_listen, NULL);
+	bool notified_first = (notified_calls == 1) && (string(notified_addr) == SOME_ADDR);
+	fake_addr = OTHER_ADDR;
+	for (size_t i = 0; (i < 100) && (notified_calls < 2); i++) {
+		usleep(10000);	// wait for background refresh once expired
+	}
+
+	// then
+	CPPUNIT_ASSERT(result == 0);
+	CPPUNIT_ASSERT(notified_first);
+	CPPUNIT_ASSERT(notified_calls >= 2);
+	CPPUNIT_ASSERT(fake_calls >= 2);
+	dns_cache_free(cache);
+	CPPUNIT_ASSERT(string(notified_addr) == OTHER_ADDR);
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_hash_ring.cc
+ * @brief  Test suite to verify the consistent hashing ring
+ *
+ * This file defines unit tests to verify the ring used to distribute entities
+ * among several NGSI Adapter endpoints (see hash_ring.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "hash_ring.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// Hash ring test suite
+class HashRingTest: public TestFixture
+{
+	// internal methods
+	static vector<size_t> lookup_keys(const hash_ring_t* ring, size_t count);
+
+	// tests
+	void create_fails_with_no_nodes();
+	void lookup_gets_the_only_node_for_any_key();
+	void lookup_gets_same_node_for_same_key();
+	void lookup_distributes_keys_evenly_among_nodes();
+	void lookup_remaps_few_keys_when_adding_a_node();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(HashRingTest);
+	CPPUNIT_TEST(create_fails_with_no_nodes);
+	CPPUNIT_TEST(lookup_gets_the_only_node_for_any_key);
+	CPPUNIT_TEST(lookup_gets_same_node_for_same_key);
+	CPPUNIT_TEST(lookup_distributes_keys_evenly_among_nodes);
+	CPPUNIT_TEST(lookup_remaps_few_keys_when_adding_a_node);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(HashRingTest::suite());
+	HashRingTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	HashRingTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Number of keys looked up in tests
+#define KEY_COUNT		10000
+
+
+/// Some node names
+static const char* NODES[]	= {
+	"http://adapter1:1337",
+	"http://adapter2:1337",
+	"http://adapter3:1337",
+	"http://adapter4:1337",
+	"http://adapter5:1337"
+};
+
+
+///
+/// Looks up a number of keys similar to entity ids
+///
+/// @param[in] ring	The ring.
+/// @param[in] count	The number of keys.
+///
+/// @return		The nodes keys are assigned to.
+///
+vector<size_t> HashRingTest::lookup_keys(const hash_ring_t* ring, size_t count)
+{
+	vector<size_t> result;
+	for (size_t i = 0; i < count; i++) {
+		ostringstream key;
+		key << "region:10.0.0." << i;
+		result.push_back(hash_ring_lookup(ring, key.str().data(), key.str().length()));
+	}
+	return result;
+}
+
+
+///
+/// Suite setup
+///
+void HashRingTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void HashRingTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void HashRingTest::setUp()
+{
+}
+
+
+///
+/// Tests teardown
+///
+void HashRingTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void HashRingTest::create_fails_with_no_nodes()
+{
+	// given
+	size_t count = 0;
+
+	// when
+	hash_ring_t* ring = hash_ring_create(NODES, count, HASH_RING_REPLICAS);
+
+	// then
+	CPPUNIT_ASSERT(ring == NULL);
+}
+
+
+void HashRingTest::lookup_gets_the_only_node_for_any_key()
+{
+	// given
+	hash_ring_t* ring = hash_ring_create(NODES, 1, HASH_RING_REPLICAS);
+
+	// when
+	vector<size_t> nodes = lookup_keys(ring, KEY_COUNT);
+
+	// then
+	CPPUNIT_ASSERT(ring != NULL);
+	CPPUNIT_ASSERT(count(nodes.begin(), nodes.end(), 0) == KEY_COUNT);
+	hash_ring_free(ring);
+}
+
+
+void HashRingTest::lookup_gets_same_node_for_same_key()
+{
+	// given
+	hash_ring_t* ring1 = hash_ring_create(NODES, 4, HASH_RING_REPLICAS);
+	hash_ring_t* ring2 = hash_ring_create(NODES, 4, HASH_RING_REPLICAS);
+
+	// when
+	vector<size_t> nodes1 = lookup_keys(ring1, KEY_COUNT);
+	vector<size_t> nodes2 = lookup_keys(ring2, KEY_COUNT);
+
+	// then
+	CPPUNIT_ASSERT(nodes1 == nodes2);
+	hash_ring_free(ring1);
+	hash_ring_free(ring2);
+}
+
+
+void HashRingTest::lookup_distributes_keys_evenly_among_nodes()
+{
+	// given
+	size_t node_count = 4;
+	hash_ring_t* ring = hash_ring_create(NODES, node_count, HASH_RING_REPLICAS);
+
+	// when
+	vector<size_t> nodes = lookup_keys(ring, KEY_COUNT);
+
+	// then
+	bool even = true;
+	for (size_t i = 0; i < node_count; i++) {
+		size_t share = count(nodes.begin(), nodes.end(), i);
+		even = even && (share > KEY_COUNT / node_count * 3 / 4) && (share < KEY_COUNT / node_count * 5 / 4);
+	}
+	CPPUNIT_ASSERT(even);
+	hash_ring_free(ring);
+}
+
+
+void HashRingTest::lookup_remaps_few_keys_when_adding_a_node()
+{
+	// given
+	size_t node_count = 4;
+	hash_ring_t* ring1 = hash_ring_create(NODES, node_count, HASH_RING_REPLICAS);
+	hash_ring_t* ring2 = hash_ring_create(NODES, node_count + 1, HASH_RING_REPLICAS);
+
+	// when
+	vector<size_t> nodes1 = lookup_keys(ring1, KEY_COUNT);
+	vector<size_t> nodes2 = lookup_keys(ring2, KEY_COUNT);
+
+	// then
+	size_t remapped = 0;
+	bool to_new_node = true;
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (nodes1[i] != nodes2[i]) {
+			remapped++;
+			to_new_node = to_new_node && (nodes2[i] == node_count);
+		}
+	}
+	CPPUNIT_ASSERT(to_new_node);
+	CPPUNIT_ASSERT(remapped < KEY_COUNT * 3 / 10);	// ideally, 1/5 of keys
+	hash_ring_free(ring1);
+	hash_ring_free(ring2);
+}
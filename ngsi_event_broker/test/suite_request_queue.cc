@@ -0,0 +1,282 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_request_queue.cc
+ * @brief  Test suite to verify the bounded lock-free queue
+ *
+ * This file defines unit tests to verify the queue used to hand over requests
+ * to sender threads (see request_queue.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <pthread.h>
+#include "request_queue.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// Some item to be queued
+struct SomeItem
+{
+	long	value;		///< some value
+	char	text[20];	///< some text
+};
+
+
+/// Request queue test suite
+class RequestQueueTest: public TestFixture
+{
+	// internal methods
+	static void* producer(void* queue);
+
+	// tests
+	void create_rounds_capacity_up_to_power_of_two();
+	void create_fails_with_zero_capacity();
+	void pop_fails_when_queue_is_empty();
+	void push_fails_when_queue_is_full();
+	void pop_keeps_fifo_order_of_items();
+	void pop_gets_all_items_pushed_by_concurrent_producers();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(RequestQueueTest);
+	CPPUNIT_TEST(create_rounds_capacity_up_to_power_of_two);
+	CPPUNIT_TEST(create_fails_with_zero_capacity);
+	CPPUNIT_TEST(pop_fails_when_queue_is_empty);
+	CPPUNIT_TEST(push_fails_when_queue_is_full);
+	CPPUNIT_TEST(pop_keeps_fifo_order_of_items);
+	CPPUNIT_TEST(pop_gets_all_items_pushed_by_concurrent_producers);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(RequestQueueTest::suite());
+	RequestQueueTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	RequestQueueTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Number of items pushed by every producer thread
+#define ITEMS_PER_PRODUCER	10000
+
+
+/// Number of producer threads
+#define PRODUCER_COUNT		4
+
+
+///
+/// Producer thread pushing ::ITEMS_PER_PRODUCER items, retrying while queue is full
+///
+/// @param[in] queue	The queue.
+///
+/// @return		NULL.
+///
+void* RequestQueueTest::producer(void* queue)
+{
+	for (long i = 1; i <= ITEMS_PER_PRODUCER; i++) {
+		SomeItem item = { i, "" };
+		while (request_queue_push((request_queue_t*) queue, &item) == -1) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+
+///
+/// Suite setup
+///
+void RequestQueueTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void RequestQueueTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void RequestQueueTest::setUp()
+{
+}
+
+
+///
+/// Tests teardown
+///
+void RequestQueueTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void RequestQueueTest::create_rounds_capacity_up_to_power_of_two()
+{
+	// given
+	size_t capacity = 100;
+
+	// when
+	request_queue_t* queue = request_queue_create(capacity, sizeof(SomeItem));
+
+	// then
+	CPPUNIT_ASSERT(queue != NULL);
+	CPPUNIT_ASSERT(request_queue_capacity(queue) == 128);
+	request_queue_free(queue);
+}
+
+
+void RequestQueueTest::create_fails_with_zero_capacity()
+{
+	// given
+	size_t capacity = 0;
+
+	// when
+	request_queue_t* queue = request_queue_create(capacity, sizeof(SomeItem));
+
+	// then
+	CPPUNIT_ASSERT(queue == NULL);
+}
+
+
+void RequestQueueTest::pop_fails_when_queue_is_empty()
+{
+	SomeItem item;
+
+	// given
+	request_queue_t* queue = request_queue_create(4, sizeof(SomeItem));
+
+	// when
+	int result = request_queue_pop(queue, &item);
+
+	// then
+	CPPUNIT_ASSERT(result == -1);
+	request_queue_free(queue);
+}
+
+
+void RequestQueueTest::push_fails_when_queue_is_full()
+{
+	SomeItem item = { 0, "some_text" };
+
+	// given
+	request_queue_t* queue = request_queue_create(4, sizeof(SomeItem));
+	for (size_t i = 0; i < request_queue_capacity(queue); i++) {
+		request_queue_push(queue, &item);
+	}
+
+	// when
+	int result = request_queue_push(queue, &item);
+
+	// then
+	CPPUNIT_ASSERT(result == -1);
+	request_queue_free(queue);
+}
+
+
+void RequestQueueTest::pop_keeps_fifo_order_of_items()
+{
+	SomeItem item;
+
+	// given
+	request_queue_t* queue = request_queue_create(8, sizeof(SomeItem));
+	for (long i = 0; i < 10; i++) {
+		SomeItem in = { i, "some_text" }, out;
+		request_queue_push(queue, &in);
+		if (i % 2) request_queue_pop(queue, &out);	// keep queue from getting full
+	}
+
+	// when
+	bool in_order = true;
+	for (long expected = 5; request_queue_pop(queue, &item) == 0; expected++) {
+		in_order = in_order && (item.value == expected) && (string(item.text) == "some_text");
+	}
+
+	// then
+	CPPUNIT_ASSERT(in_order);
+	request_queue_free(queue);
+}
+
+
+void RequestQueueTest::pop_gets_all_items_pushed_by_concurrent_producers()
+{
+	SomeItem	item;
+	pthread_t	threads[PRODUCER_COUNT];
+
+	// given
+	request_queue_t* queue = request_queue_create(64, sizeof(SomeItem));
+	for (size_t i = 0; i < PRODUCER_COUNT; i++) {
+		pthread_create(&threads[i], NULL, producer, queue);
+	}
+
+	// when
+	long count = 0, sum = 0;
+	while (count < PRODUCER_COUNT * ITEMS_PER_PRODUCER) {
+		if (request_queue_pop(queue, &item) == 0) {
+			count++;
+			sum += item.value;
+		}
+	}
+	for (size_t i = 0; i < PRODUCER_COUNT; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// then
+	long expected_sum = PRODUCER_COUNT * ((long) ITEMS_PER_PRODUCER * (ITEMS_PER_PRODUCER + 1) / 2);
+	CPPUNIT_ASSERT(sum == expected_sum);
+	CPPUNIT_ASSERT(request_queue_pop(queue, &item) == -1);
+	request_queue_free(queue);
+}
@@ -0,0 +1,369 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_request_spool.cc
+ * @brief  Test suite to verify the disk-backed spool of requests
+ *
+ * This file defines unit tests to verify the spool used to keep requests not
+ * delivered to NGSI Adapter (see request_spool.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include "request_spool.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// Request spool test suite
+class RequestSpoolTest: public TestFixture
+{
+	// internal methods
+	static string peek_record(request_spool_t* spool, uint64_t* seq);
+
+	// tests
+	void open_fails_with_too_small_size();
+	void peek_fails_when_spool_is_empty();
+	void peek_keeps_fifo_order_of_records();
+	void append_discards_oldest_records_when_full();
+	void append_fails_with_record_larger_than_spool();
+	void remove_fails_when_record_already_discarded();
+	void remove_keeps_records_after_wrapping_around();
+	void open_recovers_records_of_previous_run();
+	void open_discards_corrupted_records_of_previous_run();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(RequestSpoolTest);
+	CPPUNIT_TEST(open_fails_with_too_small_size);
+	CPPUNIT_TEST(peek_fails_when_spool_is_empty);
+	CPPUNIT_TEST(peek_keeps_fifo_order_of_records);
+	CPPUNIT_TEST(append_discards_oldest_records_when_full);
+	CPPUNIT_TEST(append_fails_with_record_larger_than_spool);
+	CPPUNIT_TEST(remove_fails_when_record_already_discarded);
+	CPPUNIT_TEST(remove_keeps_records_after_wrapping_around);
+	CPPUNIT_TEST(open_recovers_records_of_previous_run);
+	CPPUNIT_TEST(open_discards_corrupted_records_of_previous_run);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(RequestSpoolTest::suite());
+	RequestSpoolTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	RequestSpoolTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Path of the spool file used in tests
+#define SPOOL_PATH		"suite_request_spool.dat"
+
+
+/// Size of the spool file used in tests
+#define SPOOL_SIZE		REQUEST_SPOOL_MIN_SIZE
+
+
+///
+/// Gets the oldest record of the spool as a string
+///
+/// @param[in]  spool	The spool.
+/// @param[out] seq	The sequence number of the record.
+///
+/// @return		The record (empty if spool is empty).
+///
+string RequestSpoolTest::peek_record(request_spool_t* spool, uint64_t* seq)
+{
+	size_t	length = 0;
+	char*	data   = (char*) request_spool_peek(spool, seq, &length);
+	string	result = (data) ? string(data, length) : string();
+	free(data);
+	return result;
+}
+
+
+///
+/// Suite setup
+///
+void RequestSpoolTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void RequestSpoolTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void RequestSpoolTest::setUp()
+{
+	remove(SPOOL_PATH);
+}
+
+
+///
+/// Tests teardown
+///
+void RequestSpoolTest::tearDown()
+{
+	remove(SPOOL_PATH);
+}
+
+
+///////////////////////////////////
+
+
+void RequestSpoolTest::open_fails_with_too_small_size()
+{
+	// given
+	size_t size = REQUEST_SPOOL_MIN_SIZE - 1;
+
+	// when
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, size);
+
+	// then
+	CPPUNIT_ASSERT(spool == NULL);
+}
+
+
+void RequestSpoolTest::peek_fails_when_spool_is_empty()
+{
+	uint64_t seq;
+	size_t   length;
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+
+	// when
+	void* data = request_spool_peek(spool, &seq, &length);
+
+	// then
+	CPPUNIT_ASSERT(spool != NULL);
+	CPPUNIT_ASSERT(data == NULL);
+	CPPUNIT_ASSERT(request_spool_count(spool) == 0);
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::peek_keeps_fifo_order_of_records()
+{
+	uint64_t seq;
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+	request_spool_append(spool, "first", 5, NULL);
+	request_spool_append(spool, "second", 6, NULL);
+
+	// when
+	string first = peek_record(spool, &seq);
+	request_spool_remove(spool, seq);
+	string second = peek_record(spool, &seq);
+	request_spool_remove(spool, seq);
+
+	// then
+	CPPUNIT_ASSERT(first == "first");
+	CPPUNIT_ASSERT(second == "second");
+	CPPUNIT_ASSERT(request_spool_count(spool) == 0);
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::append_discards_oldest_records_when_full()
+{
+	uint64_t seq;
+	size_t   dropped = 0, total = 0;
+	string   record(1000, 'x');
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+
+	// when
+	for (size_t i = 0; i < 10; i++) {
+		ostringstream number;
+		number << i;
+		record.replace(0, number.str().length(), number.str());
+		request_spool_append(spool, record.data(), record.length(), &dropped);
+		total += dropped;
+	}
+
+	// then
+	size_t count = request_spool_count(spool);
+	CPPUNIT_ASSERT(total > 0);
+	CPPUNIT_ASSERT(count + total == 10);
+	CPPUNIT_ASSERT(peek_record(spool, &seq)[0] == (char) ('0' + total));
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::append_fails_with_record_larger_than_spool()
+{
+	string record(SPOOL_SIZE, 'x');
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+	request_spool_append(spool, "first", 5, NULL);
+
+	// when
+	int result = request_spool_append(spool, record.data(), record.length(), NULL);
+
+	// then
+	CPPUNIT_ASSERT(result == -1);
+	CPPUNIT_ASSERT(request_spool_count(spool) == 1);
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::remove_fails_when_record_already_discarded()
+{
+	uint64_t seq, other;
+	string   record(SPOOL_SIZE / 2, 'x');
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+	request_spool_append(spool, record.data(), record.length(), NULL);
+	peek_record(spool, &seq);
+	request_spool_append(spool, record.data(), record.length(), NULL);	// discards the first one
+
+	// when
+	int result = request_spool_remove(spool, seq);
+
+	// then
+	CPPUNIT_ASSERT(result == -1);
+	CPPUNIT_ASSERT(request_spool_count(spool) == 1);
+	CPPUNIT_ASSERT(!peek_record(spool, &other).empty() && (other != seq));
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::remove_keeps_records_after_wrapping_around()
+{
+	uint64_t seq;
+	bool     in_order = true;
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+
+	// when
+	for (size_t i = 0; i < 1000; i++) {
+		ostringstream in;
+		in << "record number " << i;
+		request_spool_append(spool, in.str().data(), in.str().length(), NULL);
+		if (i % 4 == 3) {
+			for (size_t j = i - 3; j <= i; j++) {
+				ostringstream out;
+				out << "record number " << j;
+				in_order = in_order && (peek_record(spool, &seq) == out.str());
+				request_spool_remove(spool, seq);
+			}
+		}
+	}
+
+	// then
+	CPPUNIT_ASSERT(in_order);
+	CPPUNIT_ASSERT(request_spool_count(spool) == 0);
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::open_recovers_records_of_previous_run()
+{
+	uint64_t seq;
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+	request_spool_append(spool, "first", 5, NULL);
+	request_spool_append(spool, "second", 6, NULL);
+	request_spool_append(spool, "third", 5, NULL);
+	request_spool_remove(spool, (peek_record(spool, &seq), seq));
+	request_spool_close(spool);
+
+	// when
+	spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+
+	// then
+	CPPUNIT_ASSERT(spool != NULL);
+	CPPUNIT_ASSERT(request_spool_count(spool) == 2);
+	CPPUNIT_ASSERT(peek_record(spool, &seq) == "second");
+	request_spool_close(spool);
+}
+
+
+void RequestSpoolTest::open_discards_corrupted_records_of_previous_run()
+{
+	uint64_t seq;
+	string   record(100, 'x');
+
+	// given
+	request_spool_t* spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+	for (size_t i = 0; i < 3; i++) {
+		request_spool_append(spool, record.data(), record.length(), NULL);
+	}
+	request_spool_close(spool);
+	fstream file(SPOOL_PATH, ios::in | ios::out | ios::binary);
+	string contents(SPOOL_SIZE, '\0');
+	file.read(&contents[0], SPOOL_SIZE);
+	size_t second = contents.find(record, contents.find(record) + record.length());
+	file.seekp(second + record.length() / 2, ios::beg);
+	file.put('y');	// corrupt the second record
+	file.close();
+
+	// when
+	spool = request_spool_open(SPOOL_PATH, SPOOL_SIZE);
+
+	// then
+	CPPUNIT_ASSERT(spool != NULL);
+	CPPUNIT_ASSERT(request_spool_count(spool) == 1);
+	CPPUNIT_ASSERT(peek_record(spool, &seq) == record);
+	request_spool_close(spool);
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_route_cache.cc
+ * @brief  Test suite to verify the cache of adapter request routes
+ *
+ * This file defines unit tests to verify the cache used to keep the request
+ * URL composed for every service (see route_cache.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include "route_cache.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// Route cache test suite
+class RouteCacheTest: public TestFixture
+{
+	// tests
+	void create_fails_with_no_buckets();
+	void get_fails_when_service_not_cached();
+	void get_distinguishes_host_from_service_description();
+	void put_replaces_previous_route_of_service();
+	void put_keeps_routes_of_colliding_services();
+	void clear_removes_all_routes();
+	void remove_keeps_routes_of_other_services();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(RouteCacheTest);
+	CPPUNIT_TEST(create_fails_with_no_buckets);
+	CPPUNIT_TEST(get_fails_when_service_not_cached);
+	CPPUNIT_TEST(get_distinguishes_host_from_service_description);
+	CPPUNIT_TEST(put_replaces_previous_route_of_service);
+	CPPUNIT_TEST(put_keeps_routes_of_colliding_services);
+	CPPUNIT_TEST(clear_removes_all_routes);
+	CPPUNIT_TEST(remove_keeps_routes_of_other_services);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(RouteCacheTest::suite());
+	RouteCacheTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	RouteCacheTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Some host name
+#define SOME_HOST		"host1"
+
+
+/// Some service description
+#define SOME_SERVICE		"disk"
+
+
+/// Some route
+#define SOME_ROUTE		"http://adapter:1337/check_disk?id=region:host1&type=host"
+
+
+///
+/// Suite setup
+///
+void RouteCacheTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void RouteCacheTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void RouteCacheTest::setUp()
+{
+}
+
+
+///
+/// Tests teardown
+///
+void RouteCacheTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void RouteCacheTest::create_fails_with_no_buckets()
+{
+	// given
+	size_t buckets = 0;
+
+	// when
+	route_cache_t* cache = route_cache_create(buckets);
+
+	// then
+	CPPUNIT_ASSERT(cache == NULL);
+}
+
+
+void RouteCacheTest::get_fails_when_service_not_cached()
+{
+	// given
+	route_cache_t* cache = route_cache_create(ROUTE_CACHE_BUCKETS);
+	route_cache_put(cache, SOME_HOST, SOME_SERVICE, SOME_ROUTE);
+
+	// when
+	const char* route = route_cache_get(cache, SOME_HOST, "other");
+
+	// then
+	CPPUNIT_ASSERT(route == NULL);
+	route_cache_free(cache);
+}
+
+
+void RouteCacheTest::get_distinguishes_host_from_service_description()
+{
+	// given
+	route_cache_t* cache = route_cache_create(ROUTE_CACHE_BUCKETS);
+	route_cache_put(cache, "ab", "c", "first");
+	route_cache_put(cache, "a", "bc", "second");
+
+	// when
+	const char* first  = route_cache_get(cache, "ab", "c");
+	const char* second = route_cache_get(cache, "a", "bc");
+
+	// then
+	CPPUNIT_ASSERT(first && (string(first) == "first"));
+	CPPUNIT_ASSERT(second && (string(second) == "second"));
+	CPPUNIT_ASSERT(route_cache_count(cache) == 2);
+	route_cache_free(cache);
+}
+
+
+void RouteCacheTest::put_replaces_previous_route_of_service()
+{
+	// given
+	route_cache_t* cache = route_cache_create(ROUTE_CACHE_BUCKETS);
+	route_cache_put(cache, SOME_HOST, SOME_SERVICE, "old");
+
+	// when
+	int result = route_cache_put(cache, SOME_HOST, SOME_SERVICE, SOME_ROUTE);
+
+	// then
+	const char* route = route_cache_get(cache, SOME_HOST, SOME_SERVICE);
+	CPPUNIT_ASSERT(result == 0);
+	CPPUNIT_ASSERT(route && (string(route) == SOME_ROUTE));
+	CPPUNIT_ASSERT(route_cache_count(cache) == 1);
+	route_cache_free(cache);
+}
+
+
+void RouteCacheTest::put_keeps_routes_of_colliding_services()
+{
+	bool all_found = true;
+
+	// given
+	route_cache_t* cache = route_cache_create(1);	// every service in the same bucket
+
+	// when
+	for (size_t i = 0; i < 100; i++) {
+		ostringstream host;
+		host << "host" << i;
+		route_cache_put(cache, host.str().c_str(), SOME_SERVICE, host.str().c_str());
+	}
+
+	// then
+	for (size_t i = 0; i < 100; i++) {
+		ostringstream host;
+		host << "host" << i;
+		const char* route = route_cache_get(cache, host.str().c_str(), SOME_SERVICE);
+		all_found = all_found && route && (host.str() == route);
+	}
+	CPPUNIT_ASSERT(all_found);
+	CPPUNIT_ASSERT(route_cache_count(cache) == 100);
+	route_cache_free(cache);
+}
+
+
+void RouteCacheTest::clear_removes_all_routes()
+{
+	// given
+	route_cache_t* cache = route_cache_create(ROUTE_CACHE_BUCKETS);
+	route_cache_put(cache, SOME_HOST, SOME_SERVICE, SOME_ROUTE);
+	route_cache_put(cache, SOME_HOST, "other", SOME_ROUTE);
+
+	// when
+	route_cache_clear(cache);
+
+	// then
+	CPPUNIT_ASSERT(route_cache_count(cache) == 0);
+	CPPUNIT_ASSERT(route_cache_get(cache, SOME_HOST, SOME_SERVICE) == NULL);
+	route_cache_free(cache);
+}
+
+
+void RouteCacheTest::remove_keeps_routes_of_other_services()
+{
+	// given
+	route_cache_t* cache = route_cache_create(1);	// every service in the same bucket
+	route_cache_put(cache, SOME_HOST, SOME_SERVICE, SOME_ROUTE);
+	route_cache_put(cache, SOME_HOST, "other", SOME_ROUTE);
+
+	// when
+	int result = route_cache_remove(cache, SOME_HOST, SOME_SERVICE);
+	int result_again = route_cache_remove(cache, SOME_HOST, SOME_SERVICE);
+
+	// then
+	CPPUNIT_ASSERT(result == 0);
+	CPPUNIT_ASSERT(result_again == -1);
+	CPPUNIT_ASSERT(route_cache_count(cache) == 1);
+	CPPUNIT_ASSERT(route_cache_get(cache, SOME_HOST, SOME_SERVICE) == NULL);
+	CPPUNIT_ASSERT(route_cache_get(cache, SOME_HOST, "other") != NULL);
+	route_cache_free(cache);
+}
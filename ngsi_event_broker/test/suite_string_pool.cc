@@ -0,0 +1,207 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_string_pool.cc
+ * @brief  Test suite to verify the pool of interned strings
+ *
+ * This file defines unit tests to verify the pool used to keep a single copy
+ * of the routes of services (see string_pool.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include "string_pool.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// String pool test suite
+class StringPoolTest: public TestFixture
+{
+	// tests
+	void intern_returns_copy_of_string();
+	void intern_returns_same_copy_of_equal_strings();
+	void intern_keeps_strings_when_growing();
+	void intern_stores_strings_longer_than_chunk();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(StringPoolTest);
+	CPPUNIT_TEST(intern_returns_copy_of_string);
+	CPPUNIT_TEST(intern_returns_same_copy_of_equal_strings);
+	CPPUNIT_TEST(intern_keeps_strings_when_growing);
+	CPPUNIT_TEST(intern_stores_strings_longer_than_chunk);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(StringPoolTest::suite());
+	StringPoolTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	StringPoolTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Some route
+#define SOME_ROUTE		"http://adapter:1337/check_disk?id=region:host1&type=host"
+
+
+///
+/// Suite setup
+///
+void StringPoolTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void StringPoolTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void StringPoolTest::setUp()
+{
+}
+
+
+///
+/// Tests teardown
+///
+void StringPoolTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void StringPoolTest::intern_returns_copy_of_string()
+{
+	// given
+	string_pool_t* pool = string_pool_create();
+	char route[] = SOME_ROUTE;
+
+	// when
+	const char* interned = string_pool_intern(pool, route);
+
+	// then
+	CPPUNIT_ASSERT(interned && (interned != route) && (string(interned) == SOME_ROUTE));
+	CPPUNIT_ASSERT(string_pool_count(pool) == 1);
+	CPPUNIT_ASSERT(string_pool_size(pool) == sizeof(route));
+	string_pool_free(pool);
+}
+
+
+void StringPoolTest::intern_returns_same_copy_of_equal_strings()
+{
+	// given
+	string_pool_t* pool = string_pool_create();
+	const char* first = string_pool_intern(pool, SOME_ROUTE);
+	string_pool_intern(pool, "other");
+
+	// when
+	const char* second = string_pool_intern(pool, string(SOME_ROUTE).c_str());
+
+	// then
+	CPPUNIT_ASSERT(first && (first == second));
+	CPPUNIT_ASSERT(string_pool_count(pool) == 2);
+	string_pool_free(pool);
+}
+
+
+void StringPoolTest::intern_keeps_strings_when_growing()
+{
+	bool all_found = true;
+	const size_t count = 10000;
+	const char* interned[count];
+
+	// given
+	string_pool_t* pool = string_pool_create();
+
+	// when
+	for (size_t i = 0; i < count; i++) {
+		ostringstream route;
+		route << SOME_ROUTE << i;
+		interned[i] = string_pool_intern(pool, route.str().c_str());
+	}
+
+	// then
+	for (size_t i = 0; i < count; i++) {
+		ostringstream route;
+		route << SOME_ROUTE << i;
+		all_found = all_found && interned[i] && (route.str() == interned[i])
+		            && (string_pool_intern(pool, route.str().c_str()) == interned[i]);
+	}
+	CPPUNIT_ASSERT(all_found);
+	CPPUNIT_ASSERT(string_pool_count(pool) == count);
+	string_pool_free(pool);
+}
+
+
+void StringPoolTest::intern_stores_strings_longer_than_chunk()
+{
+	// given
+	string_pool_t* pool = string_pool_create();
+	const char* first = string_pool_intern(pool, SOME_ROUTE);
+	string route(2 * STRING_POOL_CHUNK_SIZE, 'x');
+
+	// when
+	const char* interned = string_pool_intern(pool, route.c_str());
+	const char* second = string_pool_intern(pool, "other");
+
+	// then
+	CPPUNIT_ASSERT(interned && (route == interned));
+	CPPUNIT_ASSERT(second && (second == first + sizeof(SOME_ROUTE)));
+	string_pool_free(pool);
+}
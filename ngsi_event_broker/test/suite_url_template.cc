@@ -0,0 +1,303 @@
+/*
+ * Copyright 2016 Telefónica I+D
+ * All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/**
+ * @file   suite_url_template.cc
+ * @brief  Test suite to verify the templates of adapter request URLs
+ *
+ * This file defines unit tests to verify the templates compiled at module
+ * initialization to compose the request URLs (see url_template.c).
+ */
+
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include "url_template.h"
+#include "cppunit/TestResult.h"
+#include "cppunit/TestFixture.h"
+#include "cppunit/TextTestRunner.h"
+#include "cppunit/XmlOutputter.h"
+#include "cppunit/BriefTestProgressListener.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+
+using CppUnit::TestResult;
+using CppUnit::TestFixture;
+using CppUnit::TextTestRunner;
+using CppUnit::XmlOutputter;
+using CppUnit::BriefTestProgressListener;
+using namespace std;
+
+
+/// URL template test suite
+class UrlTemplateTest: public TestFixture
+{
+	// tests
+	void compile_fails_with_unknown_field();
+	void compile_fails_with_unbalanced_braces();
+	void compile_fails_with_nested_field_within_nested_template();
+	void expand_copies_literals_and_fields();
+	void expand_inlines_nested_template();
+	void expand_keeps_escaped_braces();
+	void expand_skips_null_fields();
+	void expand_encodes_values_but_url();
+	void encode_keeps_only_unreserved_characters();
+
+public:
+	static void suiteSetUp();
+	static void suiteTearDown();
+	void setUp();
+	void tearDown();
+	CPPUNIT_TEST_SUITE(UrlTemplateTest);
+	CPPUNIT_TEST(compile_fails_with_unknown_field);
+	CPPUNIT_TEST(compile_fails_with_unbalanced_braces);
+	CPPUNIT_TEST(compile_fails_with_nested_field_within_nested_template);
+	CPPUNIT_TEST(expand_copies_literals_and_fields);
+	CPPUNIT_TEST(expand_inlines_nested_template);
+	CPPUNIT_TEST(expand_keeps_escaped_braces);
+	CPPUNIT_TEST(expand_skips_null_fields);
+	CPPUNIT_TEST(expand_encodes_values_but_url);
+	CPPUNIT_TEST(encode_keeps_only_unreserved_characters);
+	CPPUNIT_TEST_SUITE_END();
+};
+
+
+/// Suite startup
+int main(int argc, char* argv[])
+{
+	TextTestRunner runner;
+	BriefTestProgressListener progress;
+	runner.eventManager().addListener(&progress);
+	runner.addTest(UrlTemplateTest::suite());
+	UrlTemplateTest::suiteSetUp();
+	cout << endl << endl;
+	bool success = runner.run("", false, true, false);
+	UrlTemplateTest::suiteTearDown();
+	ofstream xmlFileOut((string(argv[0]) + "-cppunit-results.xml").c_str());
+	XmlOutputter xmlOut(&runner.result(), xmlFileOut);
+	xmlOut.write();
+	return (success) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Some request template
+#define SOME_TEMPLATE		"{url}/{command}?id={id}&type={type}"
+
+
+/// Some entity id template
+#define SOME_ID_TEMPLATE	"{region}:{host_name}:{service}"
+
+
+///
+/// Suite setup
+///
+void UrlTemplateTest::suiteSetUp()
+{
+}
+
+
+///
+/// Suite teardown
+///
+void UrlTemplateTest::suiteTearDown()
+{
+}
+
+
+///
+/// Tests setup
+///
+void UrlTemplateTest::setUp()
+{
+}
+
+
+///
+/// Tests teardown
+///
+void UrlTemplateTest::tearDown()
+{
+}
+
+
+///////////////////////////////////
+
+
+void UrlTemplateTest::compile_fails_with_unknown_field()
+{
+	// given
+	const char* text = "{region}:{hostname}";
+
+	// when
+	url_template_t* tmpl = url_template_compile(text, NULL);
+
+	// then
+	CPPUNIT_ASSERT(tmpl == NULL);
+}
+
+
+void UrlTemplateTest::compile_fails_with_unbalanced_braces()
+{
+	// given
+	const char* open_text  = "{region}:{host_name";
+	const char* close_text = "{region}:host_name}";
+
+	// when
+	url_template_t* open_tmpl  = url_template_compile(open_text, NULL);
+	url_template_t* close_tmpl = url_template_compile(close_text, NULL);
+
+	// then
+	CPPUNIT_ASSERT(open_tmpl == NULL);
+	CPPUNIT_ASSERT(close_tmpl == NULL);
+}
+
+
+void UrlTemplateTest::compile_fails_with_nested_field_within_nested_template()
+{
+	// given
+	const char* nested = "{region}:{id}";
+
+	// when
+	url_template_t* tmpl = url_template_compile(SOME_TEMPLATE, nested);
+
+	// then
+	CPPUNIT_ASSERT(tmpl == NULL);
+}
+
+
+void UrlTemplateTest::expand_copies_literals_and_fields()
+{
+	// given
+	url_template_t* tmpl = url_template_compile("{url}/{command}?id={region}:{address}/{port}", NULL);
+	url_template_values_t values = { NULL };
+	values[URL_TEMPLATE_FIELD_URL]     = "http://adapter:1337";
+	values[URL_TEMPLATE_FIELD_COMMAND] = "check_snmp";
+	values[URL_TEMPLATE_FIELD_REGION]  = "region";
+	values[URL_TEMPLATE_FIELD_ADDRESS] = "10.11.100.80";
+	values[URL_TEMPLATE_FIELD_PORT]    = "20";
+
+	// when
+	char* result = url_template_expand(tmpl, values);
+
+	// then
+	CPPUNIT_ASSERT(result && (string(result) == "http://adapter:1337/check_snmp?id=region:10.11.100.80/20"));
+	free(result);
+	url_template_free(tmpl);
+}
+
+
+void UrlTemplateTest::expand_inlines_nested_template()
+{
+	// given
+	url_template_t* tmpl = url_template_compile(SOME_TEMPLATE, SOME_ID_TEMPLATE);
+	url_template_values_t values = { NULL };
+	values[URL_TEMPLATE_FIELD_URL]       = "http://adapter:1337";
+	values[URL_TEMPLATE_FIELD_COMMAND]   = "check_disk";
+	values[URL_TEMPLATE_FIELD_REGION]    = "region";
+	values[URL_TEMPLATE_FIELD_HOST_NAME] = "host1";
+	values[URL_TEMPLATE_FIELD_SERVICE]   = "disk";
+	values[URL_TEMPLATE_FIELD_TYPE]      = "ge";
+
+	// when
+	char* result = url_template_expand(tmpl, values);
+
+	// then
+	CPPUNIT_ASSERT(result && (string(result) == "http://adapter:1337/check_disk?id=region:host1:disk&type=ge"));
+	free(result);
+	url_template_free(tmpl);
+}
+
+
+void UrlTemplateTest::expand_keeps_escaped_braces()
+{
+	// given
+	url_template_t* tmpl = url_template_compile("{{{region}}}", NULL);
+	url_template_values_t values = { NULL };
+	values[URL_TEMPLATE_FIELD_REGION] = "region";
+
+	// when
+	char* result = url_template_expand(tmpl, values);
+
+	// then
+	CPPUNIT_ASSERT(result && (string(result) == "{region}"));
+	free(result);
+	url_template_free(tmpl);
+}
+
+
+void UrlTemplateTest::expand_skips_null_fields()
+{
+	// given
+	url_template_t* tmpl = url_template_compile(SOME_ID_TEMPLATE, NULL);
+	url_template_values_t values = { NULL };
+	values[URL_TEMPLATE_FIELD_REGION]  = "region";
+	values[URL_TEMPLATE_FIELD_SERVICE] = "disk";
+
+	// when
+	char* result = url_template_expand(tmpl, values);
+
+	// then
+	CPPUNIT_ASSERT(result && (string(result) == "region::disk"));
+	free(result);
+	url_template_free(tmpl);
+}
+
+
+void UrlTemplateTest::expand_encodes_values_but_url()
+{
+	// given
+	url_template_t* tmpl = url_template_compile(SOME_TEMPLATE, SOME_ID_TEMPLATE);
+	url_template_values_t values = { NULL };
+	values[URL_TEMPLATE_FIELD_URL]       = "http://adapter:1337/v1";
+	values[URL_TEMPLATE_FIELD_COMMAND]   = "check_http";
+	values[URL_TEMPLATE_FIELD_REGION]    = "region";
+	values[URL_TEMPLATE_FIELD_HOST_NAME] = "host1";
+	values[URL_TEMPLATE_FIELD_SERVICE]   = "Web & API 100%";
+	values[URL_TEMPLATE_FIELD_TYPE]      = "ge";
+
+	// when
+	char* result = url_template_expand(tmpl, values);
+
+	// then
+	CPPUNIT_ASSERT_EQUAL(string("http://adapter:1337/v1/check_http?id=region:host1:Web%20%26%20API%20100%25&type=ge"),
+	                     string(result ? result : ""));
+	free(result);
+	url_template_free(tmpl);
+}
+
+
+void UrlTemplateTest::encode_keeps_only_unreserved_characters()
+{
+	// given
+	const char* str = "AZaz09-._~ /:?#\xc3\xb1";
+	char        buffer[64];
+	size_t      raw = 0;
+
+	// when
+	size_t length = url_encoded_length(str, &raw);
+	char*  end    = url_encode(buffer, str);
+	*end = '\0';
+
+	// then
+	CPPUNIT_ASSERT_EQUAL(string("AZaz09-._~%20%2F%3A%3F%23%C3%B1"), string(buffer));
+	CPPUNIT_ASSERT_EQUAL(strlen(buffer), length);
+	CPPUNIT_ASSERT_EQUAL(strlen(str), raw);
+}